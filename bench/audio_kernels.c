@@ -0,0 +1,87 @@
+/* $Id$ */
+/*
+ * Samples per second of every audio kernel variant the CPU supports, on
+ * 20 ms stereo frames at 48 kHz as the extension processes them.
+ *
+ *   cc -O2 -o audio_kernels bench/audio_kernels.c -lm && ./audio_kernels
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../ts3client_audio.h"
+
+#define FRAMES 960
+#define SAMPLES (FRAMES * 2)
+#define MINIMUM_SECONDS 0.5
+
+enum Kernel { GAIN, DOWNMIX, LEVEL };
+static const char *kernel_names[] = { "gain", "downmix", "level" };
+
+static int16_t input[SAMPLES];
+static int16_t output[SAMPLES];
+static struct AudioLevel level;
+
+static double now(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void run(const struct AudioKernels *kernels, enum Kernel kernel, size_t iterations)
+{
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		switch (kernel)
+		{
+		case GAIN:
+			kernels->gain(output, SAMPLES, 0.8f);
+			break;
+		case DOWNMIX:
+			kernels->downmix(input, output, FRAMES);
+			break;
+		case LEVEL:
+			kernels->level(input, SAMPLES, &level);
+			break;
+		}
+	}
+}
+
+/* Doubles the iterations until a run takes long enough to be timed reliably. */
+static double samples_per_second(const struct AudioKernels *kernels, enum Kernel kernel)
+{
+	for (size_t iterations = 64;; iterations *= 2)
+	{
+		double start = now();
+		run(kernels, kernel, iterations);
+		double elapsed = now() - start;
+		if (elapsed >= MINIMUM_SECONDS)
+			return (double)iterations * SAMPLES / elapsed;
+	}
+}
+
+int main(void)
+{
+	const struct AudioKernels *variants[] = {
+		&audio_kernels_scalar,
+#if TS3CLIENT_AUDIO_X86
+		&audio_kernels_sse2,
+		&audio_kernels_avx2,
+#endif
+	};
+
+	srand(1);
+	for (size_t i = 0; i < SAMPLES; ++i)
+		input[i] = output[i] = rand() % 65536 - 32768;
+
+	printf("selected: %s\n", audio_kernels_select()->name);
+	printf("%-8s %-8s %16s\n", "variant", "kernel", "samples/s");
+	for (size_t v = 0; v < sizeof(variants) / sizeof(*variants); ++v)
+	{
+		if (audio_kernels_supported(variants[v]) == false)
+			continue;
+		for (enum Kernel kernel = GAIN; kernel <= LEVEL; ++kernel)
+			printf("%-8s %-8s %16.0f\n", variants[v]->name, kernel_names[kernel], samples_per_second(variants[v], kernel));
+	}
+	return level.peak < 0;
+}
@@ -0,0 +1,68 @@
+<?php
+/*
+ * Upload and download throughput of the transfer manager against the test
+ * server, for parallelism 1 up to 8.
+ *
+ *   php -d extension=ts3client bench/file_transfer.php [files] [bytes per file]
+ */
+require dirname(__DIR__)."/test_server.php";
+
+$files = (int)($argv[1] ?? 16);
+$bytes = (int)($argv[2] ?? 1 << 20);
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getClientID($connection, $clientID);
+ts3client_getChannelOfClient($connection, $clientID, $channelID);
+
+$source = sys_get_temp_dir() . "/ts3bench" . getmypid();
+$destination = "$source/down";
+mkdir($destination, 0777, true);
+for ($i = 0; $i < $files; ++$i)
+    file_put_contents("$source/bench$i", random_bytes($bytes));
+
+function run($connection, $channelID, $directory, $files, $upload)
+{
+    $start = microtime(true);
+    for ($i = 0; $i < $files; ++$i)
+    {
+        if ($upload)
+            ts3client_queueUpload($connection, $channelID, "", "/bench$i", $directory, true, false, $id);
+        else
+            ts3client_queueDownload($connection, $channelID, "", "/bench$i", $directory, true, false, $id);
+    }
+    do
+    {
+        usleep(10000);
+        ts3client_getTransfers($connection, $transfers);
+        $ended = count(array_filter($transfers, function ($transfer) { return $transfer["state"] >= TS3CLIENT_TRANSFER_DONE; }));
+    }
+    while ($ended < $files);
+    $elapsed = microtime(true) - $start;
+    ts3client_getTransfers($connection, $transfers, true);
+    foreach ($transfers as $transfer)
+        if ($transfer["state"] != TS3CLIENT_TRANSFER_DONE)
+            exit("transfer of {$transfer['file']} failed with error {$transfer['error']}\n");
+    return $elapsed;
+}
+
+printf("%-11s %12s %12s\n", "parallelism", "upload MB/s", "download MB/s");
+foreach ([1, 2, 4, 8] as $parallelism)
+{
+    ts3client_setTransferLimits($connection, $parallelism, 0, 0);
+    $up = run($connection, $channelID, $source, $files, true);
+    $down = run($connection, $channelID, $destination, $files, false);
+    printf("%-11d %12.2f %12.2f\n", $parallelism, $files * $bytes / $up / 1e6, $files * $bytes / $down / 1e6);
+}
+
+for ($i = 0; $i < $files; ++$i)
+{
+    unlink("$source/bench$i");
+    unlink("$destination/bench$i");
+}
+rmdir($destination);
+rmdir($source);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+?>
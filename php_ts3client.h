@@ -17,6 +17,25 @@
 extern zend_module_entry ts3client_module_entry;
 #define phpext_ts3client_ptr &ts3client_module_entry
 
+struct CompletionQueue;
+struct FiberWait;
+
+ZEND_BEGIN_MODULE_GLOBALS(ts3client)
+	zend_long timeout;
+	zend_bool fiber_wait;
+	struct CompletionQueue *completions;
+	struct FiberWait *fiber_waits;
+	struct StatsShard *stats;
+	int stats_function;
+ZEND_END_MODULE_GLOBALS(ts3client)
+
+ZEND_EXTERN_MODULE_GLOBALS(ts3client)
+#define TS3CLIENT_G(v) ZEND_MODULE_GLOBALS_ACCESSOR(ts3client, v)
+
+#if defined(ZTS) && defined(COMPILE_DL_TS3CLIENT)
+ZEND_TSRMLS_CACHE_EXTERN()
+#endif
+
 PHP_MINFO_FUNCTION(ts3client);
 PHP_MINIT_FUNCTION(ts3client);
 PHP_MSHUTDOWN_FUNCTION(ts3client);
@@ -0,0 +1,36 @@
+--TEST--
+client side flood control
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+if (ts3client_getFloodControl($connection, $flood) != ERROR_ok || $flood["commandsPerSecond"] != 0)
+    exit("flood control is not off by default");
+if (ts3client_setFloodControl($connection, 5, 2) != ERROR_ok)
+    exit("failed setting flood control");
+if (ts3client_getFloodControl($connection, $flood) != ERROR_ok)
+    exit("failed getting flood control");
+if ($flood["commandsPerSecond"] != 5 || $flood["burst"] != 2)
+    exit("got wrong flood control settings");
+$start = microtime(true);
+for ($i = 0; $i < 7; ++$i)
+{
+    if (ts3client_requestSendServerTextMsg($connection, "message $i") != ERROR_ok)
+        exit("failed sending server text message");
+}
+if (microtime(true) - $start < 0.9)
+    exit("messages were not throttled");
+if (ts3client_setFloodControl($connection, 0, 0) != ERROR_ok)
+    exit("failed disabling flood control");
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+if (ts3client_getFloodControl($connection, $flood) != ERROR_invalid_server_connection_handler_id)
+    exit("got flood control of a destroyed handler");
+if (ts3client_setFloodControl(123456, 5, 2) != ERROR_invalid_server_connection_handler_id)
+    exit("set flood control of an unknown handler");
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,29 @@
+--TEST--
+confirmed and pipelined text messages
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getClientID($connection, $client);
+ts3client_getChannelOfClient($connection, $client, $channel);
+if (ts3client_requestSendServerTextMsg($connection, "confirmed message", true) != ERROR_ok)
+    exit("failed sending confirmed server text message");
+$messages = array(
+    "server" => array("targetMode" => TextMessageTarget_SERVER, "message" => "to server"),
+    "channel" => array("targetMode" => TextMessageTarget_CHANNEL, "targetID" => $channel, "message" => "to channel"),
+    "invalid" => array("targetMode" => TextMessageTarget_CLIENT, "targetID" => 65000, "message" => "to nobody"),
+);
+if (ts3client_requestSendTextMsgs($connection, $messages, $result) == ERROR_ok)
+    exit("sending to an invalid client did not fail");
+if ($result["server"] != ERROR_ok || $result["channel"] != ERROR_ok)
+    exit("failed sending text messages");
+if ($result["invalid"] == ERROR_ok)
+    exit("message to invalid client was confirmed");
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
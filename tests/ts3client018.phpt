@@ -0,0 +1,33 @@
+--TEST--
+private text message to many clients
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection1);
+ts3client_spawnNewServerConnectionHandler(0, $connection2);
+ts3client_createIdentity($identity1);
+ts3client_createIdentity($identity2);
+ts3client_startConnection($connection1, $identity1, $ip, $port, "${user}_1", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_startConnection($connection2, $identity2, $ip, $port, "${user}_2", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getClientID($connection1, $client1);
+ts3client_getClientID($connection2, $client2);
+if (ts3client_sendPrivateTextMsgMany($connection1, "maintenance", array($client2), $result) != ERROR_ok)
+    exit("failed sending private text messages");
+if ($result[$client2] != ERROR_ok)
+    exit("got wrong result for recipient");
+if (ts3client_sendPrivateTextMsgMany($connection1, "maintenance", array($client2, 65000), $result) == ERROR_ok)
+    exit("sending to an invalid client did not fail");
+if ($result[$client2] != ERROR_ok || $result[65000] == ERROR_ok)
+    exit("got wrong results for recipients");
+if (ts3client_sendPrivateTextMsgMany($connection1, "maintenance", array(65000, $client2, 65000), $result) == ERROR_ok)
+    exit("sending to a repeated invalid client did not fail");
+if (count($result) != 2 || $result[$client2] != ERROR_ok || $result[65000] == ERROR_ok)
+    exit("got wrong results for repeated recipients");
+ts3client_stopconnection($connection1, "bye");
+ts3client_stopconnection($connection2, "bye");
+ts3client_destroyserverconnectionhandler($connection1);
+ts3client_destroyserverconnectionhandler($connection2);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,25 @@
+--TEST--
+send chunked text message
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getClientID($connection, $client);
+ts3client_getChannelOfClient($connection, $client, $channel);
+$message = str_repeat("[b]log line[/b] with ünïcödé [color=red]text ", 200);
+if (ts3client_requestSendTextMsgChunked($connection, TextMessageTarget_CHANNEL, $channel, $message) != ERROR_ok)
+    exit("failed sending chunked channel text message");
+if (ts3client_requestSendTextMsgChunked($connection, TextMessageTarget_SERVER, 0, $message, 100) != ERROR_ok)
+    exit("failed sending small chunks");
+if (ts3client_requestSendTextMsgChunked($connection, TextMessageTarget_SERVER, 0, $message, 1) != ERROR_parameter_invalid)
+    exit("accepted invalid chunk length");
+if (ts3client_requestSendTextMsgChunked($connection, TextMessageTarget_SERVER, 0, "hidden\0tail") != ERROR_parameter_invalid)
+    exit("accepted an embedded NUL");
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
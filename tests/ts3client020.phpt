@@ -0,0 +1,51 @@
+--TEST--
+moving and kicking many clients
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $admin);
+ts3client_createIdentity($identity);
+ts3client_startConnection($admin, $identity, $ip, $port, "${user}_admin", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+$connections = array();
+$clients = array();
+for ($i = 0; $i < 3; ++$i)
+{
+    ts3client_spawnNewServerConnectionHandler(0, $connection);
+    ts3client_createIdentity($identity);
+    ts3client_startConnection($connection, $identity, $ip, $port, "${user}_$i", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+    ts3client_getClientID($connection, $client);
+    $connections[] = $connection;
+    $clients[] = $client;
+}
+ts3client_setChannelVariableAsString($admin, 0, CHANNEL_NAME, "new_channel");
+ts3client_flushChannelCreation($admin, 0);
+ts3client_getClientID($admin, $self);
+ts3client_getChannelOfClient($admin, $self, $channel);
+if (ts3client_requestClientMoveMany($admin, $clients, $channel, "", $result) != ERROR_ok)
+    exit("failed moving clients");
+if (count($result) != 3)
+    exit("got wrong number of results");
+foreach ($clients as $client)
+{
+    ts3client_getChannelOfClient($admin, $client, $clientChannel);
+    if ($clientChannel != $channel)
+        exit("client was not moved");
+}
+if (ts3client_requestClientKickFromChannelMany($admin, array(65000, $clients[0]), "cleanup", $result, true) == ERROR_ok)
+    exit("kicking an invalid client did not fail");
+if ($result[65000] == ERROR_ok)
+    exit("kicking an invalid client was reported as success");
+if (ts3client_requestClientKickFromChannelMany($admin, array(65000, 65000), "cleanup", $result) == ERROR_ok)
+    exit("kicking a repeated invalid client did not fail");
+if (count($result) != 1 || $result[65000] == ERROR_ok)
+    exit("got wrong results for a repeated client");
+if (ts3client_requestClientKickFromServerMany($admin, $clients, "cleanup", $result) != ERROR_ok)
+    exit("failed kicking clients from server");
+ts3client_stopConnection($admin, "bye");
+ts3client_destroyServerConnectionHandler($admin);
+foreach ($connections as $connection)
+    ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,39 @@
+--TEST--
+provision channel tree
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+$tree = array(
+    "tournament" => array(
+        CHANNEL_NAME => "tournament",
+        CHANNEL_TOPIC => "finals",
+        "children" => array(
+            "team_a" => array(CHANNEL_NAME => "team a", CHANNEL_MAXCLIENTS => 5),
+            "team_b" => array(CHANNEL_NAME => "team b", CHANNEL_MAXCLIENTS => 5),
+        ),
+    ),
+);
+if (ts3client_provisionChannels($connection, $tree, $result) != ERROR_ok)
+    exit("failed provisioning channels");
+$parent = $result["tournament"]["channelID"];
+foreach (array("team_a", "team_b") as $team)
+{
+    $child = $result["tournament"]["children"][$team]["channelID"];
+    if (ts3client_getParentChannelOfChannel($connection, $child, $channelParent) != ERROR_ok)
+        exit("failed getting parent channel");
+    if ($channelParent != $parent)
+        exit("created channel under wrong parent");
+}
+ts3client_getChannelVariableAsString($connection, $parent, CHANNEL_TOPIC, $topic);
+if ($topic != "finals")
+    exit("channel property was not set");
+ts3client_requestChannelDelete($connection, $parent, true);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,37 @@
+--TEST--
+edit many channels
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+$tree = array(
+    "a" => array(CHANNEL_NAME => "channel_a"),
+    "b" => array(CHANNEL_NAME => "channel_b"),
+);
+ts3client_provisionChannels($connection, $tree, $created);
+$a = $created["a"]["channelID"];
+$b = $created["b"]["channelID"];
+$edits = array(
+    $a => array(CHANNEL_NAME => "renamed_a", CHANNEL_TOPIC => "topic a", CHANNEL_MAXCLIENTS => 10),
+    $b => array(CHANNEL_NAME => "renamed_b", CHANNEL_TOPIC => "topic b", CHANNEL_CODEC => CODEC_OPUS_VOICE),
+);
+if (ts3client_editChannels($connection, $edits, $result) != ERROR_ok)
+    exit("failed editing channels");
+if ($result[$a] != ERROR_ok || $result[$b] != ERROR_ok)
+    exit("got wrong results");
+ts3client_getChannelVariableAsString($connection, $a, CHANNEL_NAME, $name);
+if ($name != "renamed_a")
+    exit("channel was not renamed");
+ts3client_getChannelVariableAsString($connection, $b, CHANNEL_TOPIC, $topic);
+if ($topic != "topic b")
+    exit("channel topic was not changed");
+ts3client_requestChannelDelete($connection, $a, true);
+ts3client_requestChannelDelete($connection, $b, true);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
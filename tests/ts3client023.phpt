@@ -0,0 +1,55 @@
+--TEST--
+connections driven from several threads
+--SKIPIF--
+<?php
+if (!PHP_ZTS || !extension_loaded("parallel"))
+    die("skip requires a thread safe build with the parallel extension");
+?>
+--INI--
+ts3client.timeout=10
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+if (ini_get("ts3client.timeout") != 10)
+    exit("timeout was not configured");
+
+$worker = function ($ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword, $requests) {
+    if (ts3client_spawnNewServerConnectionHandler(0, $connection) != ERROR_ok)
+        return "failed spawning connection";
+    ts3client_createIdentity($identity);
+    if (ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword) != ERROR_ok)
+        return "failed connecting";
+    for ($i = 0; $i < $requests; ++$i)
+    {
+        if (ts3client_requestServerVariables($connection) != ERROR_ok)
+            return "failed requesting server variables";
+    }
+    ts3client_stopConnection($connection, "bye");
+    ts3client_destroyServerConnectionHandler($connection);
+    return "ok";
+};
+
+function run($worker, $threads, $args)
+{
+    $start = microtime(true);
+    $futures = array();
+    for ($i = 0; $i < $threads; ++$i)
+        $futures[] = (new \parallel\Runtime())->run($worker, $args);
+    foreach ($futures as $future)
+    {
+        $result = $future->value();
+        if ($result != "ok")
+            exit($result);
+    }
+    return microtime(true) - $start;
+}
+
+$args = array($ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword, 20);
+$single = run($worker, 1, $args);
+$parallel = run($worker, 8, $args);
+if ($parallel > $single * 4)
+    exit("threads did not run concurrently");
+echo("passed");
+?>
+--EXPECT--
+passed
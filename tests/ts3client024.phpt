@@ -0,0 +1,56 @@
+--TEST--
+connect from forked workers
+--SKIPIF--
+<?php
+if (!extension_loaded("pcntl"))
+    die("skip requires the pcntl extension");
+?>
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+// the parent's client lib has been used, but has no server connection handlers when forking
+if (ts3client_spawnNewServerConnectionHandler(0, $connection) != ERROR_ok)
+    exit("parent failed spawning before forking");
+ts3client_destroyServerConnectionHandler($connection);
+$workers = array();
+for ($i = 0; $i < 16; ++$i)
+{
+    $pid = pcntl_fork();
+    if ($pid == -1)
+        exit("failed forking");
+    if ($pid == 0)
+    {
+        if (ts3client_spawnNewServerConnectionHandler(0, $connection) != ERROR_ok)
+            exit(1);
+        ts3client_createIdentity($identity);
+        if (ts3client_startConnection($connection, $identity, $ip, $port, "$user $i", $defaultChannelID, $defaultChannelPassword, $serverPassword) != ERROR_ok)
+            exit(2);
+        if (ts3client_requestServerVariables($connection) != ERROR_ok)
+            exit(3);
+        // only a client lib of the worker's own has threads that hear back from the server
+        if (ts3client_getClientID($connection, $clientID) != ERROR_ok || $clientID == 0)
+            exit(4);
+        if (ts3client_getClientList($connection, $clients) != ERROR_ok || !in_array($clientID, $clients))
+            exit(5);
+        ts3client_stopConnection($connection, "bye");
+        ts3client_destroyServerConnectionHandler($connection);
+        exit(0);
+    }
+    $workers[] = $pid;
+}
+foreach ($workers as $pid)
+{
+    pcntl_waitpid($pid, $status);
+    if (!pcntl_wifexited($status) || pcntl_wexitstatus($status) != 0)
+        exit("worker failed with ".pcntl_wexitstatus($status));
+}
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+if (ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword) != ERROR_ok)
+    exit("parent failed connecting after forking");
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
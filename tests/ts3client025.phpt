@@ -0,0 +1,80 @@
+--TEST--
+submit requests to the io worker
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+function reap_all(&$pending)
+{
+    $completions = array();
+    if (ts3client_getCompletionFd($stream) != ERROR_ok)
+        exit("failed getting completion stream");
+    while (count($pending) > 0)
+    {
+        $read = array($stream);
+        $write = null;
+        $except = null;
+        if (stream_select($read, $write, $except, 15) < 1)
+            exit("timed out waiting for completions");
+        ts3client_reapCompletions($result);
+        foreach ($result as $completion)
+        {
+            if (!isset($pending[$completion["ticket"]]))
+                exit("got unknown ticket");
+            unset($pending[$completion["ticket"]]);
+            $completions[$completion["ticket"]] = $completion;
+        }
+    }
+    fclose($stream);
+    return $completions;
+}
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+if (ts3client_submit($connection, TS3CLIENT_OP_START_CONNECTION, array($identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword), $ticket) != ERROR_ok)
+    exit("failed submitting connect");
+$pending = array($ticket => true);
+$completions = reap_all($pending);
+if ($completions[$ticket]["error"] != ERROR_ok || $completions[$ticket]["operation"] != TS3CLIENT_OP_START_CONNECTION)
+    exit("failed connecting");
+
+$pending = array();
+$created = array();
+for ($i = 0; $i < 4; ++$i)
+{
+    ts3client_setChannelVariableAsString($connection, 0, CHANNEL_NAME, "submitted_$i");
+    if (ts3client_submit($connection, TS3CLIENT_OP_FLUSH_CHANNEL_CREATION, array(0), $ticket) != ERROR_ok)
+        exit("failed submitting channel creation");
+    $pending[$ticket] = true;
+}
+foreach (reap_all($pending) as $completion)
+{
+    if ($completion["error"] != ERROR_ok || $completion["channelID"] == 0)
+        exit("failed creating channel");
+    $created[] = $completion["channelID"];
+}
+
+$pending = array();
+foreach ($created as $channelID)
+{
+    ts3client_submit($connection, TS3CLIENT_OP_CHANNEL_DELETE, array($channelID, true), $ticket);
+    $pending[$ticket] = true;
+}
+foreach (reap_all($pending) as $completion)
+{
+    if ($completion["error"] != ERROR_ok)
+        exit("failed deleting channel");
+}
+
+if (ts3client_submit($connection, TS3CLIENT_OP_CHANNEL_DELETE, array(), $ticket) != ERROR_parameter_invalid)
+    exit("accepted missing arguments");
+
+ts3client_submit($connection, TS3CLIENT_OP_STOP_CONNECTION, array("bye"), $ticket);
+$pending = array($ticket => true);
+$completions = reap_all($pending);
+if ($completions[$ticket]["error"] != ERROR_ok)
+    exit("failed disconnecting");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
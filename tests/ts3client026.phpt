@@ -0,0 +1,53 @@
+--TEST--
+wait for the server inside fibers
+--SKIPIF--
+<?php
+if (PHP_VERSION_ID < 80100)
+    die("skip requires fibers");
+?>
+--INI--
+ts3client.fiber_wait=1
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+
+$events = array();
+$fibers = array();
+for ($i = 0; $i < 8; ++$i)
+{
+    $fiber = new Fiber(function () use ($connection, $i, &$events) {
+        $events[] = "start";
+        if (ts3client_requestSendServerTextMsg($connection, "fiber $i", true) != ERROR_ok)
+            exit("failed sending message");
+        $events[] = "end";
+    });
+    $fiber->start();
+    $fibers[] = $fiber;
+}
+if (count($events) != 8 || in_array("end", $events))
+    exit("fibers did not suspend while waiting");
+
+ts3client_getCompletionFd($stream);
+$deadline = microtime(true) + 10;
+while (count(array_filter($fibers, function ($fiber) { return !$fiber->isTerminated(); })) > 0)
+{
+    if (microtime(true) > $deadline)
+        exit("fibers were not resumed");
+    $read = array($stream);
+    $write = null;
+    $except = null;
+    stream_select($read, $write, $except, 1);
+    ts3client_dispatchCompletions();
+}
+if (count(array_keys($events, "end")) != 8)
+    exit("not all fibers finished");
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
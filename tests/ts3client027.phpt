@@ -0,0 +1,61 @@
+--TEST--
+stream audio through a custom capture device
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+function tone($milliseconds)
+{
+    $samples = 48 * $milliseconds;
+    $pcm = "";
+    for ($i = 0; $i < $samples; ++$i)
+        $pcm .= pack("s", (int)(8000 * sin(2 * M_PI * 440 * $i / 48000)));
+    return $pcm;
+}
+
+if (ts3client_registerCustomDevice("php_capture", "PHP capture", 48000, 1, 48000, 1) != ERROR_ok)
+    exit("failed registering device");
+if (ts3client_registerCustomDevice("php_capture", "PHP capture", 48000, 1, 48000, 1) == ERROR_ok)
+    exit("registered device twice");
+if (ts3client_registerCustomDevice("broken", "broken", 44000, 3, 48000, 1) != ERROR_parameter_invalid)
+    exit("accepted invalid format");
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+if (ts3client_openCaptureDevice($connection, "custom", "php_capture") != ERROR_ok)
+    exit("failed opening capture device");
+
+$pcm = tone(1000);
+if (ts3client_feedCustomCapture("php_capture", $pcm, $consumed) != ERROR_ok || $consumed != strlen($pcm))
+    exit("failed feeding string");
+ts3client_getCustomCaptureStatus("php_capture", $status);
+if ($status["bufferedMilliseconds"] < 900)
+    exit("audio was not buffered");
+usleep(500000);
+ts3client_getCustomCaptureStatus("php_capture", $status);
+if ($status["bufferedMilliseconds"] > 700 || $status["bufferedMilliseconds"] < 300)
+    exit("audio was not paced");
+
+$stream = fopen("php://memory", "w+");
+fwrite($stream, tone(200) . "x");
+rewind($stream);
+if (ts3client_feedCustomCapture("php_capture", $stream, $consumed) != ERROR_ok || $consumed != 48 * 200 * 2 + 1)
+    exit("failed feeding stream");
+fclose($stream);
+
+usleep(1500000);
+ts3client_getCustomCaptureStatus("php_capture", $status);
+if ($status["buffered"] != 0 || $status["underruns"] < 1)
+    exit("buffer was not drained");
+
+ts3client_closeCaptureDevice($connection);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+if (ts3client_unregisterCustomDevice("php_capture") != ERROR_ok)
+    exit("failed unregistering device");
+if (ts3client_feedCustomCapture("php_capture", $pcm, $consumed) != ERROR_sound_unknown_device)
+    exit("fed unregistered device");
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,56 @@
+--TEST--
+record playback of a custom device
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+if (ts3client_registerCustomDevice("php_audio", "PHP audio", 48000, 1, 48000, 2) != ERROR_ok)
+    exit("failed registering device");
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+if (ts3client_openPlaybackDevice($connection, "custom", "php_audio") != ERROR_ok)
+    exit("failed opening playback device");
+
+$path = tempnam(sys_get_temp_dir(), "ts3");
+if (ts3client_startCustomPlayback("php_audio", $path) != ERROR_ok)
+    exit("failed starting recording");
+if (ts3client_startCustomPlayback("php_audio") != ERROR_currently_not_possible)
+    exit("started recording twice");
+$stream = fopen("php://memory", "w+");
+if (ts3client_readCustomPlayback("php_audio", $stream, $read) != ERROR_currently_not_possible)
+    exit("read while recording to a file");
+usleep(1000000);
+ts3client_getCustomPlaybackStatus("php_audio", $status);
+if ($status["error"] != ERROR_ok)
+    exit("failed writing recording");
+if (ts3client_stopCustomPlayback("php_audio") != ERROR_ok)
+    exit("failed completing recording");
+
+$wav = file_get_contents($path);
+unlink($path);
+$header = unpack("a4riff/Vsize/a4wave/a4fmt/Vlength/vformat/vchannels/Vrate/Vbytes/valign/vbits/a4data/Vdata", $wav);
+if ($header["riff"] != "RIFF" || $header["wave"] != "WAVE" || $header["channels"] != 2 || $header["rate"] != 48000)
+    exit("invalid header");
+if ($header["data"] != strlen($wav) - 44 || $header["data"] < 48 * 2 * 2 * 800)
+    exit("recording is incomplete");
+
+if (ts3client_startCustomPlayback("php_audio") != ERROR_ok)
+    exit("failed starting stream");
+usleep(500000);
+if (ts3client_readCustomPlayback("php_audio", $stream, $read) != ERROR_ok || $read < 48 * 2 * 2 * 400 || $read != ftell($stream))
+    exit("failed reading playback");
+ts3client_getCustomPlaybackStatus("php_audio", $status);
+if ($status["capturing"] !== true || $status["overruns"] != 0)
+    exit("invalid status");
+ts3client_stopCustomPlayback("php_audio");
+fclose($stream);
+
+ts3client_closePlaybackDevice($connection);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+ts3client_unregisterCustomDevice("php_audio");
+echo("passed");
+?>
+--EXPECT--
+passed
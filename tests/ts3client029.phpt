@@ -0,0 +1,63 @@
+--TEST--
+record every speaker into a file of its own
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+$pcm = "";
+for ($i = 0; $i < 48000; ++$i)
+    $pcm .= pack("s", (int)(8000 * sin(2 * M_PI * 440 * $i / 48000)));
+
+ts3client_registerCustomDevice("speaker", "speaker", 48000, 1, 48000, 1);
+ts3client_registerCustomDevice("listener", "listener", 48000, 1, 48000, 1);
+ts3client_createIdentity($identity);
+ts3client_spawnNewServerConnectionHandler(0, $speaker);
+ts3client_startConnection($speaker, $identity, $ip, $port, "speaker", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_createIdentity($identity);
+ts3client_spawnNewServerConnectionHandler(0, $listener);
+ts3client_startConnection($listener, $identity, $ip, $port, "listener", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_openCaptureDevice($speaker, "custom", "speaker");
+ts3client_openPlaybackDevice($listener, "custom", "listener");
+ts3client_startCustomPlayback("listener");
+
+$directory = sys_get_temp_dir() . "/ts3speakers" . getmypid();
+mkdir($directory);
+if (ts3client_startSpeakerRecording($directory . "/missing") != ERROR_parameter_invalid)
+    exit("accepted missing directory");
+if (ts3client_startSpeakerRecording($directory) != ERROR_ok)
+    exit("failed starting recording");
+if (ts3client_startSpeakerRecording($directory) != ERROR_currently_not_possible)
+    exit("started recording twice");
+
+ts3client_feedCustomCapture("speaker", $pcm, $consumed);
+usleep(1500000);
+ts3client_feedCustomCapture("speaker", $pcm, $consumed);
+usleep(1500000);
+ts3client_getClientID($speaker, $speakerID);
+ts3client_getSpeakerRecordingStatus($status);
+if ($status["recording"] !== true || count($status["tracks"]) != 1 || $status["tracks"][0]["clientID"] != $speakerID)
+    exit("speaker was not recorded");
+if (ts3client_stopSpeakerRecording() != ERROR_ok)
+    exit("failed stopping recording");
+
+$files = glob("$directory/$listener-$speakerID-*.wav");
+if (count($files) != 1)
+    exit("file was not written");
+$wav = file_get_contents($files[0]);
+$header = unpack("a4riff/Vsize/a4wave/a4fmt/Vlength/vformat/vchannels/Vrate/Vbytes/valign/vbits/a4data/Vdata", $wav);
+if ($header["rate"] != 48000 || $header["data"] != strlen($wav) - 44)
+    exit("invalid header");
+if ($header["data"] < 48000 * 2 * 2.5)
+    exit("pause was not recorded as silence");
+foreach (glob("$directory/*") as $file)
+    unlink($file);
+rmdir($directory);
+
+ts3client_stopCustomPlayback("listener");
+ts3client_stopConnection($speaker, "bye");
+ts3client_stopConnection($listener, "bye");
+ts3client_destroyServerConnectionHandler($speaker);
+ts3client_destroyServerConnectionHandler($listener);
+echo("passed");
+?>
+--EXPECT--
+passed
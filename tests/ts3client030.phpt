@@ -0,0 +1,35 @@
+--TEST--
+gain and levels of a custom device
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+$pcm = "";
+for ($i = 0; $i < 48000; ++$i)
+    $pcm .= pack("s", (int)round(16000 * sin(2 * M_PI * 500 * $i / 48000)));
+
+ts3client_registerCustomDevice("php_gain", "PHP gain", 48000, 1, 48000, 1);
+if (ts3client_setCustomDeviceGain("php_gain", 17, 1) != ERROR_parameter_invalid)
+    exit("accepted invalid gain");
+if (ts3client_setCustomDeviceGain("unknown", 1, 1) != ERROR_sound_unknown_device)
+    exit("accepted unknown device");
+if (ts3client_setCustomDeviceGain("php_gain", 0.5, 1) != ERROR_ok)
+    exit("failed setting gain");
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_openCaptureDevice($connection, "custom", "php_gain");
+ts3client_feedCustomCapture("php_gain", $pcm, $consumed);
+usleep(300000);
+ts3client_getCustomCaptureStatus("php_gain", $status);
+if ($status["gain"] != 0.5 || abs($status["peak"] - 8000) > 10 || abs($status["rms"] - 8000 / sqrt(2)) > 50)
+    exit("gain was not applied");
+
+ts3client_closeCaptureDevice($connection);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+ts3client_unregisterCustomDevice("php_gain");
+echo("passed");
+?>
+--EXPECT--
+passed
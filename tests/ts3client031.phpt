@@ -0,0 +1,47 @@
+--TEST--
+aggregate talk time natively
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+$pcm = "";
+for ($i = 0; $i < 24000; ++$i)
+    $pcm .= pack("s", (int)(8000 * sin(2 * M_PI * 440 * $i / 48000)));
+
+ts3client_registerCustomDevice("talker", "talker", 48000, 1, 48000, 1);
+ts3client_createIdentity($identity);
+ts3client_spawnNewServerConnectionHandler(0, $speaker);
+ts3client_startConnection($speaker, $identity, $ip, $port, "speaker", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_createIdentity($identity);
+ts3client_spawnNewServerConnectionHandler(0, $listener);
+ts3client_startConnection($listener, $identity, $ip, $port, "listener", $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_openCaptureDevice($speaker, "custom", "talker");
+ts3client_getClientID($speaker, $speakerID);
+
+if (ts3client_getTalkStats($listener, false, $stats) != ERROR_ok || $stats !== [])
+    exit("stats before talking");
+ts3client_feedCustomCapture("talker", $pcm, $consumed);
+usleep(1500000);
+ts3client_feedCustomCapture("talker", $pcm, $consumed);
+usleep(1500000);
+
+ts3client_getTalkStats($listener, true, $stats);
+if (count($stats) != 1 || $stats[0]["clientID"] != $speakerID || $stats[0]["talking"])
+    exit("talker was not recorded");
+if ($stats[0]["bursts"] < 1 || $stats[0]["milliseconds"] < 800 || $stats[0]["longest"] > $stats[0]["milliseconds"])
+    exit("talk time was not counted");
+if (array_sum($stats[0]["histogram"]) != $stats[0]["bursts"] || count($stats[0]["histogram"]) != 16)
+    exit("invalid histogram");
+ts3client_getTalkStats($listener, false, $stats);
+if ($stats !== [])
+    exit("stats were not reset");
+
+ts3client_closeCaptureDevice($speaker);
+ts3client_stopConnection($speaker, "bye");
+ts3client_stopConnection($listener, "bye");
+ts3client_destroyServerConnectionHandler($speaker);
+ts3client_destroyServerConnectionHandler($listener);
+ts3client_unregisterCustomDevice("talker");
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,34 @@
+--TEST--
+set whisper lists and read them from the cache
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getChannelList($connection, $channels);
+
+if (ts3client_requestClientSetWhisperList($connection, 0, [$channels[0]], []) != ERROR_ok)
+    exit("failed setting whisper list");
+ts3client_getWhisperList($connection, 0, $list);
+if ($list !== ["channels" => [$channels[0]], "clients" => []])
+    exit("whisper list was not cached");
+
+$error = ts3client_requestClientSetWhisperListMany($connection, [0 => ["channels" => $channels], "x" => [], 1 => ["clients" => 5]], $result);
+if ($error != ERROR_parameter_invalid || $result[0] != ERROR_ok || $result["x"] != ERROR_parameter_invalid || $result[1] != ERROR_parameter_invalid)
+    exit("invalid result " . json_encode($result));
+ts3client_getWhisperList($connection, 0, $list);
+if ($list["channels"] != $channels)
+    exit("cache was not updated");
+
+ts3client_requestClientSetWhisperListMany($connection, [0 => []], $result);
+ts3client_getWhisperList($connection, 0, $list);
+if ($result[0] != ERROR_ok || $list !== ["channels" => [], "clients" => []])
+    exit("whisper list was not cleared");
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,75 @@
+--TEST--
+upload and download files through the transfer manager
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getClientID($connection, $clientID);
+ts3client_getChannelOfClient($connection, $clientID, $channelID);
+
+function wait_for_transfers($connection, $ids)
+{
+    for ($i = 0; $i < 100; ++$i)
+    {
+        ts3client_getTransfers($connection, $transfers);
+        $ended = array_filter($ids, function ($id) use ($transfers) { return $transfers[$id]["state"] >= TS3CLIENT_TRANSFER_DONE; });
+        if (count($ended) == count($ids))
+            return $transfers;
+        usleep(100000);
+    }
+    exit("transfers did not end");
+}
+
+$source = sys_get_temp_dir() . "/ts3up" . getmypid();
+$destination = sys_get_temp_dir() . "/ts3down" . getmypid();
+mkdir($source);
+mkdir($destination);
+if (ts3client_setTransferLimits($connection, 2, 0, 0) != ERROR_ok)
+    exit("failed setting limits");
+if (ts3client_setTransferLimits($connection, 0, 0, 0) != ERROR_parameter_invalid)
+    exit("accepted parallelism 0");
+
+$uploads = [];
+for ($i = 0; $i < 5; ++$i)
+{
+    file_put_contents("$source/file$i", str_repeat(chr(65 + $i), 10000 * ($i + 1)));
+    if (ts3client_queueUpload($connection, $channelID, "", "/file$i", $source, true, false, $uploads[$i]) != ERROR_ok)
+        exit("failed queueing upload");
+}
+foreach (wait_for_transfers($connection, $uploads) as $id => $transfer)
+    if ($transfer["state"] != TS3CLIENT_TRANSFER_DONE || !$transfer["upload"])
+        exit("upload failed " . json_encode($transfer));
+
+$downloads = [];
+for ($i = 0; $i < 5; ++$i)
+    ts3client_queueDownload($connection, $channelID, "", "/file$i", $destination, true, false, $downloads[$i]);
+ts3client_queueDownload($connection, $channelID, "", "/missing", $destination, true, false, $missing);
+$transfers = wait_for_transfers($connection, array_merge($downloads, [$missing]));
+if ($transfers[$missing]["state"] != TS3CLIENT_TRANSFER_FAILED)
+    exit("downloaded a missing file");
+for ($i = 0; $i < 5; ++$i)
+    if ($transfers[$downloads[$i]]["state"] != TS3CLIENT_TRANSFER_DONE || file_get_contents("$destination/file$i") !== file_get_contents("$source/file$i"))
+        exit("download $i failed");
+
+if (ts3client_cancelTransfer($missing, false) != ERROR_currently_not_possible)
+    exit("canceled an ended transfer");
+ts3client_getTransfers($connection, $transfers, true);
+ts3client_getTransfers(0, $transfers);
+if ($transfers !== [])
+    exit("ended transfers were not removed");
+
+for ($i = 0; $i < 5; ++$i)
+{
+    unlink("$source/file$i");
+    unlink("$destination/file$i");
+}
+rmdir($source);
+rmdir($destination);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,54 @@
+--TEST--
+read, write, stat and list channel files through ts3file://
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_getClientID($connection, $clientID);
+ts3client_getChannelOfClient($connection, $clientID, $channelID);
+
+$name = "stream" . getmypid();
+$url = "ts3file://$connection/$channelID/$name";
+$data = random_bytes(300000);
+
+$stream = fopen($url, "w");
+if ($stream === false)
+    exit("failed opening for writing");
+foreach (str_split($data, 8192) as $chunk)
+    fwrite($stream, $chunk);
+if (fclose($stream) !== true)
+    exit("upload failed");
+
+clearstatcache();
+$stat = stat($url);
+if ($stat === false || $stat["size"] != strlen($data) || is_dir($url))
+    exit("invalid stat " . json_encode($stat));
+if (!is_dir("ts3file://$connection/$channelID/") || file_exists("ts3file://$connection/$channelID/missing$name"))
+    exit("invalid directory stat");
+if (!in_array($name, scandir("ts3file://$connection/$channelID/")))
+    exit("file is not listed");
+
+$stream = fopen($url, "r");
+$read = "";
+while (!feof($stream))
+    $read .= fread($stream, 8192);
+fclose($stream);
+if ($read !== $data)
+    exit("read different data");
+if (file_get_contents($url) !== $data)
+    exit("file_get_contents read different data");
+
+if (@fopen($url, "r+") !== false)
+    exit("opened for reading and writing");
+if (@file_get_contents("ts3file://$connection/$channelID/missing$name") != "")
+    exit("read a missing file");
+ts3client_getTransfers($connection, $transfers, true);
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
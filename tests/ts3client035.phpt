@@ -0,0 +1,35 @@
+--TEST--
+collect latency statistics of functions and their waits
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_getStats($stats, true);
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+for ($i = 0; $i < 10; ++$i)
+    ts3client_requestClientSetWhisperList($connection, 0, [], []);
+ts3client_requestClientSetWhisperList($connection + 1000, 0, [], []);
+
+ts3client_getStats($stats);
+$whisper = $stats["ts3client_requestClientSetWhisperList"];
+if ($whisper["count"] != 11 || $whisper["wait_count"] < 10 || $whisper["timeouts"] != 0 || count($whisper["errors"]) != 1)
+    exit("invalid counts " . json_encode($whisper));
+if (!($whisper["p50"] <= $whisper["p99"] && $whisper["p99"] <= $whisper["p999"] && $whisper["p999"] <= $whisper["max"]))
+    exit("invalid percentiles " . json_encode($whisper));
+if ($whisper["wait_p50"] > $whisper["max"] || $whisper["wait_max"] == 0)
+    exit("invalid wait percentiles " . json_encode($whisper));
+if (!isset($stats["ts3client_startConnection"]) || $stats["ts3client_createIdentity"]["errors"] !== [])
+    exit("missing functions");
+
+ts3client_getStats($stats, true);
+ts3client_getStats($stats);
+if (isset($stats["ts3client_requestClientSetWhisperList"]))
+    exit("statistics were not reset");
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
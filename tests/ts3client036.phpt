@@ -0,0 +1,33 @@
+--TEST--
+profile lock contention and callback durations
+--INI--
+ts3client.lock_profiling=1
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_getLockStats($stats, true);
+if ($stats["enabled"] !== true || !isset($stats["locks"]["mutex"]))
+    exit("lock profiling is not enabled");
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+for ($i = 0; $i < 10; ++$i)
+    ts3client_requestClientSetWhisperList($connection, 0, [], []);
+
+ts3client_getLockStats($stats);
+$mutex = $stats["locks"]["mutex"];
+if ($mutex["wait_count"] == 0 || $mutex["hold_count"] == 0 || $mutex["wait_p50"] > $mutex["wait_max"])
+    exit("mutex was not profiled " . json_encode($mutex));
+if ($mutex["worst_hold_by"] == "" || $mutex["worst_hold_at"] < (time() - 60) * 1000)
+    exit("worst hold was not attributed " . json_encode($mutex));
+$errors = $stats["callbacks"]["onServerErrorEvent"] ?? null;
+if ($errors === null || $errors["count"] < 10 || $errors["lock_wait_count"] < 10)
+    exit("callbacks were not profiled " . json_encode($stats["callbacks"]));
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,28 @@
+--TEST--
+route client lib log messages into a file
+--INI--
+ts3client.log_file=/tmp/ts3client_test.log
+ts3client.log_level=devel
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+$before = file_exists("/tmp/ts3client_test.log") ? filesize("/tmp/ts3client_test.log") : 0;
+ts3client_getLogStatus($status);
+if ($status["enabled"] !== true || $status["file"] != "/tmp/ts3client_test.log")
+    exit("log routing is not enabled " . json_encode($status));
+
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+usleep(300000);
+
+ts3client_getLogStatus($status);
+clearstatcache();
+if ($status["written"] == 0 || filesize("/tmp/ts3client_test.log") <= $before)
+    exit("nothing was logged " . json_encode($status));
+echo("passed");
+?>
+--EXPECT--
+passed
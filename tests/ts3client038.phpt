@@ -0,0 +1,42 @@
+--TEST--
+render metrics in the OpenMetrics text format
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_requestClientSetWhisperList($connection, 0, [], []);
+
+if (ts3client_metrics($metrics) != ERROR_ok || substr($metrics, -6) !== "# EOF\n")
+    exit("invalid metrics");
+$expected = [
+    "ts3client_pending_requests 0",
+    "ts3client_connection_status{handler=\"$connection\"} " . STATUS_CONNECTION_ESTABLISHED,
+    "ts3client_connection_reconnects_total{handler=\"$connection\"} 0",
+    "ts3client_request_wait_seconds_bucket{le=\"+Inf\"} ",
+];
+foreach ($expected as $line)
+    if (strpos($metrics, $line) === false)
+        exit("missing $line");
+if (!preg_match("/^ts3client_connection_sent_bytes_total\\{handler=\"$connection\"\\} [1-9]/m", $metrics))
+    exit("missing traffic");
+
+$previous = -1;
+preg_match_all('/^ts3client_request_wait_seconds_bucket\{le="([^"]+)"\} (\d+)$/m', $metrics, $buckets, PREG_SET_ORDER);
+foreach ($buckets as $bucket)
+{
+    if ($bucket[2] < $previous)
+        exit("buckets are not cumulative");
+    $previous = $bucket[2];
+}
+foreach (explode("\n", trim($metrics)) as $line)
+    if ($line[0] != "#" && !preg_match('/^[a-z_]+(\{[a-z]+="[^"]*"\})? [0-9.e+-]+$/', $line))
+        exit("invalid line $line");
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -0,0 +1,34 @@
+--TEST--
+dump traced requests as Chrome trace events
+--INI--
+ts3client.tracing=1
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+ts3client_requestClientSetWhisperList($connection, 0, [], []);
+
+$path = tempnam(sys_get_temp_dir(), "trace");
+if (ts3client_dumpTrace($path) != ERROR_ok)
+    exit("dump failed");
+$trace = json_decode(file_get_contents($path), true);
+unlink($path);
+if (!is_array($trace) || !isset($trace["traceEvents"]))
+    exit("invalid trace");
+
+$phases = [];
+foreach ($trace["traceEvents"] as $event)
+    if (($event["cat"] ?? "") == "ts3client" && $event["ph"] != "i")
+        $phases[$event["id"]][] = $event["ph"] . " " . $event["name"];
+$expected = ["b ts3client_requestClientSetWhisperList", "b send", "e send", "b server", "e server", "b wake", "e wake", "e ts3client_requestClientSetWhisperList"];
+if (!in_array($expected, $phases))
+    exit("request not traced");
+
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
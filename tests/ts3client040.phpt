@@ -0,0 +1,46 @@
+--TEST--
+sample the connection quality in the background
+--FILE--
+<?php
+require dirname(__DIR__)."/test_server.php";
+ts3client_spawnNewServerConnectionHandler(0, $connection);
+ts3client_createIdentity($identity);
+ts3client_startConnection($connection, $identity, $ip, $port, $user, $defaultChannelID, $defaultChannelPassword, $serverPassword);
+
+if (ts3client_startQualitySampler($connection, 10) != ERROR_parameter_invalid)
+    exit("interval not checked");
+if (ts3client_startQualitySampler($connection, 1000, 2) != ERROR_ok)
+    exit("sampler not started");
+sleep(4);
+
+if (ts3client_getQualitySamples($connection, $samples) != ERROR_ok)
+    exit("no samples");
+if ($samples["capacity"] != 2 || count($samples["points"]) != 2)
+    exit("ring not bounded");
+$first = $samples["points"][0];
+$last = $samples["points"][1];
+if ($first["time"] >= $last["time"] || $last["packets_received"] < $first["packets_received"] || $last["packets_sent"] == 0)
+    exit("invalid samples");
+
+if (ts3client_getQualitySamples($connection, $aggregates, 0, 60000) != ERROR_ok)
+    exit("no aggregates");
+$samples_in_buckets = 0;
+foreach ($aggregates["points"] as $bucket)
+{
+    $samples_in_buckets += $bucket["samples"];
+    if ($bucket["ping"]["min"] > $bucket["ping"]["avg"] || $bucket["ping"]["avg"] > $bucket["ping"]["max"])
+        exit("invalid aggregate");
+}
+if ($samples_in_buckets != 2)
+    exit("samples not aggregated");
+if (ts3client_getQualitySamples($connection, $recent, $last["time"] + 1) != ERROR_ok || count($recent["points"]) != 0)
+    exit("since not applied");
+
+if (ts3client_stopQualitySampler($connection) != ERROR_ok || ts3client_getQualitySamples($connection, $samples) != ERROR_parameter_invalid)
+    exit("sampler not stopped");
+ts3client_stopConnection($connection, "bye");
+ts3client_destroyServerConnectionHandler($connection);
+echo("passed");
+?>
+--EXPECT--
+passed
@@ -1,19 +1,92 @@
 #define TIMEOUT 5
+#define WAIT_ITEM_BUCKETS 64
+#define FLOOD_DEFAULT_BURST 20.0
+#define FLOOD_MINIMUM_RATE 0.5
+#define FLOOD_RECOVERY_STEPS 32
+#ifdef TS3_MAX_SIZE_TEXTMESSAGE
+#define TEXTMESSAGE_MAX_LENGTH TS3_MAX_SIZE_TEXTMESSAGE
+#else
+#define TEXTMESSAGE_MAX_LENGTH 1024
+#endif
+#define TEXTMESSAGE_MIN_LENGTH 16
+#define TEXTMESSAGE_MAX_CARRIED_TAGS 8
+#define TEXTMESSAGE_TAG_LENGTH 32
+#define SUBMISSION_QUEUE_SIZE 1024
+#define SUBMISSION_MAX_ARGUMENTS 7
+#define IO_WORKER_SWEEP_INTERVAL 1000
+#define CUSTOM_DEVICE_FRAME_MS 20
+#define CUSTOM_DEVICE_BUFFER_MS 2000
+#define CUSTOM_DEVICE_MAX_FREQUENCY 48000
+#define CUSTOM_DEVICE_MAX_CHANNELS 2
+#define CUSTOM_DEVICE_MAX_FRAME (CUSTOM_DEVICE_MAX_FREQUENCY / 1000 * CUSTOM_DEVICE_FRAME_MS * CUSTOM_DEVICE_MAX_CHANNELS)
+#define PACER_MAX_LATENESS_MS 200
+#define CUSTOM_PLAYBACK_BUFFER_MS 10000
+#define CUSTOM_PLAYBACK_MAX_BUFFER_MS 300000
+#define RECORDER_INTERVAL_MS 50
+#define WAV_HEADER_SIZE 44
+#define WAV_HEADER_UPDATE_MS 1000
+#define SPEAKER_TRACKS 64
+#define SPEAKER_FREQUENCY 48000
+#define SPEAKER_BUFFER_MS 1000
+#define SPEAKER_MAX_FRAME (SPEAKER_FREQUENCY / 1000 * 100)
+#define SPEAKER_GAPS 64
+#define SPEAKER_GAP_MS 100
+#define SPEAKER_IDLE_MS 30000
+#define CUSTOM_DEVICE_MAX_GAIN 16.0
+#define TALK_HISTOGRAM_BUCKETS 16
+#define TRANSFER_DEFAULT_PARALLELISM 4
+#define TRANSFER_SWEEP_MS 250
+#define TRANSFER_TAIL_MS 20
+#define STATS_SUB_BUCKET_BITS 4
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+#define STATS_MAX_VALUE (1ULL << 32)
+#define STATS_BUCKETS ((32 - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS)
+#define STATS_ERROR_CODES 8
+#define STATS_MAX_FUNCTIONS 256
+#define LOG_RING_SLOTS 1024
+#define LOG_LINE_SIZE 512
+#define LOG_MAX_CHANNELS 16
+#define LOG_CHANNEL_SIZE 32
+#define LOG_BUFFER_SIZE 65536
+#define LOG_FLUSH_MS 100
+#define TRACE_RING_EVENTS 65536
+#define QUALITY_DEFAULT_INTERVAL_MS 1000
+#define QUALITY_MINIMUM_INTERVAL_MS 1000
+#define QUALITY_DEFAULT_CAPACITY 3600
+#define QUALITY_MAXIMUM_CAPACITY 86400
+#define QUALITY_SWEEP_MS 1000
 
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
 
 #include "php.h"
+#include "php_ini.h"
 #include "php_ts3client.h"
+#include "ts3client_audio.h"
 #include "zend_exceptions.h"
+#include "zend_smart_str.h"
+#include "zend_interfaces.h"
+#if PHP_VERSION_ID >= 80100
+#include "zend_fibers.h"
+#endif
 #include "ext/standard/info.h"
 #include "stdatomic.h"
 #include "stdbool.h"
+#include "limits.h"
 #include "pthread.h"
+#include "sched.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+#include "poll.h"
+#include "sys/eventfd.h"
+#include <sys/syscall.h>
 #include "teamspeak/clientlib.h"
 #include "teamspeak/public_errors.h"
 
+struct Submission;
+
 struct WaitItem
 {
 	struct WaitItem *next;
@@ -22,6 +95,27 @@ struct WaitItem
 	unsigned int result;
 	bool returned;
 	pthread_cond_t cond;
+	uint64_t created_channel;
+	struct FileListing *listing;
+	struct Submission *submission;
+	struct CompletionQueue *notify;
+	atomic_uint *failures;
+};
+
+struct FileEntry
+{
+	char *name;
+	uint64_t size;
+	uint64_t datetime;
+	int type;
+};
+
+/* Entries of a directory the server sent for a requestFileList, collected until its return code arrives. */
+struct FileListing
+{
+	struct FileEntry *entries;
+	size_t count;
+	size_t capacity;
 };
 
 enum ConnectState
@@ -31,642 +125,6353 @@ enum ConnectState
 	CONNECT_STATE_DISCONNECTING,
 };
 
+struct FloodBucket
+{
+	double rate;
+	double burst;
+	double current_rate;
+	double tokens;
+	struct timespec updated;
+};
+
+/*
+ * Talk time of a client in a channel. Bursts are attributed to the channel the
+ * client was in when it started talking; bucket i of the histogram counts
+ * bursts of 2^i to 2^(i+1) - 1 milliseconds, the last one all longer bursts.
+ */
+struct TalkEntry
+{
+	anyID clientID;
+	uint64_t channelID;
+	bool talking;
+	bool whispering;
+	struct timespec started;
+	uint64_t bursts;
+	uint64_t whisper_bursts;
+	uint64_t milliseconds;
+	uint64_t longest;
+	uint64_t histogram[TALK_HISTOGRAM_BUCKETS];
+};
+
+/* Channel a client last started talking in, so its open burst is found without a scan. */
+struct TalkClient
+{
+	bool used;
+	anyID clientID;
+	uint64_t channelID;
+};
+
+/*
+ * Open addressing table of talk entries, keyed by client and channel, next to
+ * one of the talking channel of every client, keyed by client.
+ */
+struct TalkTable
+{
+	struct TalkEntry *entries;
+	size_t capacity;
+	size_t count;
+	struct TalkClient *clients;
+	size_t client_capacity;
+	size_t client_count;
+};
+
+/* Whisper targets of a client as last confirmed by the server; both lists are zero terminated or NULL. */
+struct WhisperList
+{
+	struct WhisperList *next;
+	anyID clientID;
+	uint64 *channels;
+	anyID *clients;
+};
+
 struct ConnectionItem
 {
 	struct ConnectionItem *next;
 	uint64_t serverConnectionHandlerID;
 	_Atomic enum ConnectState expected_state;
 	struct WaitItem state_changed;
+	struct FloodBucket flood;
+	uint64_t created_channel;
+	struct TalkTable talk;
+	struct WhisperList *whisper_lists;
+	atomic_uint established;
+};
+
+ZEND_DECLARE_MODULE_GLOBALS(ts3client)
+
+enum Operation
+{
+	OPERATION_START_CONNECTION = 1,
+	OPERATION_STOP_CONNECTION,
+	OPERATION_CLIENT_MOVE,
+	OPERATION_CHANNEL_DELETE,
+	OPERATION_FLUSH_CLIENT_SELF_UPDATES,
+	OPERATION_FLUSH_CHANNEL_UPDATES,
+	OPERATION_FLUSH_CHANNEL_CREATION,
+	OPERATION_SEND_TEXT_MESSAGE,
+	OPERATION_COUNT
+};
+
+/*
+ * A request handed to the I/O worker. It belongs to the worker until its
+ * completion is posted to the completion queue of the submitting thread.
+ */
+struct Submission
+{
+	zend_long ticket;
+	uint64_t serverConnectionHandlerID;
+	enum Operation operation;
+	zend_long numbers[SUBMISSION_MAX_ARGUMENTS];
+	char *strings[SUBMISSION_MAX_ARGUMENTS];
+	struct timespec deadline;
+	struct CompletionQueue *completions;
+	struct Submission *next;
+	struct timespec not_before;
+};
+
+struct Completion
+{
+	struct Completion *next;
+	zend_long ticket;
+	uint64_t serverConnectionHandlerID;
+	enum Operation operation;
+	unsigned int error;
+	uint64_t channelID;
+};
+
+/* Completions of one PHP thread; the eventfd is readable while some are waiting to be reaped. */
+struct CompletionQueue
+{
+	pthread_mutex_t lock;
+	struct Completion *head;
+	struct Completion **tail;
+	int fd;
+	atomic_int references;
+};
+
+struct SubmissionSlot
+{
+	atomic_size_t sequence;
+	struct Submission *submission;
+};
+
+struct SubmissionQueue
+{
+	struct SubmissionSlot slots[SUBMISSION_QUEUE_SIZE];
+	atomic_size_t enqueue_position;
+	atomic_size_t dequeue_position;
+	atomic_ullong rejected;
+	int doorbell;
+	atomic_bool stopping;
+	bool running;
+	pthread_t worker;
+	/* Submissions held back by flood control, in the order they may be sent. Only the I/O worker uses it. */
+	struct Submission *deferred;
+};
+
+/*
+ * Single producer, single consumer ring of 16 bit samples. Positions only
+ * grow; the capacity is a power of two so they wrap into the buffer by masking.
+ * A producer that must not drop samples can continue in a larger ring linked
+ * as next; it never writes the full ring again once next is published.
+ */
+struct SampleRing
+{
+	int16_t *samples;
+	size_t capacity;
+	atomic_size_t read_position;
+	atomic_size_t write_position;
+	struct SampleRing *_Atomic next;
+};
+
+/*
+ * A WAV file written while recording. The header is written with unknown
+ * sizes first and patched regularly, so the file stays playable even if the
+ * process dies before the recording is stopped.
+ */
+struct WavFile
+{
+	int fd;
+	int frequency;
+	int channels;
+	uint64_t data_bytes;
+	bool failed;
+	struct timespec header_updated;
+};
+
+/*
+ * A custom sound device registered with the client lib. PHP threads fill the
+ * capture ring while holding feed_lock; the pacer thread drains it without
+ * locks. The pacer writes playback into playback_writing and grows the chain
+ * starting at playback_reading, which consumers drain holding record_lock.
+ * Threads using a device outside of device_mutex hold a reference.
+ */
+struct CustomDevice
+{
+	struct CustomDevice *next;
+	char *id;
+	char *display_name;
+	int capture_frequency;
+	int capture_channels;
+	int playback_frequency;
+	int playback_channels;
+	struct SampleRing capture;
+	pthread_mutex_t feed_lock;
+	bool has_carry;
+	char carry;
+	bool capture_active;
+	_Atomic uint64_t capture_underruns;
+	_Atomic float capture_gain;
+	atomic_int capture_peak;
+	atomic_int capture_rms;
+	struct SampleRing playback;
+	struct SampleRing *playback_writing;
+	struct SampleRing *playback_reading;
+	atomic_bool playback_capturing;
+	_Atomic uint64_t playback_overruns;
+	_Atomic float playback_gain;
+	atomic_int playback_peak;
+	atomic_int playback_rms;
+	pthread_mutex_t record_lock;
+	struct WavFile *recording;
+	atomic_int references;
+};
+
+struct Pacer
+{
+	pthread_t thread;
+	bool running;
+	atomic_bool stopping;
+};
+
+enum SpeakerState
+{
+	SPEAKER_FREE,
+	SPEAKER_CLAIMED,
+	SPEAKER_ACTIVE,
+	SPEAKER_CLOSING
+};
+
+/* Silence to insert once the ring has been read up to position, so that the track continues at offset. */
+struct SpeakerGap
+{
+	size_t position;
+	uint64_t offset;
+};
+
+/*
+ * The voice of one client while speaker recording is active. The audio thread
+ * of the connection fills the ring and the gap list; the recorder thread
+ * drains both into a mono WAV file whose timeline starts with the first
+ * frame, so pauses in speech become silence. Stereo voices are downmixed.
+ */
+struct SpeakerTrack
+{
+	atomic_int state;
+	atomic_int writers;
+	uint64_t serverConnectionHandlerID;
+	anyID clientID;
+	struct timespec started;
+	struct timespec started_monotonic;
+	uint64_t timeline;
+	atomic_llong last_active;
+	atomic_int peak;
+	atomic_int rms;
+	struct SampleRing samples;
+	struct SpeakerGap gaps[SPEAKER_GAPS];
+	atomic_size_t gap_read;
+	atomic_size_t gap_write;
+	_Atomic uint64_t overruns;
+	char *path;
+	struct WavFile *file;
+	uint64_t written;
+};
+
+/*
+ * The tracks are allocated when speaker recording is first started and live
+ * until the client lib is destroyed, so the audio thread never allocates and
+ * never has to synchronize with their release. lock serializes PHP threads
+ * and the recorder thread.
+ */
+struct SpeakerRecorder
+{
+	struct SpeakerTrack *tracks;
+	char *directory;
+	atomic_bool active;
+	_Atomic uint64_t dropped;
+	pthread_mutex_t lock;
+};
+
+enum TransferState
+{
+	TRANSFER_QUEUED = 1,
+	TRANSFER_STARTING,
+	TRANSFER_RUNNING,
+	TRANSFER_DONE,
+	TRANSFER_FAILED,
+	TRANSFER_CANCELED
+};
+
+/*
+ * A file transfer of the transfer manager. The request fields never change
+ * after queueing; everything else is guarded by the lock of the manager.
+ */
+struct Transfer
+{
+	struct Transfer *next;
+	uint64_t id;
+	uint64_t serverConnectionHandlerID;
+	uint64_t channelID;
+	char *channel_password;
+	char *file;
+	char *directory;
+	bool upload;
+	bool overwrite;
+	bool resume;
+	enum TransferState state;
+	bool cancel;
+	anyID transfer_id;
+	unsigned int error;
+	uint64_t size;
+	uint64_t done;
+	float speed;
+};
+
+/* Parallelism of one connection; running counts its transfers that were started and have not ended. */
+struct TransferConnection
+{
+	struct TransferConnection *next;
+	uint64_t serverConnectionHandlerID;
+	int parallelism;
+	int running;
+};
+
+/*
+ * Transfers are queued by PHP threads and started in queue order by the
+ * scheduler thread, as long as their connection has a free slot. The client
+ * lib reports their end; the scheduler polls their progress. Neither the
+ * scheduler nor the callbacks call into the client lib while holding lock.
+ */
+struct TransferManager
+{
+	struct Pacer scheduler;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t ended;
+	bool pending;
+	struct Transfer *transfers;
+	struct TransferConnection *connections;
+	uint64_t next_id;
+};
+
+/* One sample of the connection quality; every value is a double so samples can be aggregated field by field. */
+struct QualityPoint
+{
+	long long time;
+	double ping;
+	double ping_deviation;
+	double packetloss;
+	double packetloss_speech;
+	double bandwidth_sent;
+	double bandwidth_received;
+	double packets_sent;
+	double packets_received;
+};
+
+/* The most recent samples of one connection in a ring; head is where the next one goes. */
+struct QualitySeries
+{
+	struct QualitySeries *next;
+	uint64_t serverConnectionHandlerID;
+	long long interval;
+	struct timespec due;
+	struct QualityPoint *points;
+	size_t capacity;
+	size_t count;
+	size_t head;
+	unsigned long long failed;
+	unsigned int last_error;
+};
+
+/*
+ * The sampler thread asks the server for the connection info of every
+ * connection that is due, pipelined, and appends what the client lib then
+ * reports to the series of the connection. It does not call into the client
+ * lib while holding lock.
+ */
+struct QualitySampler
+{
+	struct Pacer sampler;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	struct QualitySeries *series;
 };
 
+/*
+ * The client lib and the tables below are shared by every PHP thread of the
+ * process. Pending return codes are spread over buckets so that threads
+ * pipelining many requests do not make each other's lookups slower.
+ */
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-static struct WaitItem *wait_items = NULL;
+static pthread_mutex_t device_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct WaitItem *wait_items[WAIT_ITEM_BUCKETS];
 static struct ConnectionItem *connection_items = NULL;
 static pid_t pid = 0;
+static atomic_bool client_lib_ready = ATOMIC_VAR_INIT(false);
+static bool reinitialize_after_fork = false;
+static bool inherited_client_lib = false;
+static struct SubmissionQueue submissions;
+static struct CustomDevice *custom_devices = NULL;
+static struct Pacer pacer;
+static struct Pacer recorder;
+static struct SpeakerRecorder speakers = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static struct TransferManager transfers = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .ended = PTHREAD_COND_INITIALIZER, .next_id = 1 };
+static struct QualitySampler quality = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+static const struct AudioKernels *audio_kernels = &audio_kernels_scalar;
+static double flood_default_rate = 0;
+static double flood_default_burst = FLOOD_DEFAULT_BURST;
 
-static void to_asciiz(char** pointer, size_t length)
+/*
+ * Latency statistics of every PHP function and of the waits for the server
+ * inside them, in microseconds. Histograms are log-linear like HDR
+ * histograms: 16 linear sub-buckets per power of two keep every value within
+ * 1/16 of its bucket. Each PHP thread records into a shard of its own, the
+ * client lib and native threads share the native shard; readers add the
+ * shards up without stopping the writers.
+ */
+struct Histogram
 {
-	char* result;
-	if (*pointer)
-	{
-		result  = strndup(*pointer, length);
-	}
-	else
+	atomic_uint buckets[STATS_BUCKETS];
+	atomic_ullong count;
+	atomic_ullong sum;
+	atomic_ullong max;
+};
+
+struct FunctionStats
+{
+	struct Histogram calls;
+	struct Histogram waits;
+	atomic_ullong timeouts;
+	struct
 	{
-		result = NULL;
-	}
-	*pointer = result;
-}
+		atomic_uint code;
+		atomic_ullong count;
+	} errors[STATS_ERROR_CODES];
+	atomic_ullong other_errors;
+};
 
-static struct WaitItem *create_return_code_item()
+struct StatsShard
 {
-	static atomic_uint next = ATOMIC_VAR_INIT(1);
-	struct WaitItem *result = malloc(sizeof(struct WaitItem));
-	result->return_code = next++;
-	snprintf(result->return_code_text, sizeof(result->return_code_text), "%u", result->return_code);
-	result->returned = false;
-	pthread_cond_init(&result->cond, NULL);
+	struct StatsShard *next;
+	bool retired;
+	_Atomic(struct FunctionStats *) functions[STATS_MAX_FUNCTIONS];
+};
 
-	pthread_mutex_lock(&mutex);
-	result->next = wait_items;
-	wait_items = result;
-	pthread_mutex_unlock(&mutex);
+/* The start of a call of a PHP function; the function is -1 if the name table is full. */
+struct StatsScope
+{
+	int function;
+	int previous;
+	const char *previous_activity;
+	struct timespec started;
+};
 
-	return result;
-}
+static struct
+{
+	pthread_mutex_t lock;
+	struct StatsShard *shards;
+	struct StatsShard native;
+	atomic_int function_count;
+	const char *functions[STATS_MAX_FUNCTIONS];
+} stats = { .lock = PTHREAD_MUTEX_INITIALIZER };
 
-static struct WaitItem *remove_return_code_item(unsigned int return_code)
+/* What the calling thread is doing, the name of a PHP function or callback. */
+static _Thread_local const char *current_activity = NULL;
+
+static unsigned int stats_bucket(uint64_t microseconds)
 {
-	pthread_mutex_lock(&mutex);
-	struct WaitItem **parent = &wait_items, *item;
-	while (true)
-	{
-		item = *parent;
-		if (item == NULL)
-		{
-			break;
-		}
-		if (item->return_code == return_code)
-		{
-			*parent = item->next;
-			break;
-		}
-		parent = &item->next;
-	}
-	pthread_mutex_unlock(&mutex);
-	return item;
+	if (microseconds >= STATS_MAX_VALUE)
+		microseconds = STATS_MAX_VALUE - 1;
+	if (microseconds < STATS_SUB_BUCKETS)
+		return microseconds;
+	unsigned int exponent = 63 - __builtin_clzll(microseconds);
+	return (exponent - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS + ((microseconds >> (exponent - STATS_SUB_BUCKET_BITS)) & (STATS_SUB_BUCKETS - 1));
 }
 
-static void free_return_code_item(struct WaitItem* item)
+/* The highest value that falls into a bucket. */
+static uint64_t stats_bucket_value(unsigned int bucket)
 {
-	pthread_cond_destroy(&item->cond);
-	free(item);
+	if (bucket < STATS_SUB_BUCKETS)
+		return bucket;
+	unsigned int shift = bucket / STATS_SUB_BUCKETS - 1;
+	uint64_t mantissa = bucket % STATS_SUB_BUCKETS + STATS_SUB_BUCKETS;
+	return ((mantissa + 1) << shift) - 1;
 }
 
-static struct ConnectionItem *get_connection_item(uint64_t serverConnectionHandlerID)
+static long long elapsed_us(const struct timespec *started)
 {
-	pthread_mutex_lock(&mutex);
-	struct ConnectionItem *item = connection_items;
-	while (item != NULL && item->serverConnectionHandlerID != serverConnectionHandlerID)
-		item = item->next;
-
-	if (item == NULL)
-	{
-		item = malloc(sizeof(struct ConnectionItem));
-		item->serverConnectionHandlerID = serverConnectionHandlerID;
-		item->expected_state = CONNECT_STATE_NONE;
-		item->state_changed.returned = false;
-		pthread_cond_init(&item->state_changed.cond, NULL);
-
-		item->next = connection_items;
-		connection_items = item;
-	}
-	pthread_mutex_unlock(&mutex);
-	return item;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - started->tv_sec) * 1000000LL + (now.tv_nsec - started->tv_nsec) / 1000;
 }
 
-static void free_connection_item(struct ConnectionItem* item)
+/* Returns whether the value is the new maximum. */
+static bool record_histogram(struct Histogram *histogram, uint64_t microseconds)
 {
-	pthread_cond_destroy(&item->state_changed.cond);
-	free(item);
+	atomic_fetch_add_explicit(&histogram->buckets[stats_bucket(microseconds)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->sum, microseconds, memory_order_relaxed);
+	unsigned long long max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+	while (microseconds > max)
+	{
+		if (atomic_compare_exchange_weak_explicit(&histogram->max, &max, microseconds, memory_order_relaxed, memory_order_relaxed))
+			return true;
+	}
+	return false;
 }
 
-static void delete_connection_item(uint64_t serverConnectionHandlerID)
+static void record_error(struct FunctionStats *function, unsigned int error)
 {
-	pthread_mutex_lock(&mutex);
-	struct ConnectionItem **parent = &connection_items, *item;
-	while (true)
+	for (int i = 0; i < STATS_ERROR_CODES; ++i)
 	{
-		item = *parent;
-		if (item == NULL)
-		{
-			break;
-		}
-		if (item->serverConnectionHandlerID == serverConnectionHandlerID)
+		unsigned int code = atomic_load_explicit(&function->errors[i].code, memory_order_relaxed);
+		if (code == 0 && atomic_compare_exchange_strong(&function->errors[i].code, &code, error))
+			code = error;
+		if (code == error)
 		{
-			*parent = item->next;
-			free_connection_item(item);
-			break;
+			atomic_fetch_add_explicit(&function->errors[i].count, 1, memory_order_relaxed);
+			return;
 		}
-		parent = &item->next;
 	}
-	pthread_mutex_unlock(&mutex);
+	atomic_fetch_add_explicit(&function->other_errors, 1, memory_order_relaxed);
 }
 
-static void set_result(struct WaitItem *item, unsigned int return_code)
+/* Assigns an index in the name table to a function on its first call. */
+static int register_stats_function(atomic_int *id, const char *name)
 {
-	pthread_mutex_lock(&mutex);
-	if (item->returned == false)
+	int result = atomic_load(id);
+	if (result >= 0)
+		return result;
+	pthread_mutex_lock(&stats.lock);
+	result = atomic_load(id);
+	int count = atomic_load(&stats.function_count);
+	if (result < 0 && count < STATS_MAX_FUNCTIONS)
 	{
-		item->result = return_code;
-		item->returned = true;
-		pthread_cond_signal(&item->cond);
+		result = count;
+		stats.functions[result] = name;
+		atomic_store(id, result);
+		atomic_store(&stats.function_count, count + 1);
 	}
-	pthread_mutex_unlock(&mutex);
+	pthread_mutex_unlock(&stats.lock);
+	return result;
 }
 
-static void wait_for(struct WaitItem *item)
+static struct FunctionStats *get_function_stats(struct StatsShard *shard, int function)
 {
-	pthread_mutex_lock(&mutex);
-	struct timespec timeout;
-	clock_gettime(CLOCK_REALTIME, &timeout);
-	timeout.tv_sec += TIMEOUT;
-
-	while (item->returned == false && pthread_cond_timedwait(&item->cond, &mutex, &timeout) == 0);
-	if (item->returned)
+	struct FunctionStats *result = atomic_load_explicit(&shard->functions[function], memory_order_acquire);
+	if (result == NULL)
 	{
-		item->returned = false;
+		struct FunctionStats *expected = NULL;
+		result = calloc(1, sizeof(struct FunctionStats));
+		if (atomic_compare_exchange_strong(&shard->functions[function], &expected, result) == false)
+		{
+			free(result);
+			result = expected;
+		}
 	}
-	else
+	return result;
+}
+
+/* The shard of the calling PHP thread. Shards of finished threads are handed to new ones. */
+static struct StatsShard *get_stats_shard(void)
+{
+	struct StatsShard *shard = TS3CLIENT_G(stats);
+	if (shard != NULL)
+		return shard;
+	pthread_mutex_lock(&stats.lock);
+	shard = stats.shards;
+	while (shard != NULL && shard->retired == false)
+		shard = shard->next;
+	if (shard == NULL)
 	{
-		item->result = ERROR_connection_lost;
+		shard = calloc(1, sizeof(struct StatsShard));
+		shard->next = stats.shards;
+		stats.shards = shard;
 	}
+	shard->retired = false;
+	pthread_mutex_unlock(&stats.lock);
+	TS3CLIENT_G(stats) = shard;
+	return shard;
+}
 
-	pthread_mutex_unlock(&mutex);
+static void enter_stats_scope(struct StatsScope *scope, atomic_int *id, const char *name)
+{
+	scope->function = register_stats_function(id, name);
+	scope->previous = TS3CLIENT_G(stats_function);
+	scope->previous_activity = current_activity;
+	TS3CLIENT_G(stats_function) = scope->function;
+	current_activity = name;
+	clock_gettime(CLOCK_MONOTONIC, &scope->started);
 }
 
-static unsigned int handle_return_code(struct WaitItem *item, unsigned int error)
+static void leave_stats_scope(const struct StatsScope *scope, const zval *return_value)
 {
-	if (error == ERROR_ok)
-	{
-		wait_for(item);
-		error = item->result;
-	}
-	else
-	{
-		remove_return_code_item(item->return_code);
-	}
-	free_return_code_item(item);
-	return error;
+	TS3CLIENT_G(stats_function) = scope->previous;
+	current_activity = scope->previous_activity;
+	if (scope->function < 0)
+		return;
+	struct FunctionStats *function = get_function_stats(get_stats_shard(), scope->function);
+	record_histogram(&function->calls, elapsed_us(&scope->started));
+	if (Z_TYPE_P(return_value) == IS_LONG && Z_LVAL_P(return_value) != ERROR_ok)
+		record_error(function, Z_LVAL_P(return_value));
 }
 
-static void onServerErrorEvent(uint64 serverConnectionHandlerID, const char* errorMessage, unsigned int error, const char* returnCode, const char* extraMessage)
+static void record_wait_in(struct StatsShard *shard, int function, const struct timespec *started, size_t timeouts)
 {
-	(void)serverConnectionHandlerID;
-	(void)errorMessage;
-	(void)extraMessage;
-	if (returnCode)
-	{
-		char* endptr;
-		long int return_code = strtol(returnCode, &endptr, 10);
-		if (return_code > 0)
-		{
-			struct WaitItem *item = remove_return_code_item(return_code);
-			set_result(item, error);
-		}
-	}
-	else
-	{
-		struct ConnectionItem *item = get_connection_item(serverConnectionHandlerID);
-		enum ConnectState expected = atomic_load(&item->expected_state);
-		if (expected == CONNECT_STATE_CONNECTING)
-			set_result(&item->state_changed, error);
-	}
+	if (function < 0)
+		return;
+	struct FunctionStats *stats = get_function_stats(shard, function);
+	record_histogram(&stats->waits, elapsed_us(started));
+	if (timeouts > 0)
+		atomic_fetch_add_explicit(&stats->timeouts, timeouts, memory_order_relaxed);
 }
 
-static void onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber)
+/* Records a wait of a PHP thread for the function it is in. */
+static void record_wait(const struct timespec *started, size_t timeouts)
 {
-	struct ConnectionItem *item = get_connection_item(serverConnectionHandlerID);
-	const bool connected = newStatus == STATUS_CONNECTION_ESTABLISHED;
-	const bool disconnected = newStatus == STATUS_DISCONNECTED;
-	if (!connected && !disconnected)
-		return;
+	record_wait_in(get_stats_shard(), TS3CLIENT_G(stats_function), started, timeouts);
+}
 
-	switch (atomic_load(&item->expected_state))
-	{
-		case CONNECT_STATE_NONE: return;
-		case CONNECT_STATE_CONNECTING:
-			if (disconnected && errorNumber == ERROR_ok)
-				errorNumber = ERROR_undefined;
-			break;
-		case CONNECT_STATE_DISCONNECTING:
-			if (connected && errorNumber == ERROR_ok)
-				errorNumber = ERROR_undefined;
-			break;
-	}
-	set_result(&item->state_changed, errorNumber);
+static bool initialize(void);
+
+/*
+ * Every PHP function of the extension records its latency and error codes and
+ * fails with ERROR_undefined if this process has no usable client lib.
+ */
+#define TS3_FUNCTION(name) \
+	static void ts3client_##name##_body(INTERNAL_FUNCTION_PARAMETERS); \
+	PHP_FUNCTION(ts3client_##name) \
+	{ \
+		static atomic_int id = ATOMIC_VAR_INIT(-1); \
+		struct StatsScope scope; \
+		enter_stats_scope(&scope, &id, "ts3client_" #name); \
+		if (initialize()) \
+			ts3client_##name##_body(INTERNAL_FUNCTION_PARAM_PASSTHRU); \
+		else \
+			RETVAL_LONG(ERROR_undefined); \
+		leave_stats_scope(&scope, return_value); \
+	} \
+	static void ts3client_##name##_body(INTERNAL_FUNCTION_PARAMETERS)
+
+static void sum_histogram(const struct Histogram *histogram, uint64_t *buckets, uint64_t *count, uint64_t *sum, uint64_t *max)
+{
+	for (int i = 0; i < STATS_BUCKETS; ++i)
+		buckets[i] += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+	*count += atomic_load_explicit(&histogram->count, memory_order_relaxed);
+	*sum += atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+	uint64_t shard_max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+	*max = shard_max > *max ? shard_max : *max;
 }
 
-static void free_return_codes(struct WaitItem* item)
+static void reset_histogram(struct Histogram *histogram)
 {
-	if (item != NULL)
-	{
-		free_return_codes(item->next);
-		free_return_code_item(item);
-	}
+	for (int i = 0; i < STATS_BUCKETS; ++i)
+		atomic_store_explicit(&histogram->buckets[i], 0, memory_order_relaxed);
+	atomic_store_explicit(&histogram->count, 0, memory_order_relaxed);
+	atomic_store_explicit(&histogram->sum, 0, memory_order_relaxed);
+	atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
 }
 
-static void free_connections(struct ConnectionItem* item)
+static uint64_t histogram_percentile(const uint64_t *buckets, uint64_t count, uint64_t max, double percentile)
 {
-	if (item != NULL)
+	uint64_t rank = (uint64_t)(count * percentile + 0.5), seen = 0;
+	if (rank == 0)
+		rank = 1;
+	for (int i = 0; i < STATS_BUCKETS; ++i)
 	{
-		free_connections(item->next);
-		free_connection_item(item);
+		seen += buckets[i];
+		if (seen >= rank)
+		{
+			uint64_t value = stats_bucket_value(i);
+			return value < max ? value : max;
+		}
 	}
+	return max;
 }
 
-void deinialize(void)
+/* Iterates over the shards of all threads, the native one included. The caller must hold stats.lock. */
+#define FOREACH_STATS_SHARD(shard) \
+	for (struct StatsShard *shard = &stats.native; shard != NULL; shard = shard == &stats.native ? stats.shards : shard->next)
+
+struct HistogramSummary
 {
-	if (pid)
-	{
-		ts3client_destroyClientLib();
-		free_return_codes(wait_items);
-		wait_items = NULL;
-		free_connections(connection_items);
-		connection_items = NULL;
-	}
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t buckets[STATS_BUCKETS];
+};
+
+struct FunctionSummary
+{
+	struct HistogramSummary calls;
+	struct HistogramSummary waits;
+	uint64_t timeouts;
+	uint64_t other_errors;
+	size_t error_count;
+	unsigned int error_codes[STATS_ERROR_CODES];
+	uint64_t error_counts[STATS_ERROR_CODES];
+};
+
+static void finish_summary(struct HistogramSummary *summary)
+{
+	summary->p50 = histogram_percentile(summary->buckets, summary->count, summary->max, 0.5);
+	summary->p99 = histogram_percentile(summary->buckets, summary->count, summary->max, 0.99);
+	summary->p999 = histogram_percentile(summary->buckets, summary->count, summary->max, 0.999);
 }
 
-static bool initialize(void)
+/* Adds up the shards of a function. The caller must hold stats.lock. */
+static void summarize_function(int function, struct FunctionSummary *summary, bool reset)
 {
-	if (pid == 0)
+	memset(summary, 0, sizeof(*summary));
+	FOREACH_STATS_SHARD(shard)
 	{
-		struct ClientUIFunctions funcs;
-		memset(&funcs, 0, sizeof(funcs));
-		funcs.onConnectStatusChangeEvent    = onConnectStatusChangeEvent;
-		funcs.onServerErrorEvent            = onServerErrorEvent;
-		if (ts3client_initClientLib(&funcs, NULL, LogType_NONE, NULL, NULL) == ERROR_ok)
+		struct FunctionStats *stats = atomic_load_explicit(&shard->functions[function], memory_order_acquire);
+		if (stats == NULL)
+			continue;
+		sum_histogram(&stats->calls, summary->calls.buckets, &summary->calls.count, &summary->calls.sum, &summary->calls.max);
+		sum_histogram(&stats->waits, summary->waits.buckets, &summary->waits.count, &summary->waits.sum, &summary->waits.max);
+		summary->timeouts += atomic_load_explicit(&stats->timeouts, memory_order_relaxed);
+		summary->other_errors += atomic_load_explicit(&stats->other_errors, memory_order_relaxed);
+		for (int i = 0; i < STATS_ERROR_CODES; ++i)
 		{
-			pid = getpid();
-			atexit(&deinialize);
-			return true;
+			unsigned int code = atomic_load_explicit(&stats->errors[i].code, memory_order_relaxed);
+			uint64_t count = atomic_load_explicit(&stats->errors[i].count, memory_order_relaxed);
+			if (code == 0)
+				break;
+			size_t j = 0;
+			while (j < summary->error_count && summary->error_codes[j] != code)
+				++j;
+			if (j == summary->error_count && j == sizeof(summary->error_codes) / sizeof(*summary->error_codes))
+				summary->other_errors += count;
+			else
+			{
+				if (j == summary->error_count)
+				{
+					summary->error_codes[summary->error_count++] = code;
+					summary->error_counts[j] = 0;
+				}
+				summary->error_counts[j] += count;
+			}
+		}
+		if (reset)
+		{
+			reset_histogram(&stats->calls);
+			reset_histogram(&stats->waits);
+			atomic_store_explicit(&stats->timeouts, 0, memory_order_relaxed);
+			atomic_store_explicit(&stats->other_errors, 0, memory_order_relaxed);
+			for (int i = 0; i < STATS_ERROR_CODES; ++i)
+				atomic_store_explicit(&stats->errors[i].count, 0, memory_order_relaxed);
 		}
-		else return false;
 	}
-	else return pid == getpid();
+	finish_summary(&summary->calls);
+	finish_summary(&summary->waits);
 }
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientLibVersion, 0)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/*
+ * Optional profiling of the extension's locks and of the client lib
+ * callbacks, enabled with ts3client.lock_profiling. Locks record how long
+ * they were waited for and held; callbacks record how long they ran and how
+ * long they waited for locks, which is the time event delivery was stalled.
+ * For the worst wait and hold of every lock the thread that caused it is
+ * kept: the PHP function or callback it was in, or "native" otherwise.
+ */
+struct LockProfile
+{
+	const char *name;
+	pthread_mutex_t *lock;
+	atomic_ullong contended;
+	struct Histogram wait;
+	struct Histogram hold;
+	atomic_llong worst_wait_at;
+	_Atomic(const char *) worst_wait_by;
+	atomic_llong worst_hold_at;
+	_Atomic(const char *) worst_hold_by;
+	struct timespec acquired;
+};
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientLibVersionNumber, 0)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+struct CallbackProfile
+{
+	struct CallbackProfile *next;
+	const char *name;
+	atomic_bool registered;
+	struct Histogram duration;
+	struct Histogram lock_wait;
+	atomic_llong worst_at;
+};
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_spawnNewServerConnectionHandler, 0)
-	ZEND_ARG_INFO(0, port)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+struct CallbackScope
+{
+	struct CallbackProfile *profile;
+	const char *previous;
+	struct timespec started;
+};
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_destroyServerConnectionHandler, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-ZEND_END_ARG_INFO()
+static atomic_bool lock_profiling = ATOMIC_VAR_INIT(false);
+static _Atomic(struct CallbackProfile *) callback_profiles = NULL;
+static _Thread_local struct CallbackProfile *current_callback = NULL;
+
+static struct LockProfile lock_profiles[] = {
+	{ .name = "mutex", .lock = &mutex },
+	{ .name = "device_mutex", .lock = &device_mutex },
+	{ .name = "init_mutex", .lock = &init_mutex },
+	{ .name = "transfers", .lock = &transfers.lock },
+	{ .name = "speakers", .lock = &speakers.lock },
+	{ .name = "quality", .lock = &quality.lock },
+};
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_createIdentity, 0)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static struct LockProfile *get_lock_profile(pthread_mutex_t *lock)
+{
+	for (size_t i = 0; i < sizeof(lock_profiles) / sizeof(*lock_profiles); ++i)
+	{
+		if (lock_profiles[i].lock == lock)
+			return &lock_profiles[i];
+	}
+	return NULL;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_identityStringToUniqueIdentifier, 0)
-	ZEND_ARG_INFO(0, identityString)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static long long realtime_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getErrorMessage, 0)
-	ZEND_ARG_INFO(0, errorCode)
-	ZEND_ARG_INFO(1, error)
-ZEND_END_ARG_INFO()
+static long long timespec_diff_us(const struct timespec *from, const struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000000LL + (to->tv_nsec - from->tv_nsec) / 1000;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_startConnection, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, identity)
-	ZEND_ARG_INFO(0, ip)
-	ZEND_ARG_INFO(0, port)
-	ZEND_ARG_INFO(0, nickname)
-	ZEND_ARG_INFO(0, defaultChannelID)
-	ZEND_ARG_INFO(0, defaultChannelPassword)
-	ZEND_ARG_INFO(0, serverPassword)
-ZEND_END_ARG_INFO()
+static void end_lock_hold(struct LockProfile *profile)
+{
+	if (record_histogram(&profile->hold, elapsed_us(&profile->acquired)))
+	{
+		atomic_store(&profile->worst_hold_at, realtime_ms());
+		atomic_store(&profile->worst_hold_by, current_activity != NULL ? current_activity : "native");
+	}
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_stopConnection, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, quitMessage)
-ZEND_END_ARG_INFO()
+static void lock_mutex(pthread_mutex_t *lock)
+{
+	struct LockProfile *profile;
+	if (atomic_load_explicit(&lock_profiling, memory_order_relaxed) == false || (profile = get_lock_profile(lock)) == NULL)
+	{
+		pthread_mutex_lock(lock);
+		return;
+	}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientMove, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, newChannelID)
-	ZEND_ARG_INFO(0, password)
-ZEND_END_ARG_INFO()
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	if (pthread_mutex_trylock(lock) != 0)
+	{
+		atomic_fetch_add_explicit(&profile->contended, 1, memory_order_relaxed);
+		pthread_mutex_lock(lock);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &profile->acquired);
+	long long waited = timespec_diff_us(&started, &profile->acquired);
+	if (record_histogram(&profile->wait, waited))
+	{
+		atomic_store(&profile->worst_wait_at, realtime_ms());
+		atomic_store(&profile->worst_wait_by, current_activity != NULL ? current_activity : "native");
+	}
+	if (current_callback != NULL)
+		record_histogram(&current_callback->lock_wait, waited);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientVariables, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-ZEND_END_ARG_INFO()
+static void unlock_mutex(pthread_mutex_t *lock)
+{
+	struct LockProfile *profile;
+	if (atomic_load_explicit(&lock_profiling, memory_order_relaxed) && (profile = get_lock_profile(lock)) != NULL)
+		end_lock_hold(profile);
+	pthread_mutex_unlock(lock);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientKickFromChannel, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, kickReason)
-ZEND_END_ARG_INFO()
+/* pthread_cond_timedwait for profiled locks; the time spent waiting on the condition does not count as holding the lock. */
+static int wait_mutex_cond(pthread_cond_t *cond, pthread_mutex_t *lock, const struct timespec *timeout)
+{
+	struct LockProfile *profile;
+	if (atomic_load_explicit(&lock_profiling, memory_order_relaxed) == false || (profile = get_lock_profile(lock)) == NULL)
+		return pthread_cond_timedwait(cond, lock, timeout);
+	end_lock_hold(profile);
+	int result = pthread_cond_timedwait(cond, lock, timeout);
+	clock_gettime(CLOCK_MONOTONIC, &profile->acquired);
+	return result;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientKickFromServer, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, kickReason)
-ZEND_END_ARG_INFO()
+static void enter_callback(struct CallbackScope *scope, struct CallbackProfile *profile)
+{
+	scope->profile = NULL;
+	if (atomic_load_explicit(&lock_profiling, memory_order_relaxed) == false)
+		return;
+	bool registered = false;
+	if (atomic_compare_exchange_strong(&profile->registered, &registered, true))
+	{
+		profile->next = atomic_load(&callback_profiles);
+		while (atomic_compare_exchange_weak(&callback_profiles, &profile->next, profile) == false);
+	}
+	scope->profile = profile;
+	scope->previous = current_activity;
+	current_callback = profile;
+	current_activity = profile->name;
+	clock_gettime(CLOCK_MONOTONIC, &scope->started);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelDelete, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, force)
-ZEND_END_ARG_INFO()
+static void leave_callback(const struct CallbackScope *scope)
+{
+	if (scope->profile == NULL)
+		return;
+	current_callback = NULL;
+	current_activity = scope->previous;
+	if (record_histogram(&scope->profile->duration, elapsed_us(&scope->started)))
+		atomic_store(&scope->profile->worst_at, realtime_ms());
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelMove, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, newChannelParentID)
-	ZEND_ARG_INFO(0, newChannelOrder)
-ZEND_END_ARG_INFO()
+static void summarize_histogram(struct Histogram *histogram, struct HistogramSummary *summary, bool reset)
+{
+	memset(summary, 0, sizeof(*summary));
+	sum_histogram(histogram, summary->buckets, &summary->count, &summary->sum, &summary->max);
+	finish_summary(summary);
+	if (reset)
+		reset_histogram(histogram);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestSendPrivateTextMsg, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, message)
-	ZEND_ARG_INFO(0, targetClientID)
-ZEND_END_ARG_INFO()
+static ZEND_INI_MH(OnUpdateLockProfiling)
+{
+	atomic_store(&lock_profiling, zend_ini_parse_bool(new_value));
+	return SUCCESS;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestSendChannelTextMsg, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, message)
-	ZEND_ARG_INFO(0, targetChannelID)
-ZEND_END_ARG_INFO()
+/* Every client lib callback records how long it ran and waited for locks. */
+#define TS3_CALLBACK(callback, parameters, arguments) \
+	static void callback##Body parameters; \
+	static void callback parameters \
+	{ \
+		static struct CallbackProfile profile = { .name = #callback }; \
+		struct CallbackScope scope; \
+		enter_callback(&scope, &profile); \
+		callback##Body arguments; \
+		leave_callback(&scope); \
+	} \
+	static void callback##Body parameters
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestSendServerTextMsg, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, message)
-ZEND_END_ARG_INFO()
+/*
+ * Optional request tracing, enabled with ts3client.tracing. Every request
+ * with a return code records when its return code was allocated, when the
+ * client lib accepted it, when the server's answer arrived on the callback
+ * thread and when the waiting thread woke up. The events go into a ring that
+ * overwrites the oldest ones, so ts3client_dumpTrace() always has the most
+ * recent requests. Writers claim a slot by position and publish it with its
+ * sequence; readers skip slots that are being overwritten.
+ */
+enum TracePhase
+{
+	TRACE_ALLOCATED,
+	TRACE_ISSUED,
+	TRACE_ANSWERED,
+	TRACE_WOKEN,
+	TRACE_TIMED_OUT,
+};
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestConnectionInfo, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-ZEND_END_ARG_INFO()
+struct TraceEvent
+{
+	atomic_size_t sequence;
+	long long time;
+	const char *activity;
+	unsigned int return_code;
+	unsigned int error;
+	pid_t thread;
+	enum TracePhase phase;
+};
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelSubscribeAll, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-ZEND_END_ARG_INFO()
+static atomic_bool tracing = ATOMIC_VAR_INIT(false);
+static atomic_size_t trace_head = ATOMIC_VAR_INIT(0);
+static struct TraceEvent trace_events[TRACE_RING_EVENTS];
+static _Thread_local pid_t trace_thread = 0;
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelUnsubscribeAll, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-ZEND_END_ARG_INFO()
+static void trace(enum TracePhase phase, unsigned int return_code, unsigned int error)
+{
+	if (atomic_load_explicit(&tracing, memory_order_relaxed) == false)
+		return;
+	if (trace_thread == 0)
+		trace_thread = syscall(SYS_gettid);
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	size_t position = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+	struct TraceEvent *event = &trace_events[position % TRACE_RING_EVENTS];
+	atomic_store_explicit(&event->sequence, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	event->time = now.tv_sec * 1000000000LL + now.tv_nsec;
+	event->activity = current_activity;
+	event->return_code = return_code;
+	event->error = error;
+	event->thread = trace_thread;
+	event->phase = phase;
+	atomic_store_explicit(&event->sequence, position + 1, memory_order_release);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientID, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* Only the thread that forked survives in the child and it has a new thread ID. */
+static void reset_trace_ring(void)
+{
+	trace_thread = 0;
+	if (atomic_load(&tracing) == false)
+		return;
+	for (size_t i = 0; i < TRACE_RING_EVENTS; ++i)
+		atomic_init(&trace_events[i].sequence, 0);
+	atomic_init(&trace_head, 0);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionStatus, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static ZEND_INI_MH(OnUpdateTracing)
+{
+	atomic_store(&tracing, zend_ini_parse_bool(new_value));
+	return SUCCESS;
+}
 
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionVariableAsUInt64, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static void to_asciiz(char** pointer, size_t length)
+{
+	char* result;
+	if (*pointer)
+	{
+		result  = strndup(*pointer, length);
+	}
+	else
+	{
+		result = NULL;
+	}
+	*pointer = result;
+}
 
+/* Nobody waits for items of a submission; the answer is posted as its completion instead. */
+/* Items of a batch share a failure counter, so the batch can stop without looking at every item. */
+static struct WaitItem *create_wait_item(struct Submission *submission, atomic_uint *failures)
+{
+	static atomic_uint next = ATOMIC_VAR_INIT(1);
+	struct WaitItem *result = malloc(sizeof(struct WaitItem));
+	result->return_code = next++;
+	snprintf(result->return_code_text, sizeof(result->return_code_text), "%u", result->return_code);
+	result->returned = false;
+	result->created_channel = 0;
+	result->listing = NULL;
+	result->submission = submission;
+	result->notify = NULL;
+	result->failures = failures;
+	pthread_cond_init(&result->cond, NULL);
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionVariableAsDouble, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+	lock_mutex(&mutex);
+	struct WaitItem **bucket = &wait_items[result->return_code % WAIT_ITEM_BUCKETS];
+	result->next = *bucket;
+	*bucket = result;
+	unlock_mutex(&mutex);
 
+	trace(TRACE_ALLOCATED, result->return_code, ERROR_ok);
+	return result;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionVariableAsString, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
-
+static struct WaitItem *create_submission_item(struct Submission *submission)
+{
+	return create_wait_item(submission, NULL);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_cleanUpConnectionInfo, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-ZEND_END_ARG_INFO()
+static struct WaitItem *create_return_code_item()
+{
+	return create_wait_item(NULL, NULL);
+}
 
+static struct WaitItem *create_batch_item(atomic_uint *failures)
+{
+	return create_wait_item(NULL, failures);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestServerConnectionInfo, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-ZEND_END_ARG_INFO()
+/* The caller must hold the mutex. */
+static struct WaitItem *find_return_code_item(unsigned int return_code)
+{
+	struct WaitItem *item = wait_items[return_code % WAIT_ITEM_BUCKETS];
+	while (item != NULL && item->return_code != return_code)
+		item = item->next;
+	return item;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerConnectionVariableAsUInt64, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* The caller must hold the mutex. */
+static struct WaitItem *unlink_return_code_item(unsigned int return_code)
+{
+	struct WaitItem **parent = &wait_items[return_code % WAIT_ITEM_BUCKETS], *item;
+	while (true)
+	{
+		item = *parent;
+		if (item == NULL)
+		{
+			break;
+		}
+		if (item->return_code == return_code)
+		{
+			*parent = item->next;
+			break;
+		}
+		parent = &item->next;
+	}
+	return item;
+}
 
+static struct WaitItem *remove_return_code_item(unsigned int return_code)
+{
+	lock_mutex(&mutex);
+	struct WaitItem *item = unlink_return_code_item(return_code);
+	unlock_mutex(&mutex);
+	return item;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerConnectionVariableAsFloat, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static void free_file_listing(struct FileListing *listing)
+{
+	if (listing == NULL)
+		return;
+	for (size_t i = 0; i < listing->count; ++i)
+		free(listing->entries[i].name);
+	free(listing->entries);
+	free(listing);
+}
 
+static void free_return_code_item(struct WaitItem* item)
+{
+	free_file_listing(item->listing);
+	pthread_cond_destroy(&item->cond);
+	free(item);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientSelfVariableAsInt, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* Looks an item up without creating it. The caller must hold the mutex. */
+static struct ConnectionItem *find_connection_item(uint64_t serverConnectionHandlerID)
+{
+	struct ConnectionItem *item = connection_items;
+	while (item != NULL && item->serverConnectionHandlerID != serverConnectionHandlerID)
+		item = item->next;
+	return item;
+}
 
+static struct ConnectionItem *lookup_connection_item(uint64_t serverConnectionHandlerID)
+{
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	unlock_mutex(&mutex);
+	return item;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientSelfVariableAsString, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/*
+ * Creates the item of a handler on first use. Only handlers the client lib
+ * knows may get one: ts3client_spawnNewServerConnectionHandler and callbacks
+ * of the client lib call this, functions taking a handler from PHP look it up.
+ */
+static struct ConnectionItem *get_connection_item(uint64_t serverConnectionHandlerID)
+{
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	if (item == NULL)
+	{
+		item = malloc(sizeof(struct ConnectionItem));
+		item->serverConnectionHandlerID = serverConnectionHandlerID;
+		item->expected_state = CONNECT_STATE_NONE;
+		item->state_changed.returned = false;
+		item->state_changed.submission = NULL;
+		item->state_changed.notify = NULL;
+		pthread_cond_init(&item->state_changed.cond, NULL);
+		item->created_channel = 0;
+		memset(&item->talk, 0, sizeof(item->talk));
+		item->whisper_lists = NULL;
+		atomic_init(&item->established, 0);
+		item->flood.rate = flood_default_rate;
+		item->flood.burst = flood_default_burst;
+		item->flood.current_rate = flood_default_rate;
+		item->flood.tokens = flood_default_burst;
+		clock_gettime(CLOCK_MONOTONIC, &item->flood.updated);
 
+		item->next = connection_items;
+		connection_items = item;
+	}
+	unlock_mutex(&mutex);
+	return item;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setClientSelfVariableAsInt, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(0, value)
-ZEND_END_ARG_INFO()
+static void free_whisper_list(struct WhisperList *list)
+{
+	free(list->channels);
+	free(list->clients);
+	free(list);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setClientSelfVariableAsString, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-    ZEND_ARG_INFO(0, flag)
-    ZEND_ARG_INFO(0, value)
-ZEND_END_ARG_INFO()
+static void free_connection_item(struct ConnectionItem* item)
+{
+	pthread_cond_destroy(&item->state_changed.cond);
+	free(item->talk.entries);
+	free(item->talk.clients);
+	while (item->whisper_lists != NULL)
+	{
+		struct WhisperList *next = item->whisper_lists->next;
+		free_whisper_list(item->whisper_lists);
+		item->whisper_lists = next;
+	}
+	free(item);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_flushClientSelfUpdates, 0)
-    ZEND_ARG_INFO(0, serverConnectionHandlerID)
-ZEND_END_ARG_INFO()
+static void delete_connection_item(uint64_t serverConnectionHandlerID)
+{
+	lock_mutex(&mutex);
+	struct ConnectionItem **parent = &connection_items, *item;
+	while (true)
+	{
+		item = *parent;
+		if (item == NULL)
+		{
+			break;
+		}
+		if (item->serverConnectionHandlerID == serverConnectionHandlerID)
+		{
+			*parent = item->next;
+			free_connection_item(item);
+			break;
+		}
+		parent = &item->next;
+	}
+	unlock_mutex(&mutex);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientVariableAsInt, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* Flood control of new connections; off unless ts3client.flood_rate is set. */
+static ZEND_INI_MH(OnUpdateFloodRate)
+{
+	double rate = zend_strtod(ZSTR_VAL(new_value), NULL);
+	if (rate < 0)
+		return FAILURE;
+	flood_default_rate = rate;
+	return SUCCESS;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientVariableAsUInt64, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static ZEND_INI_MH(OnUpdateFloodBurst)
+{
+	double burst = zend_strtod(ZSTR_VAL(new_value), NULL);
+	if (burst < 1)
+		return FAILURE;
+	flood_default_burst = burst;
+	return SUCCESS;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientVariableAsString, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/*
+ * Token bucket in front of every command sent to a server. Callers reserve a
+ * token even when the bucket is empty and then wait until their token
+ * becomes available, so concurrent callers are served in the order they
+ * arrived instead of being rejected. The caller must hold the mutex.
+ */
+static double flood_reserve(struct FloodBucket *flood)
+{
+	if (flood->rate <= 0)
+		return 0;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double elapsed = (now.tv_sec - flood->updated.tv_sec) + (now.tv_nsec - flood->updated.tv_nsec) / 1e9;
+	flood->updated = now;
+	flood->tokens += elapsed * flood->current_rate;
+	if (flood->tokens > flood->burst)
+		flood->tokens = flood->burst;
+
+	flood->tokens -= 1;
+	return flood->tokens >= 0 ? 0 : -flood->tokens / flood->current_rate;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientList, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* The caller must hold the mutex. */
+static void flood_adapt(struct FloodBucket *flood, unsigned int error)
+{
+	if (flood->rate <= 0)
+		return;
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelOfClient, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, clientID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+	if (error == ERROR_client_is_flooding)
+	{
+		flood->current_rate /= 2;
+		if (flood->current_rate < FLOOD_MINIMUM_RATE)
+			flood->current_rate = FLOOD_MINIMUM_RATE;
+		if (flood->tokens > 0)
+			flood->tokens = 0;
+	}
+	else if (flood->current_rate < flood->rate)
+	{
+		flood->current_rate += flood->rate / FLOOD_RECOVERY_STEPS;
+		if (flood->current_rate > flood->rate)
+			flood->current_rate = flood->rate;
+	}
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelVariableAsInt, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* Returns the seconds until the reserved token of the connection becomes available. Unknown handlers are left to the client lib to reject. */
+static double reserve_flood_token(uint64_t serverConnectionHandlerID)
+{
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	double delay = item != NULL ? flood_reserve(&item->flood) : 0;
+	unlock_mutex(&mutex);
+	return delay;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelVariableAsUInt64, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+static void sleep_seconds(double delay)
+{
+	struct timespec duration;
+	duration.tv_sec = (time_t)delay;
+	duration.tv_nsec = (long)((delay - duration.tv_sec) * 1e9);
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelVariableAsString, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* Flood control for native threads, which have no fibers to suspend instead. */
+static void throttle_native(uint64_t serverConnectionHandlerID)
+{
+	double delay = reserve_flood_token(serverConnectionHandlerID);
+	if (delay > 0)
+		sleep_seconds(delay);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setChannelVariableAsInt, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(0, value)
-ZEND_END_ARG_INFO()
+static struct CompletionQueue *create_completion_queue(void)
+{
+	int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	struct CompletionQueue *queue = malloc(sizeof(struct CompletionQueue));
+	pthread_mutex_init(&queue->lock, NULL);
+	queue->head = NULL;
+	queue->tail = &queue->head;
+	queue->fd = fd;
+	atomic_init(&queue->references, 1);
+	return queue;
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setChannelVariableAsUInt64, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(0, value)
-ZEND_END_ARG_INFO()
+static struct CompletionQueue *get_completion_queue(void)
+{
+	if (TS3CLIENT_G(completions) == NULL)
+		TS3CLIENT_G(completions) = create_completion_queue();
+	return TS3CLIENT_G(completions);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setChannelVariableAsString, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(0, value)
-ZEND_END_ARG_INFO()
+/* Every submission in flight holds a reference, so a queue outlives the thread that owns it. */
+static void release_completion_queue(struct CompletionQueue *queue)
+{
+	if (atomic_fetch_sub(&queue->references, 1) != 1)
+		return;
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_flushChannelUpdates, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-ZEND_END_ARG_INFO()
+	struct Completion *completion = queue->head;
+	while (completion != NULL)
+	{
+		struct Completion *next = completion->next;
+		free(completion);
+		completion = next;
+	}
+	close(queue->fd);
+	pthread_mutex_destroy(&queue->lock);
+	free(queue);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_flushChannelCreation, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelParentID)
-ZEND_END_ARG_INFO()
+static void free_submission(struct Submission *submission)
+{
+	for (size_t i = 0; i < SUBMISSION_MAX_ARGUMENTS; ++i)
+		free(submission->strings[i]);
+	release_completion_queue(submission->completions);
+	free(submission);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelList, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/* Posts the result of a submission to the thread that submitted it. The caller must not hold the mutex. */
+static void complete_submission(struct Submission *submission, unsigned int error, uint64_t channelID)
+{
+	struct Completion *completion = malloc(sizeof(struct Completion));
+	completion->next = NULL;
+	completion->ticket = submission->ticket;
+	completion->serverConnectionHandlerID = submission->serverConnectionHandlerID;
+	completion->operation = submission->operation;
+	completion->error = error;
+	completion->channelID = channelID;
+
+	struct CompletionQueue *queue = submission->completions;
+	pthread_mutex_lock(&queue->lock);
+	*queue->tail = completion;
+	queue->tail = &completion->next;
+	pthread_mutex_unlock(&queue->lock);
+
+	uint64_t one = 1;
+	ssize_t written = write(queue->fd, &one, sizeof(one));
+	(void)written;
+	free_submission(submission);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelClientList, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+/*
+ * Bounded lock-free submission queue after Dmitry Vyukov's MPMC design. The
+ * sequence number of a slot tells producers and consumers whose turn it is,
+ * so PHP threads never wait for each other or for the I/O worker.
+ */
+static bool push_submission(struct Submission *submission)
+{
+	size_t position = atomic_load_explicit(&submissions.enqueue_position, memory_order_relaxed);
+	struct SubmissionSlot *slot;
+	while (true)
+	{
+		slot = &submissions.slots[position & (SUBMISSION_QUEUE_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+		if (difference == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&submissions.enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			atomic_fetch_add_explicit(&submissions.rejected, 1, memory_order_relaxed);
+			return false;
+		}
+		else
+			position = atomic_load_explicit(&submissions.enqueue_position, memory_order_relaxed);
+	}
+	slot->submission = submission;
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+	return true;
+}
+
+static struct Submission *pop_submission(void)
+{
+	size_t position = atomic_load_explicit(&submissions.dequeue_position, memory_order_relaxed);
+	struct SubmissionSlot *slot;
+	while (true)
+	{
+		slot = &submissions.slots[position & (SUBMISSION_QUEUE_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+		if (difference == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&submissions.dequeue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+			return NULL;
+		else
+			position = atomic_load_explicit(&submissions.dequeue_position, memory_order_relaxed);
+	}
+	struct Submission *submission = slot->submission;
+	atomic_store_explicit(&slot->sequence, position + SUBMISSION_QUEUE_SIZE, memory_order_release);
+	return submission;
+}
+
+/* Wakes the event loop of a thread whose fibers wait for the item. The caller must hold the mutex. */
+static void notify_returned(struct WaitItem *item)
+{
+	if (item->notify != NULL)
+	{
+		uint64_t one = 1;
+		ssize_t written = write(item->notify->fd, &one, sizeof(one));
+		(void)written;
+	}
+}
+
+static void set_result(struct WaitItem *item, unsigned int return_code)
+{
+	lock_mutex(&mutex);
+	if (item->returned == false)
+	{
+		item->result = return_code;
+		item->returned = true;
+		pthread_cond_signal(&item->cond);
+		notify_returned(item);
+	}
+	unlock_mutex(&mutex);
+}
+
+/* Answers the pending connect or disconnect of a connection, whether a PHP thread or a submission waits for it. */
+static void set_state_result(struct ConnectionItem *connection, unsigned int error)
+{
+	lock_mutex(&mutex);
+	struct Submission *submission = connection->state_changed.submission;
+	connection->state_changed.submission = NULL;
+	unlock_mutex(&mutex);
+
+	if (submission == NULL)
+	{
+		set_result(&connection->state_changed, error);
+		return;
+	}
+	atomic_store(&connection->expected_state, CONNECT_STATE_NONE);
+	complete_submission(submission, error, 0);
+}
+
+#if PHP_VERSION_ID >= 80100
+/*
+ * A fiber suspended until the items it waits for are answered. It lives on
+ * the fiber's own stack and is linked into the thread's list while the fiber
+ * is suspended.
+ */
+struct FiberWait
+{
+	struct FiberWait *next;
+	zend_fiber *fiber;
+	struct WaitItem **items;
+	size_t count;
+	struct timespec deadline;
+};
+
+/* The caller must hold the mutex. */
+static bool items_returned(struct WaitItem **items, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (items[i] != NULL && items[i]->returned == false)
+			return false;
+	}
+	return true;
+}
+
+static bool fiber_wait_ready(struct FiberWait *wait, const struct timespec *now)
+{
+	if (now->tv_sec > wait->deadline.tv_sec || (now->tv_sec == wait->deadline.tv_sec && now->tv_nsec >= wait->deadline.tv_nsec))
+		return true;
+	if (wait->count == 0)
+		return false;
+	lock_mutex(&mutex);
+	bool returned = items_returned(wait->items, wait->count);
+	unlock_mutex(&mutex);
+	return returned;
+}
+
+/*
+ * The statistics scope is kept per fiber: a fiber takes its own out while it
+ * is suspended and puts it back when it is resumed, and the code resuming it
+ * does the same around the resume. Outside of any fiber switch the thread
+ * then always sees the scope of the function that is running on it.
+ */
+struct FiberScope
+{
+	int function;
+	const char *activity;
+};
+
+static void swap_out_fiber_scope(struct FiberScope *scope)
+{
+	scope->function = TS3CLIENT_G(stats_function);
+	scope->activity = current_activity;
+	TS3CLIENT_G(stats_function) = -1;
+	current_activity = NULL;
+}
+
+static void swap_in_fiber_scope(const struct FiberScope *scope)
+{
+	TS3CLIENT_G(stats_function) = scope->function;
+	current_activity = scope->activity;
+}
+
+static void unlink_fiber_wait(struct FiberWait *wait)
+{
+	struct FiberWait **parent = &TS3CLIENT_G(fiber_waits);
+	while (*parent != NULL && *parent != wait)
+		parent = &(*parent)->next;
+	if (*parent != NULL)
+		*parent = wait->next;
+}
+
+/*
+ * Suspends the current fiber instead of the thread until all items are
+ * answered or the deadline passed. The thread's completion stream becomes
+ * readable when an answer arrives; ts3client_dispatchCompletions() then
+ * resumes the fiber. Afterwards the caller collects the results as usual.
+ * Without items the fiber waits for the deadline alone.
+ */
+static void suspend_until_returned(struct WaitItem **items, size_t count, const struct timespec *deadline)
+{
+	struct CompletionQueue *completions = get_completion_queue();
+	if (completions == NULL)
+		return;
+
+	lock_mutex(&mutex);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (items[i] != NULL)
+			items[i]->notify = completions;
+	}
+	unlock_mutex(&mutex);
+
+	struct FiberWait wait = { NULL, EG(active_fiber), items, count, *deadline };
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	while (fiber_wait_ready(&wait, &now) == false)
+	{
+		wait.next = TS3CLIENT_G(fiber_waits);
+		TS3CLIENT_G(fiber_waits) = &wait;
+		zval retval;
+		ZVAL_UNDEF(&retval);
+		struct FiberScope scope;
+		swap_out_fiber_scope(&scope);
+		zend_call_method_with_0_params(NULL, zend_ce_fiber, NULL, "suspend", &retval);
+		swap_in_fiber_scope(&scope);
+		zval_ptr_dtor(&retval);
+		unlink_fiber_wait(&wait);
+		if (EG(exception))
+			break;
+		clock_gettime(CLOCK_REALTIME, &now);
+	}
+
+	lock_mutex(&mutex);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (items[i] != NULL)
+			items[i]->notify = NULL;
+	}
+	unlock_mutex(&mutex);
+}
+
+static bool fiber_wait_enabled(void)
+{
+	return TS3CLIENT_G(fiber_wait) && EG(active_fiber) != NULL;
+}
+#endif
+
+/*
+ * Flood control for PHP threads. Inside a fiber with ts3client.fiber_wait
+ * only the fiber waits for its token, so one flooded connection does not
+ * stall every other fiber of the thread.
+ */
+static void throttle(uint64_t serverConnectionHandlerID)
+{
+	double delay = reserve_flood_token(serverConnectionHandlerID);
+	if (delay <= 0)
+		return;
+#if PHP_VERSION_ID >= 80100
+	if (fiber_wait_enabled())
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += (time_t)delay;
+		deadline.tv_nsec += (long)((delay - (time_t)delay) * 1e9);
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		suspend_until_returned(NULL, 0, &deadline);
+		return;
+	}
+#endif
+	sleep_seconds(delay);
+}
+
+static void wait_for(struct WaitItem *item)
+{
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	struct timespec timeout;
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += TS3CLIENT_G(timeout);
+#if PHP_VERSION_ID >= 80100
+	if (fiber_wait_enabled())
+		suspend_until_returned(&item, 1, &timeout);
+#endif
+
+	lock_mutex(&mutex);
+
+	while (item->returned == false && wait_mutex_cond(&item->cond, &mutex, &timeout) == 0);
+	if (item->returned)
+	{
+		item->returned = false;
+	}
+	else
+	{
+		item->result = ERROR_connection_lost;
+	}
+
+	unlock_mutex(&mutex);
+	record_wait(&started, item->result == ERROR_connection_lost);
+}
+
+/*
+ * Waits for a batch of pipelined requests with one shared deadline. Entries
+ * that were never sent must be NULL and keep the error already stored for
+ * them. Items that time out are unlinked while the mutex is held, so a late
+ * answer from the server can no longer reach them.
+ */
+static void wait_for_items_until(struct WaitItem **items, unsigned int *errors, size_t count, const struct timespec *timeout)
+{
+	lock_mutex(&mutex);
+	for (size_t i = 0; i < count; ++i)
+	{
+		struct WaitItem *item = items[i];
+		if (item == NULL)
+			continue;
+		while (item->returned == false && wait_mutex_cond(&item->cond, &mutex, timeout) == 0);
+		if (item->returned)
+		{
+			errors[i] = item->result;
+			trace(TRACE_WOKEN, item->return_code, errors[i]);
+		}
+		else
+		{
+			unlink_return_code_item(item->return_code);
+			errors[i] = ERROR_connection_lost;
+			trace(TRACE_TIMED_OUT, item->return_code, errors[i]);
+		}
+	}
+	unlock_mutex(&mutex);
+}
+
+static void wait_for_items(struct WaitItem **items, unsigned int *errors, size_t count)
+{
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	struct timespec timeout;
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += TS3CLIENT_G(timeout);
+#if PHP_VERSION_ID >= 80100
+	if (fiber_wait_enabled())
+		suspend_until_returned(items, count, &timeout);
+#endif
+	wait_for_items_until(items, errors, count, &timeout);
+
+	size_t timeouts = 0;
+	for (size_t i = 0; i < count; ++i)
+		timeouts += items[i] != NULL && errors[i] == ERROR_connection_lost;
+	record_wait(&started, timeouts);
+}
+
+static void free_items(struct WaitItem **items, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (items[i] != NULL)
+			free_return_code_item(items[i]);
+		items[i] = NULL;
+	}
+}
+
+static void wait_for_all(struct WaitItem **items, unsigned int *errors, size_t count)
+{
+	wait_for_items(items, errors, count);
+	free_items(items, count);
+}
+
+/*
+ * Records the outcome of sending one request of a batch. Requests the client
+ * lib refused to send never get an answer, so their item is dropped here.
+ */
+static void batch_sent(struct WaitItem **item, unsigned int *error, unsigned int send_error)
+{
+	trace(TRACE_ISSUED, (*item)->return_code, send_error);
+	if (send_error != ERROR_ok)
+	{
+		if ((*item)->failures != NULL)
+			atomic_fetch_add((*item)->failures, 1);
+		remove_return_code_item((*item)->return_code);
+		free_return_code_item(*item);
+		*item = NULL;
+		*error = send_error;
+	}
+}
+
+/*
+ * Collects the client IDs of a PHP array in order, leaving out repeated ones,
+ * so the result array keyed by client ID has exactly one result per request.
+ */
+static size_t distinct_client_ids(HashTable *clientIDs, zend_long *ids)
+{
+	HashTable seen;
+	zend_hash_init(&seen, zend_hash_num_elements(clientIDs), NULL, NULL, 0);
+	size_t count = 0;
+	zval *zclientID;
+	ZEND_HASH_FOREACH_VAL(clientIDs, zclientID)
+	{
+		const zend_long clientID = zval_get_long(zclientID);
+		if (zend_hash_index_add_empty_element(&seen, clientID) != NULL)
+			ids[count++] = clientID;
+	}
+	ZEND_HASH_FOREACH_END();
+	zend_hash_destroy(&seen);
+	return count;
+}
+
+static unsigned int handle_return_code(struct WaitItem *item, unsigned int error)
+{
+	batch_sent(&item, &error, error);
+	wait_for_all(&item, &error, 1);
+	return error;
+}
+
+/*
+ * Splits long text messages into chunks the server accepts. Chunks never end
+ * inside a UTF-8 sequence or a BBCode tag and preferably end at a line break
+ * or space. Simple formatting tags that are still open at the end of a chunk
+ * are closed there and opened again at the start of the next one.
+ */
+struct TextChunker
+{
+	const char *text;
+	size_t length;
+	size_t position;
+	size_t limit;
+	bool carry_tags;
+	char tags[TEXTMESSAGE_MAX_CARRIED_TAGS][TEXTMESSAGE_TAG_LENGTH];
+	size_t tag_count;
+};
+
+static void init_text_chunker(struct TextChunker *chunker, const char *text, size_t length, size_t limit)
+{
+	chunker->text = text;
+	chunker->length = length;
+	chunker->position = 0;
+	chunker->limit = limit;
+	chunker->carry_tags = limit >= 2 * TEXTMESSAGE_MAX_CARRIED_TAGS * (TEXTMESSAGE_TAG_LENGTH + sizeof("[/color]"));
+	chunker->tag_count = 0;
+}
+
+static size_t bbcode_tag_name(const char *tag, size_t length)
+{
+	size_t name = 0;
+	while (name < length && tag[name] != '=' && tag[name] != ']')
+		++name;
+	return name;
+}
+
+static bool is_carried_bbcode_tag(const char *name, size_t length)
+{
+	static const char *const carried[] = { "b", "i", "u", "s", "sub", "sup", "color", "size" };
+	for (size_t i = 0; i < sizeof(carried) / sizeof(*carried); ++i)
+	{
+		if (strlen(carried[i]) == length && strncasecmp(carried[i], name, length) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void track_bbcode_tag(struct TextChunker *chunker, const char *tag, size_t length)
+{
+	if (length > 1 && tag[1] == '/')
+	{
+		size_t name = bbcode_tag_name(tag + 2, length - 2);
+		for (size_t i = chunker->tag_count; i-- > 0;)
+		{
+			const char *open = chunker->tags[i] + 1;
+			if (bbcode_tag_name(open, strlen(open)) == name && strncasecmp(open, tag + 2, name) == 0)
+			{
+				memmove(chunker->tags[i], chunker->tags[i + 1], (chunker->tag_count - i - 1) * TEXTMESSAGE_TAG_LENGTH);
+				--chunker->tag_count;
+				break;
+			}
+		}
+	}
+	else if (is_carried_bbcode_tag(tag + 1, bbcode_tag_name(tag + 1, length - 1))
+			&& length < TEXTMESSAGE_TAG_LENGTH
+			&& chunker->tag_count < TEXTMESSAGE_MAX_CARRIED_TAGS)
+	{
+		memcpy(chunker->tags[chunker->tag_count], tag, length);
+		chunker->tags[chunker->tag_count][length] = '\0';
+		++chunker->tag_count;
+	}
+}
+
+static size_t find_chunk_end(const struct TextChunker *chunker, size_t budget)
+{
+	const char *text = chunker->text;
+	size_t start = chunker->position;
+	if (chunker->length - start <= budget)
+		return chunker->length;
+
+	size_t end = start + budget;
+	while (end > start && (text[end] & 0xC0) == 0x80)
+		--end;
+
+	for (size_t i = end; i-- > start;)
+	{
+		if (text[i] == ']')
+			break;
+		if (text[i] == '[')
+		{
+			if (i > start)
+				end = i;
+			break;
+		}
+	}
+
+	for (size_t i = end; i-- > start + budget / 2;)
+	{
+		if (text[i] == '\n' || text[i] == ' ')
+			return i + 1;
+	}
+	return end > start ? end : start + budget;
+}
+
+static bool next_text_chunk(struct TextChunker *chunker, smart_str *chunk)
+{
+	if (chunker->position >= chunker->length)
+		return false;
+
+	size_t budget = chunker->limit;
+	if (chunker->carry_tags)
+	{
+		for (size_t i = 0; i < chunker->tag_count; ++i)
+		{
+			smart_str_appends(chunk, chunker->tags[i]);
+			budget -= strlen(chunker->tags[i]);
+		}
+		budget -= TEXTMESSAGE_MAX_CARRIED_TAGS * sizeof("[/color]");
+	}
+
+	size_t end = find_chunk_end(chunker, budget);
+	const char *text = chunker->text;
+	smart_str_appendl(chunk, text + chunker->position, end - chunker->position);
+
+	for (size_t i = chunker->position; i < end; ++i)
+	{
+		if (text[i] != '[')
+			continue;
+		const char *close = memchr(text + i, ']', end - i);
+		if (close == NULL)
+			break;
+		if (chunker->carry_tags)
+			track_bbcode_tag(chunker, text + i, close - (text + i) + 1);
+		i = close - text;
+	}
+	chunker->position = end;
+
+	if (chunker->carry_tags && end < chunker->length)
+	{
+		for (size_t i = chunker->tag_count; i-- > 0;)
+		{
+			const char *open = chunker->tags[i] + 1;
+			smart_str_appends(chunk, "[/");
+			smart_str_appendl(chunk, open, bbcode_tag_name(open, strlen(open)));
+			smart_str_appendc(chunk, ']');
+		}
+	}
+	smart_str_0(chunk);
+	return true;
+}
+
+static unsigned int send_text_message(uint64_t serverConnectionHandlerID, zend_long targetMode, zend_long targetID, const char *message, const char *returnCode)
+{
+	switch (targetMode)
+	{
+		case TextMessageTarget_CLIENT:
+			return ts3client_requestSendPrivateTextMsg(serverConnectionHandlerID, message, targetID, returnCode);
+		case TextMessageTarget_CHANNEL:
+			return ts3client_requestSendChannelTextMsg(serverConnectionHandlerID, message, targetID, returnCode);
+		case TextMessageTarget_SERVER:
+			return ts3client_requestSendServerTextMsg(serverConnectionHandlerID, message, returnCode);
+		default:
+			return ERROR_parameter_invalid;
+	}
+}
+
+TS3_CALLBACK(onServerErrorEvent, (uint64 serverConnectionHandlerID, const char* errorMessage, unsigned int error, const char* returnCode, const char* extraMessage),
+	(serverConnectionHandlerID, errorMessage, error, returnCode, extraMessage))
+{
+	(void)errorMessage;
+	(void)extraMessage;
+	struct ConnectionItem *connection = get_connection_item(serverConnectionHandlerID);
+	lock_mutex(&mutex);
+	flood_adapt(&connection->flood, error);
+	unlock_mutex(&mutex);
+
+	if (returnCode)
+	{
+		char* endptr;
+		long int return_code = strtol(returnCode, &endptr, 10);
+		if (return_code > 0)
+		{
+			lock_mutex(&mutex);
+			struct WaitItem *item = unlink_return_code_item(return_code);
+			struct Submission *submission = item != NULL ? item->submission : NULL;
+			uint64_t created_channel = connection->created_channel;
+			if (item != NULL && item->returned == false)
+				trace(TRACE_ANSWERED, return_code, error);
+			if (item != NULL && submission == NULL && item->returned == false)
+			{
+				item->created_channel = created_channel;
+				item->result = error;
+				item->returned = true;
+				if (error != ERROR_ok && item->failures != NULL)
+					atomic_fetch_add(item->failures, 1);
+				pthread_cond_signal(&item->cond);
+				notify_returned(item);
+			}
+			connection->created_channel = 0;
+			unlock_mutex(&mutex);
+
+			if (submission != NULL)
+			{
+				complete_submission(submission, error, created_channel);
+				trace(TRACE_WOKEN, return_code, error);
+				free_return_code_item(item);
+			}
+		}
+	}
+	else
+	{
+		enum ConnectState expected = atomic_load(&connection->expected_state);
+		if (expected == CONNECT_STATE_CONNECTING)
+			set_state_result(connection, error);
+	}
+}
+
+TS3_CALLBACK(onFileListEvent, (uint64 serverConnectionHandlerID, uint64 channelID, const char* path, const char* name, uint64 size, uint64 datetime, int type, uint64 incompletesize, const char* returnCode),
+	(serverConnectionHandlerID, channelID, path, name, size, datetime, type, incompletesize, returnCode))
+{
+	(void)serverConnectionHandlerID;
+	(void)channelID;
+	(void)path;
+	(void)incompletesize;
+	long int return_code = returnCode ? strtol(returnCode, NULL, 10) : 0;
+	if (return_code <= 0)
+		return;
+
+	lock_mutex(&mutex);
+	struct WaitItem *item = find_return_code_item(return_code);
+	if (item != NULL && item->submission == NULL && item->returned == false)
+	{
+		if (item->listing == NULL)
+			item->listing = calloc(1, sizeof(struct FileListing));
+		struct FileListing *listing = item->listing;
+		if (listing->count == listing->capacity)
+		{
+			listing->capacity = listing->capacity ? listing->capacity * 2 : 16;
+			listing->entries = realloc(listing->entries, listing->capacity * sizeof(struct FileEntry));
+		}
+		struct FileEntry *entry = &listing->entries[listing->count++];
+		entry->name = strdup(name);
+		entry->size = size;
+		entry->datetime = datetime;
+		entry->type = type;
+	}
+	unlock_mutex(&mutex);
+}
+
+/*
+ * The server announces a channel created by this client right before it
+ * answers the command that created it, so the channel is remembered until
+ * onServerErrorEvent hands it to the matching return code.
+ */
+TS3_CALLBACK(onNewChannelCreatedEvent, (uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier),
+	(serverConnectionHandlerID, channelID, channelParentID, invokerID, invokerName, invokerUniqueIdentifier))
+{
+	(void)channelParentID;
+	(void)invokerName;
+	(void)invokerUniqueIdentifier;
+	anyID self;
+	if (ts3client_getClientID(serverConnectionHandlerID, &self) != ERROR_ok || self != invokerID)
+		return;
+
+	struct ConnectionItem *item = get_connection_item(serverConnectionHandlerID);
+	lock_mutex(&mutex);
+	item->created_channel = channelID;
+	unlock_mutex(&mutex);
+}
+
+TS3_CALLBACK(onConnectStatusChangeEvent, (uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber),
+	(serverConnectionHandlerID, newStatus, errorNumber))
+{
+	struct ConnectionItem *item = get_connection_item(serverConnectionHandlerID);
+	const bool connected = newStatus == STATUS_CONNECTION_ESTABLISHED;
+	const bool disconnected = newStatus == STATUS_DISCONNECTED;
+	if (connected)
+		atomic_fetch_add(&item->established, 1);
+	if (!connected && !disconnected)
+		return;
+
+	switch (atomic_load(&item->expected_state))
+	{
+		case CONNECT_STATE_NONE: return;
+		case CONNECT_STATE_CONNECTING:
+			if (disconnected && errorNumber == ERROR_ok)
+				errorNumber = ERROR_undefined;
+			break;
+		case CONNECT_STATE_DISCONNECTING:
+			if (connected && errorNumber == ERROR_ok)
+				errorNumber = ERROR_undefined;
+			break;
+	}
+	set_state_result(item, errorNumber);
+}
+
+static size_t talk_slot(const struct TalkTable *table, anyID clientID, uint64_t channelID)
+{
+	size_t slot = (size_t)((clientID * 0x9E3779B97F4A7C15ULL) ^ channelID) & (table->capacity - 1);
+	while (table->entries[slot].bursts + table->entries[slot].talking != 0)
+	{
+		const struct TalkEntry *entry = &table->entries[slot];
+		if (entry->clientID == clientID && entry->channelID == channelID)
+			break;
+		slot = (slot + 1) & (table->capacity - 1);
+	}
+	return slot;
+}
+
+/* Rebuilds the table with the given capacity, dropping entries without bursts that are not talking. */
+static void rehash_talk_table(struct TalkTable *table, size_t capacity)
+{
+	struct TalkEntry *entries = calloc(capacity, sizeof(struct TalkEntry));
+	struct TalkTable rehashed = { entries, capacity, 0 };
+	for (size_t i = 0; i < table->capacity; ++i)
+	{
+		const struct TalkEntry *entry = &table->entries[i];
+		if (entry->bursts + entry->talking == 0)
+			continue;
+		rehashed.entries[talk_slot(&rehashed, entry->clientID, entry->channelID)] = *entry;
+		++rehashed.count;
+	}
+	free(table->entries);
+	table->entries = entries;
+	table->capacity = capacity;
+	table->count = rehashed.count;
+}
+
+static size_t talk_client_slot(const struct TalkClient *clients, size_t capacity, anyID clientID)
+{
+	size_t slot = (size_t)(clientID * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+	while (clients[slot].used && clients[slot].clientID != clientID)
+		slot = (slot + 1) & (capacity - 1);
+	return slot;
+}
+
+/* Remembers the channel of the burst a client opened. The caller must hold the mutex. */
+static void set_talk_client(struct TalkTable *table, anyID clientID, uint64_t channelID)
+{
+	if ((table->client_count + 1) * 4 > table->client_capacity * 3)
+	{
+		const size_t capacity = table->client_capacity ? table->client_capacity * 2 : 16;
+		struct TalkClient *clients = calloc(capacity, sizeof(struct TalkClient));
+		for (size_t i = 0; i < table->client_capacity; ++i)
+		{
+			if (table->clients[i].used)
+				clients[talk_client_slot(clients, capacity, table->clients[i].clientID)] = table->clients[i];
+		}
+		free(table->clients);
+		table->clients = clients;
+		table->client_capacity = capacity;
+	}
+	struct TalkClient *client = &table->clients[talk_client_slot(table->clients, table->client_capacity, clientID)];
+	if (client->used == false)
+	{
+		client->used = true;
+		client->clientID = clientID;
+		++table->client_count;
+	}
+	client->channelID = channelID;
+}
+
+/* The caller must hold the mutex. */
+static struct TalkEntry *get_talk_entry(struct TalkTable *table, anyID clientID, uint64_t channelID)
+{
+	if ((table->count + 1) * 4 > table->capacity * 3)
+		rehash_talk_table(table, table->capacity ? table->capacity * 2 : 16);
+	struct TalkEntry *entry = &table->entries[talk_slot(table, clientID, channelID)];
+	if (entry->bursts + entry->talking == 0)
+	{
+		memset(entry, 0, sizeof(*entry));
+		entry->clientID = clientID;
+		entry->channelID = channelID;
+		++table->count;
+	}
+	return entry;
+}
+
+/* A client talks in at most one channel, the one it last started talking in. The caller must hold the mutex. */
+static struct TalkEntry *find_talking_entry(struct TalkTable *table, anyID clientID)
+{
+	if (table->client_capacity == 0 || table->capacity == 0)
+		return NULL;
+	const struct TalkClient *client = &table->clients[talk_client_slot(table->clients, table->client_capacity, clientID)];
+	if (client->used == false)
+		return NULL;
+	struct TalkEntry *entry = &table->entries[talk_slot(table, clientID, client->channelID)];
+	return entry->talking && entry->clientID == clientID ? entry : NULL;
+}
+
+static void end_talk_burst(struct TalkEntry *entry, const struct timespec *now)
+{
+	const long long milliseconds = (now->tv_sec - entry->started.tv_sec) * 1000LL + (now->tv_nsec - entry->started.tv_nsec) / 1000000;
+	const uint64_t duration = milliseconds > 0 ? milliseconds : 0;
+	int bucket = duration ? 63 - __builtin_clzll(duration) : 0;
+	if (bucket >= TALK_HISTOGRAM_BUCKETS)
+		bucket = TALK_HISTOGRAM_BUCKETS - 1;
+
+	++entry->bursts;
+	if (entry->whispering)
+		++entry->whisper_bursts;
+	entry->milliseconds += duration;
+	if (duration > entry->longest)
+		entry->longest = duration;
+	++entry->histogram[bucket];
+	entry->talking = false;
+}
+
+/* Talk flips are aggregated here instead of being handed to PHP. */
+TS3_CALLBACK(onTalkStatusChangeEvent, (uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID),
+	(serverConnectionHandlerID, status, isReceivedWhisper, clientID))
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64 channelID = 0;
+	if (status == STATUS_TALKING)
+		ts3client_getChannelOfClient(serverConnectionHandlerID, clientID, &channelID);
+
+	struct ConnectionItem *item = get_connection_item(serverConnectionHandlerID);
+	lock_mutex(&mutex);
+	struct TalkEntry *entry = find_talking_entry(&item->talk, clientID);
+	if (entry != NULL)
+		end_talk_burst(entry, &now);
+	if (status == STATUS_TALKING)
+	{
+		entry = get_talk_entry(&item->talk, clientID, channelID);
+		set_talk_client(&item->talk, clientID, channelID);
+		entry->talking = true;
+		entry->whispering = isReceivedWhisper != 0;
+		entry->started = now;
+	}
+	unlock_mutex(&mutex);
+}
+
+/*
+ * Sends one submission on the I/O worker. Returns an error if the request was
+ * not sent; otherwise the submission completes once the server answered.
+ */
+static unsigned int issue_submission(struct Submission *submission)
+{
+	const uint64_t serverConnectionHandlerID = submission->serverConnectionHandlerID;
+	const zend_long *numbers = submission->numbers;
+	char *const *strings = submission->strings;
+	unsigned int error;
+
+	if (submission->operation == OPERATION_START_CONNECTION || submission->operation == OPERATION_STOP_CONNECTION)
+	{
+		const bool connect = submission->operation == OPERATION_START_CONNECTION;
+		struct ConnectionItem *connection = lookup_connection_item(serverConnectionHandlerID);
+		if (connection == NULL)
+			return ERROR_invalid_server_connection_handler_id;
+		enum ConnectState expected = CONNECT_STATE_NONE;
+		if (atomic_compare_exchange_strong(&connection->expected_state, &expected, connect ? CONNECT_STATE_CONNECTING : CONNECT_STATE_DISCONNECTING) == false)
+			return ERROR_currently_not_possible;
+
+		lock_mutex(&mutex);
+		connection->state_changed.submission = submission;
+		unlock_mutex(&mutex);
+
+		if (connect)
+			error = ts3client_startConnectionWithChannelID(serverConnectionHandlerID, strings[0], strings[1], numbers[2], strings[3], numbers[4], strings[5], strings[6]);
+		else
+			error = ts3client_stopConnection(serverConnectionHandlerID, strings[0]);
+
+		if (error != ERROR_ok)
+		{
+			lock_mutex(&mutex);
+			const bool pending = connection->state_changed.submission == submission;
+			connection->state_changed.submission = NULL;
+			unlock_mutex(&mutex);
+			if (pending == false)
+				return ERROR_ok;
+			atomic_store(&connection->expected_state, CONNECT_STATE_NONE);
+		}
+		return error;
+	}
+
+	struct WaitItem *item = create_submission_item(submission);
+	switch (submission->operation)
+	{
+		case OPERATION_CLIENT_MOVE:
+			error = ts3client_requestClientMove(serverConnectionHandlerID, numbers[0], numbers[1], strings[2], item->return_code_text);
+			break;
+		case OPERATION_CHANNEL_DELETE:
+			error = ts3client_requestChannelDelete(serverConnectionHandlerID, numbers[0], numbers[1], item->return_code_text);
+			break;
+		case OPERATION_FLUSH_CLIENT_SELF_UPDATES:
+			error = ts3client_flushClientSelfUpdates(serverConnectionHandlerID, item->return_code_text);
+			break;
+		case OPERATION_FLUSH_CHANNEL_UPDATES:
+			error = ts3client_flushChannelUpdates(serverConnectionHandlerID, numbers[0], item->return_code_text);
+			break;
+		case OPERATION_FLUSH_CHANNEL_CREATION:
+			error = ts3client_flushChannelCreation(serverConnectionHandlerID, numbers[0], item->return_code_text);
+			break;
+		case OPERATION_SEND_TEXT_MESSAGE:
+			error = send_text_message(serverConnectionHandlerID, numbers[0], numbers[1], strings[2], item->return_code_text);
+			break;
+		default:
+			error = ERROR_parameter_invalid;
+			break;
+	}
+
+	trace(TRACE_ISSUED, item->return_code, error);
+	if (error != ERROR_ok)
+	{
+		if (remove_return_code_item(item->return_code) == NULL)
+			return ERROR_ok;
+		free_return_code_item(item);
+	}
+	return error;
+}
+
+static bool deadline_passed(const struct timespec *deadline, const struct timespec *now)
+{
+	return now->tv_sec > deadline->tv_sec || (now->tv_sec == deadline->tv_sec && now->tv_nsec >= deadline->tv_nsec);
+}
+
+/* Completes submissions the server did not answer in time with ERROR_connection_lost. */
+static void expire_submissions(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	struct WaitItem *expired = NULL;
+	struct Submission *expired_states[SUBMISSION_QUEUE_SIZE];
+	size_t expired_state_count = 0;
+
+	lock_mutex(&mutex);
+	for (size_t i = 0; i < WAIT_ITEM_BUCKETS; ++i)
+	{
+		struct WaitItem **parent = &wait_items[i];
+		while (*parent != NULL)
+		{
+			struct WaitItem *item = *parent;
+			if (item->submission != NULL && deadline_passed(&item->submission->deadline, &now))
+			{
+				*parent = item->next;
+				item->next = expired;
+				expired = item;
+			}
+			else parent = &item->next;
+		}
+	}
+	for (struct ConnectionItem *connection = connection_items; connection != NULL && expired_state_count < SUBMISSION_QUEUE_SIZE; connection = connection->next)
+	{
+		struct Submission *submission = connection->state_changed.submission;
+		if (submission != NULL && deadline_passed(&submission->deadline, &now))
+		{
+			connection->state_changed.submission = NULL;
+			atomic_store(&connection->expected_state, CONNECT_STATE_NONE);
+			expired_states[expired_state_count++] = submission;
+		}
+	}
+	unlock_mutex(&mutex);
+
+	while (expired != NULL)
+	{
+		struct WaitItem *next = expired->next;
+		complete_submission(expired->submission, ERROR_connection_lost, 0);
+		trace(TRACE_TIMED_OUT, expired->return_code, ERROR_connection_lost);
+		free_return_code_item(expired);
+		expired = next;
+	}
+	for (size_t i = 0; i < expired_state_count; ++i)
+		complete_submission(expired_states[i], ERROR_connection_lost, 0);
+}
+
+static void send_submission(struct Submission *submission)
+{
+	unsigned int error = issue_submission(submission);
+	if (error != ERROR_ok)
+		complete_submission(submission, error, 0);
+}
+
+/*
+ * Reserves a flood control token for a submission. One that has to wait for
+ * its token is put on the deferred list instead of sleeping on the I/O worker,
+ * so a flooded connection does not hold up every other connection. It is never
+ * sent before an earlier submission of the same connection.
+ */
+static bool defer_submission(struct Submission *submission)
+{
+	if (submission->operation == OPERATION_START_CONNECTION || submission->operation == OPERATION_STOP_CONNECTION)
+		return false;
+
+	const double delay = reserve_flood_token(submission->serverConnectionHandlerID);
+
+	struct timespec not_before;
+	clock_gettime(CLOCK_MONOTONIC, &not_before);
+	not_before.tv_sec += (time_t)delay;
+	not_before.tv_nsec += (long)((delay - (time_t)delay) * 1e9);
+	not_before.tv_sec += not_before.tv_nsec / 1000000000L;
+	not_before.tv_nsec %= 1000000000L;
+
+	bool behind = false;
+	for (struct Submission *deferred = submissions.deferred; deferred != NULL; deferred = deferred->next)
+	{
+		if (deferred->serverConnectionHandlerID != submission->serverConnectionHandlerID)
+			continue;
+		behind = true;
+		if (deadline_passed(&not_before, &deferred->not_before))
+			not_before = deferred->not_before;
+	}
+	if (delay <= 0 && behind == false)
+		return false;
+
+	struct Submission **position = &submissions.deferred;
+	while (*position != NULL && deadline_passed(&(*position)->not_before, &not_before))
+		position = &(*position)->next;
+	submission->not_before = not_before;
+	submission->next = *position;
+	*position = submission;
+	return true;
+}
+
+/*
+ * Sends the deferred submissions whose time has come and returns the
+ * milliseconds until the next one. Submissions that waited past their
+ * deadline complete with ERROR_connection_lost without being sent, as they
+ * would if the server had not answered them in time.
+ */
+static int send_deferred_submissions(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (struct Submission **position = &submissions.deferred; *position != NULL;)
+	{
+		struct Submission *submission = *position;
+		if (deadline_passed(&submission->deadline, &now) == false)
+		{
+			position = &submission->next;
+			continue;
+		}
+		*position = submission->next;
+		complete_submission(submission, ERROR_connection_lost, 0);
+	}
+	while (submissions.deferred != NULL && deadline_passed(&submissions.deferred->not_before, &now))
+	{
+		struct Submission *submission = submissions.deferred;
+		submissions.deferred = submission->next;
+		send_submission(submission);
+	}
+	if (submissions.deferred == NULL)
+		return IO_WORKER_SWEEP_INTERVAL;
+
+	const struct timespec *next = &submissions.deferred->not_before;
+	const long long milliseconds = (next->tv_sec - now.tv_sec) * 1000LL + (next->tv_nsec - now.tv_nsec + 999999) / 1000000;
+	return milliseconds < IO_WORKER_SWEEP_INTERVAL ? (int)milliseconds : IO_WORKER_SWEEP_INTERVAL;
+}
+
+static void *io_worker(void *argument)
+{
+	(void)argument;
+	int timeout = IO_WORKER_SWEEP_INTERVAL;
+	while (atomic_load(&submissions.stopping) == false)
+	{
+		struct pollfd doorbell = { .fd = submissions.doorbell, .events = POLLIN };
+		if (poll(&doorbell, 1, timeout) > 0)
+		{
+			uint64_t rings;
+			ssize_t read_bytes = read(submissions.doorbell, &rings, sizeof(rings));
+			(void)read_bytes;
+		}
+
+		struct Submission *submission;
+		while ((submission = pop_submission()) != NULL)
+		{
+			if (defer_submission(submission) == false)
+				send_submission(submission);
+		}
+		timeout = send_deferred_submissions();
+		expire_submissions();
+	}
+	return NULL;
+}
+
+static bool start_io_worker(void)
+{
+	lock_mutex(&init_mutex);
+	if (submissions.running == false)
+	{
+		for (size_t i = 0; i < SUBMISSION_QUEUE_SIZE; ++i)
+			atomic_init(&submissions.slots[i].sequence, i);
+		atomic_init(&submissions.enqueue_position, 0);
+		atomic_init(&submissions.dequeue_position, 0);
+		atomic_init(&submissions.stopping, false);
+		submissions.deferred = NULL;
+		submissions.doorbell = eventfd(0, EFD_CLOEXEC);
+		if (submissions.doorbell >= 0)
+		{
+			submissions.running = pthread_create(&submissions.worker, NULL, &io_worker, NULL) == 0;
+			if (submissions.running == false)
+			{
+				close(submissions.doorbell);
+				submissions.doorbell = -1;
+			}
+		}
+	}
+	bool running = submissions.running;
+	unlock_mutex(&init_mutex);
+	return running;
+}
+
+static void ring_io_worker(void)
+{
+	uint64_t one = 1;
+	ssize_t written = write(submissions.doorbell, &one, sizeof(one));
+	(void)written;
+}
+
+/* The caller must hold init_mutex. Submissions still queued are dropped. */
+static void stop_io_worker(void)
+{
+	if (submissions.running == false)
+		return;
+
+	atomic_store(&submissions.stopping, true);
+	ring_io_worker();
+	pthread_join(submissions.worker, NULL);
+	close(submissions.doorbell);
+	submissions.doorbell = -1;
+
+	struct Submission *submission;
+	while ((submission = pop_submission()) != NULL)
+		free_submission(submission);
+	while ((submission = submissions.deferred) != NULL)
+	{
+		submissions.deferred = submission->next;
+		free_submission(submission);
+	}
+	submissions.running = false;
+}
+
+static bool init_sample_ring(struct SampleRing *ring, size_t minimum)
+{
+	size_t capacity = 1;
+	while (capacity < minimum)
+		capacity <<= 1;
+	ring->samples = malloc(capacity * sizeof(int16_t));
+	if (ring->samples == NULL)
+		return false;
+	ring->capacity = capacity;
+	atomic_init(&ring->read_position, 0);
+	atomic_init(&ring->write_position, 0);
+	atomic_init(&ring->next, NULL);
+	return true;
+}
+
+static size_t sample_ring_readable(struct SampleRing *ring)
+{
+	return atomic_load_explicit(&ring->write_position, memory_order_acquire) - atomic_load_explicit(&ring->read_position, memory_order_acquire);
+}
+
+/* Free space from the write position to the end of the buffer. Only the producer may call this. */
+static int16_t *sample_ring_write_region(struct SampleRing *ring, size_t *count)
+{
+	size_t write = atomic_load_explicit(&ring->write_position, memory_order_relaxed);
+	size_t read = atomic_load_explicit(&ring->read_position, memory_order_acquire);
+	size_t offset = write & (ring->capacity - 1);
+	size_t available = ring->capacity - (write - read);
+	*count = available < ring->capacity - offset ? available : ring->capacity - offset;
+	return ring->samples + offset;
+}
+
+static void sample_ring_commit_write(struct SampleRing *ring, size_t count)
+{
+	size_t write = atomic_load_explicit(&ring->write_position, memory_order_relaxed);
+	atomic_store_explicit(&ring->write_position, write + count, memory_order_release);
+}
+
+/* Samples from the read position to the end of the buffer. Only the consumer may call this. */
+static int16_t *sample_ring_read_region(struct SampleRing *ring, size_t *count)
+{
+	size_t read = atomic_load_explicit(&ring->read_position, memory_order_relaxed);
+	size_t write = atomic_load_explicit(&ring->write_position, memory_order_acquire);
+	size_t offset = read & (ring->capacity - 1);
+	size_t available = write - read;
+	*count = available < ring->capacity - offset ? available : ring->capacity - offset;
+	return ring->samples + offset;
+}
+
+static void sample_ring_commit_read(struct SampleRing *ring, size_t count)
+{
+	size_t read = atomic_load_explicit(&ring->read_position, memory_order_relaxed);
+	atomic_store_explicit(&ring->read_position, read + count, memory_order_release);
+}
+
+/* Copies whole samples into the ring and returns the number of bytes taken. */
+static size_t sample_ring_write_bytes(struct SampleRing *ring, const char *data, size_t length)
+{
+	size_t consumed = 0;
+	for (int part = 0; part < 2; ++part)
+	{
+		size_t count;
+		int16_t *region = sample_ring_write_region(ring, &count);
+		size_t samples = (length - consumed) / sizeof(int16_t);
+		if (samples > count)
+			samples = count;
+		if (samples == 0)
+			break;
+		memcpy(region, data + consumed, samples * sizeof(int16_t));
+		sample_ring_commit_write(ring, samples);
+		consumed += samples * sizeof(int16_t);
+	}
+	return consumed;
+}
+
+/*
+ * Reads from a stream straight into the free space of the ring and returns the
+ * number of bytes read. A trailing odd byte is kept until the next read.
+ */
+static size_t sample_ring_write_stream(struct SampleRing *ring, php_stream *stream, bool *has_carry, char *carry)
+{
+	size_t total = 0;
+	for (int part = 0; part < 2; ++part)
+	{
+		size_t count;
+		char *region = (char *)sample_ring_write_region(ring, &count);
+		if (count == 0)
+			break;
+
+		size_t offset = 0;
+		if (*has_carry)
+		{
+			region[0] = *carry;
+			offset = 1;
+			*has_carry = false;
+		}
+		const size_t wanted = count * sizeof(int16_t) - offset;
+		ssize_t received = php_stream_read(stream, region + offset, wanted);
+		if (received < 0)
+			received = 0;
+
+		size_t bytes = offset + received;
+		if (bytes % sizeof(int16_t))
+		{
+			*carry = region[bytes - 1];
+			*has_carry = true;
+		}
+		sample_ring_commit_write(ring, bytes / sizeof(int16_t));
+		total += received;
+		if ((size_t)received < wanted)
+			break;
+	}
+	return total;
+}
+
+static size_t sample_ring_writable(struct SampleRing *ring)
+{
+	return ring->capacity - sample_ring_readable(ring);
+}
+
+/* Hands everything buffered in the ring to a sink and returns the number of samples taken. Only the consumer may call this. */
+static size_t sample_ring_drain(struct SampleRing *ring, size_t (*sink)(void *context, const int16_t *samples, size_t count), void *context)
+{
+	size_t total = 0;
+	for (int part = 0; part < 2; ++part)
+	{
+		size_t count;
+		const int16_t *region = sample_ring_read_region(ring, &count);
+		if (count == 0)
+			break;
+		size_t taken = sink(context, region, count);
+		sample_ring_commit_read(ring, taken);
+		total += taken;
+		if (taken < count)
+			break;
+	}
+	return total;
+}
+
+static void put_le16(unsigned char *target, uint16_t value)
+{
+	target[0] = value & 0xff;
+	target[1] = value >> 8;
+}
+
+static void put_le32(unsigned char *target, uint32_t value)
+{
+	put_le16(target, value & 0xffff);
+	put_le16(target + 2, value >> 16);
+}
+
+static void wav_header(unsigned char *header, int frequency, int channels, uint32_t data_bytes)
+{
+	memcpy(header, "RIFF", 4);
+	put_le32(header + 4, data_bytes == UINT32_MAX ? UINT32_MAX : data_bytes + WAV_HEADER_SIZE - 8);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	put_le32(header + 16, 16);
+	put_le16(header + 20, 1);
+	put_le16(header + 22, channels);
+	put_le32(header + 24, frequency);
+	put_le32(header + 28, frequency * channels * sizeof(int16_t));
+	put_le16(header + 32, channels * sizeof(int16_t));
+	put_le16(header + 34, 16);
+	memcpy(header + 36, "data", 4);
+	put_le32(header + 40, data_bytes);
+}
+
+static bool write_fully(int fd, const void *data, size_t length)
+{
+	const char *pointer = data;
+	while (length > 0)
+	{
+		ssize_t written = write(fd, pointer, length);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		pointer += written;
+		length -= written;
+	}
+	return true;
+}
+
+static struct WavFile *wav_create(const char *path, int frequency, int channels)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return NULL;
+
+	unsigned char header[WAV_HEADER_SIZE];
+	wav_header(header, frequency, channels, UINT32_MAX);
+	if (write_fully(fd, header, sizeof(header)) == false)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	struct WavFile *file = malloc(sizeof(struct WavFile));
+	file->fd = fd;
+	file->frequency = frequency;
+	file->channels = channels;
+	file->data_bytes = 0;
+	file->failed = false;
+	clock_gettime(CLOCK_MONOTONIC, &file->header_updated);
+	return file;
+}
+
+static void wav_update_header(struct WavFile *file)
+{
+	unsigned char header[WAV_HEADER_SIZE];
+	uint64_t data_bytes = file->data_bytes;
+	if (data_bytes > UINT32_MAX - WAV_HEADER_SIZE)
+		data_bytes = UINT32_MAX - WAV_HEADER_SIZE;
+	wav_header(header, file->frequency, file->channels, data_bytes);
+	if (pwrite(file->fd, header, sizeof(header), 0) != sizeof(header))
+		file->failed = true;
+	clock_gettime(CLOCK_MONOTONIC, &file->header_updated);
+}
+
+/*
+ * Appends samples to the data chunk. Once a write failed the file is marked
+ * failed and later samples are discarded, so the ring keeps draining and the
+ * failure is reported instead of leaving a hole in the middle of the file.
+ */
+static size_t wav_sink(void *context, const int16_t *samples, size_t count)
+{
+	struct WavFile *file = context;
+	if (file->failed == false && write_fully(file->fd, samples, count * sizeof(int16_t)) == false)
+		file->failed = true;
+	if (file->failed == false)
+		file->data_bytes += count * sizeof(int16_t);
+	return count;
+}
+
+/* Returns false if any write to the file failed. */
+static bool wav_close(struct WavFile *file)
+{
+	wav_update_header(file);
+	bool written = close(file->fd) == 0 && file->failed == false;
+	free(file);
+	return written;
+}
+
+static size_t frame_samples(int frequency)
+{
+	return (size_t)frequency / 1000 * CUSTOM_DEVICE_FRAME_MS;
+}
+
+/* The caller must hold device_mutex. */
+static struct CustomDevice *find_custom_device(const char *id)
+{
+	struct CustomDevice *device = custom_devices;
+	while (device != NULL && strcmp(device->id, id) != 0)
+		device = device->next;
+	return device;
+}
+
+static struct CustomDevice *acquire_custom_device(const char *id)
+{
+	lock_mutex(&device_mutex);
+	struct CustomDevice *device = find_custom_device(id);
+	if (device != NULL)
+		atomic_fetch_add(&device->references, 1);
+	unlock_mutex(&device_mutex);
+	return device;
+}
+
+static void free_playback_ring(struct CustomDevice *device, struct SampleRing *ring)
+{
+	free(ring->samples);
+	ring->samples = NULL;
+	if (ring != &device->playback)
+		free(ring);
+}
+
+/* Hands the buffered playback of a device to a sink, moving on to the grown rings. The caller must hold record_lock. */
+static size_t drain_playback(struct CustomDevice *device, size_t (*sink)(void *context, const int16_t *samples, size_t count), void *context)
+{
+	size_t total = 0;
+	for (;;)
+	{
+		struct SampleRing *ring = device->playback_reading;
+		struct SampleRing *next = atomic_load_explicit(&ring->next, memory_order_acquire);
+		total += sample_ring_drain(ring, sink, context);
+		if (next == NULL || sample_ring_readable(ring) > 0)
+			return total;
+		device->playback_reading = next;
+		free_playback_ring(device, ring);
+	}
+}
+
+static size_t discard_sink(void *context, const int16_t *samples, size_t count)
+{
+	(void)context;
+	(void)samples;
+	return count;
+}
+
+/* Returns the samples buffered in all rings and the capacity of the newest one. The caller must hold record_lock. */
+static size_t buffered_playback(struct CustomDevice *device, size_t *capacity)
+{
+	size_t buffered = 0;
+	for (struct SampleRing *ring = device->playback_reading; ring != NULL; ring = atomic_load_explicit(&ring->next, memory_order_acquire))
+	{
+		buffered += sample_ring_readable(ring);
+		*capacity = ring->capacity;
+	}
+	return buffered;
+}
+
+static void release_custom_device(struct CustomDevice *device)
+{
+	if (atomic_fetch_sub(&device->references, 1) != 1)
+		return;
+	if (device->recording != NULL)
+	{
+		drain_playback(device, &wav_sink, device->recording);
+		wav_close(device->recording);
+	}
+	free(device->capture.samples);
+	for (struct SampleRing *ring = device->playback_reading; ring != NULL;)
+	{
+		struct SampleRing *next = atomic_load(&ring->next);
+		free_playback_ring(device, ring);
+		ring = next;
+	}
+	pthread_mutex_destroy(&device->feed_lock);
+	pthread_mutex_destroy(&device->record_lock);
+	free(device->id);
+	free(device->display_name);
+	free(device);
+}
+
+/* Applies the gain of a device to a frame and publishes the level of the result. */
+static void process_frame(int16_t *samples, size_t count, _Atomic float *gain, atomic_int *peak, atomic_int *rms)
+{
+	const float factor = atomic_load_explicit(gain, memory_order_relaxed);
+	if (factor != 1.0f)
+		audio_kernels->gain(samples, count, factor);
+	struct AudioLevel level = { 0, 0 };
+	audio_kernels->level(samples, count, &level);
+	atomic_store_explicit(peak, level.peak, memory_order_relaxed);
+	atomic_store_explicit(rms, audio_level_rms(&level, count), memory_order_relaxed);
+}
+
+/* Hands one frame of captured audio to the client lib, straight from the ring unless the frame wraps around its end. */
+static void pace_capture(struct CustomDevice *device, int16_t *frame)
+{
+	const size_t samples = frame_samples(device->capture_frequency);
+	const size_t count = samples * device->capture_channels;
+	const size_t readable = sample_ring_readable(&device->capture);
+	if (readable < count)
+	{
+		if (device->capture_active || readable > 0)
+			atomic_fetch_add(&device->capture_underruns, 1);
+		device->capture_active = false;
+		return;
+	}
+
+	size_t contiguous;
+	int16_t *region = sample_ring_read_region(&device->capture, &contiguous);
+	if (contiguous < count)
+	{
+		memcpy(frame, region, contiguous * sizeof(int16_t));
+		memcpy(frame + contiguous, device->capture.samples, (count - contiguous) * sizeof(int16_t));
+		region = frame;
+	}
+	process_frame(region, count, &device->capture_gain, &device->capture_peak, &device->capture_rms);
+	ts3client_processCustomCaptureData(device->id, region, samples);
+	sample_ring_commit_read(&device->capture, count);
+	device->capture_active = true;
+}
+
+/*
+ * Continues the playback of a device in a ring twice the size of the full one,
+ * so a consumer stalled on slow I/O never makes the pacer drop or wait. Returns
+ * NULL once the buffer reached CUSTOM_PLAYBACK_MAX_BUFFER_MS.
+ */
+static struct SampleRing *grow_playback(struct CustomDevice *device)
+{
+	struct SampleRing *full = device->playback_writing;
+	const size_t maximum = (size_t)device->playback_frequency * device->playback_channels / 1000 * CUSTOM_PLAYBACK_MAX_BUFFER_MS;
+	if (full->capacity >= maximum)
+		return NULL;
+	struct SampleRing *ring = malloc(sizeof(struct SampleRing));
+	if (ring == NULL || init_sample_ring(ring, full->capacity * 2) == false)
+	{
+		free(ring);
+		return NULL;
+	}
+	atomic_store_explicit(&full->next, ring, memory_order_release);
+	device->playback_writing = ring;
+	return ring;
+}
+
+/*
+ * Takes one frame of mixed playback from the client lib. Silence is recorded
+ * while nothing is played, so the recording keeps its timeline. A frame that
+ * does not fit because the consumer fell behind goes to a grown ring; it is
+ * only dropped and counted once the buffer cannot grow any further.
+ */
+static void pace_playback(struct CustomDevice *device, int16_t *frame)
+{
+	const size_t samples = frame_samples(device->playback_frequency);
+	const size_t count = samples * device->playback_channels;
+	if (atomic_load(&device->playback_capturing) == false)
+		return;
+	struct SampleRing *ring = device->playback_writing;
+	if (sample_ring_writable(ring) < count && (ring = grow_playback(device)) == NULL)
+	{
+		ts3client_acquireCustomPlaybackData(device->id, frame, samples);
+		atomic_fetch_add(&device->playback_overruns, 1);
+		return;
+	}
+
+	size_t contiguous;
+	int16_t *region = sample_ring_write_region(ring, &contiguous);
+	int16_t *target = contiguous >= count ? region : frame;
+	if (ts3client_acquireCustomPlaybackData(device->id, target, samples) != ERROR_ok)
+		memset(target, 0, count * sizeof(int16_t));
+	process_frame(target, count, &device->playback_gain, &device->playback_peak, &device->playback_rms);
+	if (target == region)
+		sample_ring_commit_write(ring, count);
+	else
+		sample_ring_write_bytes(ring, (const char *)frame, count * sizeof(int16_t));
+}
+
+static void timespec_add_ms(struct timespec *time, long milliseconds)
+{
+	time->tv_nsec += milliseconds * 1000000L;
+	time->tv_sec += time->tv_nsec / 1000000000L;
+	time->tv_nsec %= 1000000000L;
+}
+
+static long timespec_diff_ms(const struct timespec *later, const struct timespec *earlier)
+{
+	return (later->tv_sec - earlier->tv_sec) * 1000L + (later->tv_nsec - earlier->tv_nsec) / 1000000L;
+}
+
+/*
+ * Drives all custom devices in 20 ms frames on absolute deadlines, so the
+ * frame rate does not drift with the time spent per frame. After a stall the
+ * schedule restarts instead of sending a burst of late frames.
+ */
+static void *pace_custom_devices(void *argument)
+{
+	(void)argument;
+	int16_t frame[CUSTOM_DEVICE_MAX_FRAME];
+	struct sched_param parameter = { .sched_priority = sched_get_priority_min(SCHED_FIFO) };
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameter);
+
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (atomic_load(&pacer.stopping) == false)
+	{
+		timespec_add_ms(&next, CUSTOM_DEVICE_FRAME_MS);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (timespec_diff_ms(&now, &next) > PACER_MAX_LATENESS_MS)
+			next = now;
+
+		lock_mutex(&device_mutex);
+		for (struct CustomDevice *device = custom_devices; device != NULL; device = device->next)
+		{
+			pace_capture(device, frame);
+			pace_playback(device, frame);
+		}
+		unlock_mutex(&device_mutex);
+	}
+	return NULL;
+}
+
+/* The caller must hold device_mutex. */
+static bool start_pacer(void)
+{
+	if (pacer.running == false)
+	{
+		atomic_store(&pacer.stopping, false);
+		pacer.running = pthread_create(&pacer.thread, NULL, &pace_custom_devices, NULL) == 0;
+	}
+	return pacer.running;
+}
+
+/* The caller must not hold device_mutex. */
+static void stop_pacer(void)
+{
+	if (pacer.running == false)
+		return;
+	atomic_store(&pacer.stopping, true);
+	pthread_join(pacer.thread, NULL);
+	pacer.running = false;
+}
+
+static long long monotonic_ms(const struct timespec *time)
+{
+	return (long long)time->tv_sec * 1000 + time->tv_nsec / 1000000;
+}
+
+/* Finds the track of a client and registers the calling audio thread as its writer. */
+static struct SpeakerTrack *enter_speaker_track(uint64 serverConnectionHandlerID, anyID clientID)
+{
+	for (int i = 0; i < SPEAKER_TRACKS; ++i)
+	{
+		struct SpeakerTrack *track = &speakers.tracks[i];
+		if (atomic_load(&track->state) != SPEAKER_ACTIVE)
+			continue;
+		atomic_fetch_add(&track->writers, 1);
+		if (atomic_load(&track->state) == SPEAKER_ACTIVE && track->serverConnectionHandlerID == serverConnectionHandlerID && track->clientID == clientID)
+			return track;
+		atomic_fetch_sub(&track->writers, 1);
+	}
+	return NULL;
+}
+
+static struct SpeakerTrack *claim_speaker_track(uint64 serverConnectionHandlerID, anyID clientID, const struct timespec *now)
+{
+	for (int i = 0; i < SPEAKER_TRACKS; ++i)
+	{
+		struct SpeakerTrack *track = &speakers.tracks[i];
+		int expected = SPEAKER_FREE;
+		if (atomic_compare_exchange_strong(&track->state, &expected, SPEAKER_CLAIMED) == false)
+			continue;
+		track->serverConnectionHandlerID = serverConnectionHandlerID;
+		track->clientID = clientID;
+		track->started_monotonic = *now;
+		clock_gettime(CLOCK_REALTIME, &track->started);
+		track->timeline = 0;
+		atomic_store(&track->last_active, monotonic_ms(now));
+		atomic_store(&track->gap_read, 0);
+		atomic_store(&track->gap_write, 0);
+		atomic_store(&track->overruns, 0);
+		atomic_fetch_add(&track->writers, 1);
+		atomic_store(&track->state, SPEAKER_ACTIVE);
+		return track;
+	}
+	return NULL;
+}
+
+/* Places a mono frame on the timeline of its track, marking a gap first if the client paused speaking. */
+static void append_speaker_frame(struct SpeakerTrack *track, const int16_t *samples, int sampleCount, const struct timespec *now)
+{
+	const uint64_t elapsed = (uint64_t)((now->tv_sec - track->started_monotonic.tv_sec) * 1000000000LL + (now->tv_nsec - track->started_monotonic.tv_nsec)) * SPEAKER_FREQUENCY / 1000000000;
+	const uint64_t offset = elapsed > (uint64_t)sampleCount ? elapsed - sampleCount : 0;
+	if (offset > track->timeline + SPEAKER_FREQUENCY / 1000 * SPEAKER_GAP_MS)
+	{
+		size_t write = atomic_load_explicit(&track->gap_write, memory_order_relaxed);
+		if (write - atomic_load_explicit(&track->gap_read, memory_order_acquire) < SPEAKER_GAPS)
+		{
+			struct SpeakerGap *gap = &track->gaps[write % SPEAKER_GAPS];
+			gap->position = atomic_load_explicit(&track->samples.write_position, memory_order_relaxed);
+			gap->offset = offset;
+			atomic_store_explicit(&track->gap_write, write + 1, memory_order_release);
+			track->timeline = offset;
+		}
+	}
+
+	const size_t count = sampleCount;
+	if (sample_ring_writable(&track->samples) < count)
+	{
+		atomic_fetch_add(&track->overruns, 1);
+		return;
+	}
+	sample_ring_write_bytes(&track->samples, (const char *)samples, count * sizeof(int16_t));
+	track->timeline += sampleCount;
+
+	struct AudioLevel level = { 0, 0 };
+	audio_kernels->level(samples, count, &level);
+	atomic_store_explicit(&track->peak, level.peak, memory_order_relaxed);
+	atomic_store_explicit(&track->rms, audio_level_rms(&level, count), memory_order_relaxed);
+	atomic_store(&track->last_active, monotonic_ms(now));
+}
+
+/* Called on the audio thread of a connection for every client it plays back; must not block or allocate. */
+TS3_CALLBACK(onEditPlaybackVoiceDataEvent, (uint64 serverConnectionHandlerID, anyID clientID, short* samples, int sampleCount, int channels),
+	(serverConnectionHandlerID, clientID, samples, sampleCount, channels))
+{
+	if (atomic_load(&speakers.active) == false || channels < 1 || channels > CUSTOM_DEVICE_MAX_CHANNELS)
+		return;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct SpeakerTrack *track = enter_speaker_track(serverConnectionHandlerID, clientID);
+	if (track == NULL)
+		track = claim_speaker_track(serverConnectionHandlerID, clientID, &now);
+	if (track == NULL)
+	{
+		atomic_fetch_add(&speakers.dropped, 1);
+		return;
+	}
+
+	int16_t mono[SPEAKER_MAX_FRAME];
+	if (channels == 1)
+		append_speaker_frame(track, samples, sampleCount, &now);
+	else if (sampleCount <= SPEAKER_MAX_FRAME)
+	{
+		audio_kernels->downmix(samples, mono, sampleCount);
+		append_speaker_frame(track, mono, sampleCount, &now);
+	}
+	else
+		atomic_fetch_add(&track->overruns, 1);
+	atomic_fetch_sub(&track->writers, 1);
+}
+
+static void write_silence(struct WavFile *file, uint64_t samples)
+{
+	static const int16_t silence[1024];
+	while (samples > 0)
+	{
+		size_t count = samples < 1024 ? samples : 1024;
+		wav_sink(file, silence, count);
+		samples -= count;
+	}
+}
+
+struct SpeakerSink
+{
+	struct SpeakerTrack *track;
+	size_t remaining;
+};
+
+static size_t speaker_sink(void *context, const int16_t *samples, size_t count)
+{
+	struct SpeakerSink *sink = context;
+	if (count > sink->remaining)
+		count = sink->remaining;
+	if (sink->track->file != NULL)
+		wav_sink(sink->track->file, samples, count);
+	sink->track->written += count;
+	sink->remaining -= count;
+	return count;
+}
+
+/* Writes the buffered voice of a track to its file, padding every gap with silence. The caller must hold speakers.lock. */
+static void drain_speaker_track(struct SpeakerTrack *track)
+{
+	if (track->file == NULL && track->path == NULL)
+	{
+		const size_t length = strlen(speakers.directory) + 80;
+		track->path = malloc(length);
+		snprintf(track->path, length, "%s/%llu-%u-%lld%03ld.wav", speakers.directory, (unsigned long long)track->serverConnectionHandlerID, (unsigned int)track->clientID, (long long)track->started.tv_sec, track->started.tv_nsec / 1000000);
+		track->file = wav_create(track->path, SPEAKER_FREQUENCY, 1);
+	}
+
+	struct SpeakerSink sink = { track, 0 };
+	for (;;)
+	{
+		size_t read = atomic_load_explicit(&track->samples.read_position, memory_order_relaxed);
+		size_t gap_read = atomic_load_explicit(&track->gap_read, memory_order_relaxed);
+		if (gap_read == atomic_load_explicit(&track->gap_write, memory_order_acquire))
+		{
+			sink.remaining = SIZE_MAX;
+			sample_ring_drain(&track->samples, &speaker_sink, &sink);
+			break;
+		}
+
+		const struct SpeakerGap *gap = &track->gaps[gap_read % SPEAKER_GAPS];
+		sink.remaining = gap->position - read;
+		sample_ring_drain(&track->samples, &speaker_sink, &sink);
+		if (sink.remaining > 0)
+			break;
+		if (gap->offset > track->written)
+		{
+			if (track->file != NULL)
+				write_silence(track->file, gap->offset - track->written);
+			track->written = gap->offset;
+		}
+		atomic_store_explicit(&track->gap_read, gap_read + 1, memory_order_release);
+	}
+}
+
+/* Takes a track from the audio threads, completes its file and returns it to the pool. The caller must hold speakers.lock. */
+static void close_speaker_track(struct SpeakerTrack *track)
+{
+	int expected = SPEAKER_ACTIVE;
+	if (atomic_compare_exchange_strong(&track->state, &expected, SPEAKER_CLOSING) == false)
+		return;
+	while (atomic_load(&track->writers) > 0)
+		sched_yield();
+
+	drain_speaker_track(track);
+	if (track->file != NULL)
+		wav_close(track->file);
+	free(track->path);
+	track->file = NULL;
+	track->path = NULL;
+	track->written = 0;
+	atomic_store(&track->state, SPEAKER_FREE);
+}
+
+static void write_speaker_tracks(const struct timespec *now)
+{
+	lock_mutex(&speakers.lock);
+	for (int i = 0; speakers.tracks != NULL && i < SPEAKER_TRACKS; ++i)
+	{
+		struct SpeakerTrack *track = &speakers.tracks[i];
+		if (atomic_load(&track->state) != SPEAKER_ACTIVE)
+			continue;
+		if (monotonic_ms(now) - atomic_load(&track->last_active) >= SPEAKER_IDLE_MS)
+		{
+			close_speaker_track(track);
+			continue;
+		}
+		drain_speaker_track(track);
+		if (track->file != NULL && timespec_diff_ms(now, &track->file->header_updated) >= WAV_HEADER_UPDATE_MS)
+			wav_update_header(track->file);
+	}
+	unlock_mutex(&speakers.lock);
+}
+
+/* Only called once the client lib is destroyed, so no audio thread can use the tracks anymore. */
+static void free_speaker_tracks(void)
+{
+	atomic_store(&speakers.active, false);
+	if (speakers.tracks == NULL)
+		return;
+	for (int i = 0; i < SPEAKER_TRACKS; ++i)
+	{
+		close_speaker_track(&speakers.tracks[i]);
+		free(speakers.tracks[i].samples.samples);
+	}
+	free(speakers.tracks);
+	free(speakers.directory);
+	speakers.tracks = NULL;
+	speakers.directory = NULL;
+}
+
+/* A child must neither write to nor complete the files of its parent. */
+static void forget_speaker_tracks(void)
+{
+	atomic_store(&speakers.active, false);
+	if (speakers.tracks == NULL)
+		return;
+	for (int i = 0; i < SPEAKER_TRACKS; ++i)
+	{
+		struct SpeakerTrack *track = &speakers.tracks[i];
+		if (track->file != NULL)
+		{
+			close(track->file->fd);
+			free(track->file);
+		}
+		free(track->path);
+		track->file = NULL;
+		track->path = NULL;
+		track->written = 0;
+		atomic_store(&track->writers, 0);
+		atomic_store(&track->samples.read_position, atomic_load(&track->samples.write_position));
+		atomic_store(&track->state, SPEAKER_FREE);
+	}
+}
+
+/* Writes recorded playback to disk, so the pacer never waits for file I/O and PHP never has to drain recordings. */
+static void *write_recordings(void *argument)
+{
+	(void)argument;
+	while (atomic_load(&recorder.stopping) == false)
+	{
+		struct timespec interval = { 0, RECORDER_INTERVAL_MS * 1000000L };
+		nanosleep(&interval, NULL);
+
+		size_t count = 0, capacity = 0;
+		struct CustomDevice **devices = NULL;
+		lock_mutex(&device_mutex);
+		for (struct CustomDevice *device = custom_devices; device != NULL; device = device->next)
+		{
+			if (atomic_load(&device->playback_capturing) == false)
+				continue;
+			if (count == capacity)
+			{
+				capacity = capacity ? capacity * 2 : 8;
+				devices = realloc(devices, capacity * sizeof(*devices));
+			}
+			atomic_fetch_add(&device->references, 1);
+			devices[count++] = device;
+		}
+		unlock_mutex(&device_mutex);
+
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		for (size_t i = 0; i < count; ++i)
+		{
+			struct CustomDevice *device = devices[i];
+			pthread_mutex_lock(&device->record_lock);
+			if (device->recording != NULL)
+			{
+				drain_playback(device, &wav_sink, device->recording);
+				if (timespec_diff_ms(&now, &device->recording->header_updated) >= WAV_HEADER_UPDATE_MS)
+					wav_update_header(device->recording);
+			}
+			pthread_mutex_unlock(&device->record_lock);
+			release_custom_device(device);
+		}
+		free(devices);
+		write_speaker_tracks(&now);
+	}
+	return NULL;
+}
+
+/* The caller must hold device_mutex. */
+static bool start_recorder(void)
+{
+	if (recorder.running == false)
+	{
+		atomic_store(&recorder.stopping, false);
+		recorder.running = pthread_create(&recorder.thread, NULL, &write_recordings, NULL) == 0;
+	}
+	return recorder.running;
+}
+
+/* The caller must not hold device_mutex. */
+static void stop_recorder(void)
+{
+	if (recorder.running == false)
+		return;
+	atomic_store(&recorder.stopping, true);
+	pthread_join(recorder.thread, NULL);
+	recorder.running = false;
+}
+
+/* The caller must hold transfers.lock. */
+static struct TransferConnection *get_transfer_connection(uint64_t serverConnectionHandlerID)
+{
+	struct TransferConnection *connection = transfers.connections;
+	while (connection != NULL && connection->serverConnectionHandlerID != serverConnectionHandlerID)
+		connection = connection->next;
+	if (connection == NULL)
+	{
+		connection = malloc(sizeof(struct TransferConnection));
+		connection->serverConnectionHandlerID = serverConnectionHandlerID;
+		connection->parallelism = TRANSFER_DEFAULT_PARALLELISM;
+		connection->running = 0;
+		connection->next = transfers.connections;
+		transfers.connections = connection;
+	}
+	return connection;
+}
+
+/* The caller must hold transfers.lock. */
+static struct Transfer *find_transfer(uint64_t id)
+{
+	struct Transfer *transfer = transfers.transfers;
+	while (transfer != NULL && transfer->id != id)
+		transfer = transfer->next;
+	return transfer;
+}
+
+/* The caller must hold transfers.lock. */
+static void end_transfer(struct Transfer *transfer, enum TransferState state, unsigned int error)
+{
+	if (transfer->state == TRANSFER_STARTING || transfer->state == TRANSFER_RUNNING)
+		--get_transfer_connection(transfer->serverConnectionHandlerID)->running;
+	transfer->state = state;
+	transfer->error = error;
+	transfers.pending = true;
+	pthread_cond_signal(&transfers.wake);
+	pthread_cond_broadcast(&transfers.ended);
+}
+
+static void free_transfer(struct Transfer *transfer)
+{
+	free(transfer->channel_password);
+	free(transfer->file);
+	free(transfer->directory);
+	free(transfer);
+}
+
+TS3_CALLBACK(onFileTransferStatusEvent, (anyID transferID, unsigned int status, const char* statusMessage, uint64 remotefileSize, uint64 serverConnectionHandlerID),
+	(transferID, status, statusMessage, remotefileSize, serverConnectionHandlerID))
+{
+	(void)statusMessage;
+	lock_mutex(&transfers.lock);
+	for (struct Transfer *transfer = transfers.transfers; transfer != NULL; transfer = transfer->next)
+	{
+		if (transfer->state != TRANSFER_RUNNING || transfer->transfer_id != transferID || transfer->serverConnectionHandlerID != serverConnectionHandlerID)
+			continue;
+		if (status == ERROR_file_transfer_complete)
+		{
+			transfer->size = remotefileSize ? remotefileSize : transfer->size;
+			transfer->done = transfer->size;
+			end_transfer(transfer, TRANSFER_DONE, ERROR_ok);
+		}
+		else
+			end_transfer(transfer, TRANSFER_FAILED, status);
+		break;
+	}
+	unlock_mutex(&transfers.lock);
+}
+
+/* Takes queued transfers for every free slot, in queue order. The caller must hold transfers.lock. */
+static size_t take_startable_transfers(struct Transfer ***startable)
+{
+	size_t count = 0, capacity = 0;
+	for (struct Transfer *transfer = transfers.transfers; transfer != NULL; transfer = transfer->next)
+	{
+		if (transfer->state != TRANSFER_QUEUED)
+			continue;
+		struct TransferConnection *connection = get_transfer_connection(transfer->serverConnectionHandlerID);
+		if (connection->running >= connection->parallelism)
+			continue;
+		if (count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 8;
+			*startable = realloc(*startable, capacity * sizeof(**startable));
+		}
+		++connection->running;
+		transfer->state = TRANSFER_STARTING;
+		(*startable)[count++] = transfer;
+	}
+	return count;
+}
+
+/*
+ * Starts transfers pipelined and waits for the server to accept them.
+ * Transfers stay alive while they are starting; once they run they can be
+ * canceled and removed, so after the wait they are looked up by ID again.
+ */
+static void start_transfers(struct Transfer **startable, size_t count)
+{
+	struct WaitItem **items = calloc(count, sizeof(*items));
+	unsigned int *errors = calloc(count, sizeof(*errors));
+	anyID *transfer_ids = calloc(count, sizeof(*transfer_ids));
+	uint64_t *ids = calloc(count, sizeof(*ids));
+	for (size_t i = 0; i < count; ++i)
+	{
+		struct Transfer *transfer = startable[i];
+		ids[i] = transfer->id;
+		throttle_native(transfer->serverConnectionHandlerID);
+		items[i] = create_return_code_item();
+		unsigned int error;
+		if (transfer->upload)
+			error = ts3client_sendFile(transfer->serverConnectionHandlerID, transfer->channelID, transfer->channel_password, transfer->file, transfer->overwrite, transfer->resume, transfer->directory, &transfer_ids[i], items[i]->return_code_text);
+		else
+			error = ts3client_requestFile(transfer->serverConnectionHandlerID, transfer->channelID, transfer->channel_password, transfer->file, transfer->overwrite, transfer->resume, transfer->directory, &transfer_ids[i], items[i]->return_code_text);
+		batch_sent(&items[i], &errors[i], error);
+
+		lock_mutex(&transfers.lock);
+		if (errors[i] == ERROR_ok)
+		{
+			transfer->transfer_id = transfer_ids[i];
+			transfer->state = TRANSFER_RUNNING;
+		}
+		else
+			end_transfer(transfer, TRANSFER_FAILED, errors[i]);
+		unlock_mutex(&transfers.lock);
+	}
+
+	static atomic_int stats_id = ATOMIC_VAR_INIT(-1);
+	struct timespec started, timeout;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += TIMEOUT;
+	wait_for_items_until(items, errors, count, &timeout);
+	size_t timeouts = 0;
+	for (size_t i = 0; i < count; ++i)
+		timeouts += items[i] != NULL && errors[i] == ERROR_connection_lost;
+	record_wait_in(&stats.native, register_stats_function(&stats_id, "transfer scheduler"), &started, timeouts);
+	free_items(items, count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		lock_mutex(&transfers.lock);
+		struct Transfer *transfer = find_transfer(ids[i]);
+		const bool halt = transfer != NULL && transfer->state == TRANSFER_RUNNING && (transfer->cancel || errors[i] != ERROR_ok);
+		const uint64_t serverConnectionHandlerID = halt ? transfer->serverConnectionHandlerID : 0;
+		if (halt)
+		{
+			if (transfer->cancel)
+				end_transfer(transfer, TRANSFER_CANCELED, ERROR_ok);
+			else
+				end_transfer(transfer, TRANSFER_FAILED, errors[i]);
+		}
+		unlock_mutex(&transfers.lock);
+		if (halt)
+			ts3client_haltTransfer(serverConnectionHandlerID, transfer_ids[i], 1, NULL);
+	}
+	free(items);
+	free(errors);
+	free(transfer_ids);
+	free(ids);
+}
+
+struct TransferProgress
+{
+	uint64_t id;
+	anyID transfer_id;
+	uint64_t size;
+	uint64_t done;
+	float speed;
+};
+
+/* Copies the progress the client lib reports into the table of the manager. */
+static void poll_transfer_progress(void)
+{
+	size_t count = 0, capacity = 0;
+	struct TransferProgress *progress = NULL;
+	lock_mutex(&transfers.lock);
+	for (struct Transfer *transfer = transfers.transfers; transfer != NULL; transfer = transfer->next)
+	{
+		if (transfer->state != TRANSFER_RUNNING)
+			continue;
+		if (count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 8;
+			progress = realloc(progress, capacity * sizeof(*progress));
+		}
+		progress[count].id = transfer->id;
+		progress[count++].transfer_id = transfer->transfer_id;
+	}
+	unlock_mutex(&transfers.lock);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint64 size = 0, done = 0;
+		ts3client_getTransferFileSize(progress[i].transfer_id, &size);
+		ts3client_getTransferFileSizeDone(progress[i].transfer_id, &done);
+		progress[i].speed = 0;
+		ts3client_getCurrentTransferSpeed(progress[i].transfer_id, &progress[i].speed);
+		progress[i].size = size;
+		progress[i].done = done;
+	}
+
+	lock_mutex(&transfers.lock);
+	struct Transfer *transfer = transfers.transfers;
+	for (size_t i = 0; i < count; ++i)
+	{
+		while (transfer != NULL && transfer->id != progress[i].id)
+			transfer = transfer->next;
+		if (transfer == NULL)
+			break;
+		if (transfer->state == TRANSFER_RUNNING && transfer->transfer_id == progress[i].transfer_id)
+		{
+			transfer->size = progress[i].size;
+			transfer->done = progress[i].done;
+			transfer->speed = progress[i].speed;
+		}
+	}
+	unlock_mutex(&transfers.lock);
+	free(progress);
+}
+
+static void *schedule_transfers(void *argument)
+{
+	(void)argument;
+	struct Transfer **startable = NULL;
+	while (atomic_load(&transfers.scheduler.stopping) == false)
+	{
+		struct timespec timeout;
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timespec_add_ms(&timeout, TRANSFER_SWEEP_MS);
+		lock_mutex(&transfers.lock);
+		while (transfers.pending == false && atomic_load(&transfers.scheduler.stopping) == false && wait_mutex_cond(&transfers.wake, &transfers.lock, &timeout) == 0);
+		transfers.pending = false;
+		size_t count = take_startable_transfers(&startable);
+		unlock_mutex(&transfers.lock);
+
+		if (count > 0)
+			start_transfers(startable, count);
+		poll_transfer_progress();
+	}
+	free(startable);
+	return NULL;
+}
+
+/* The caller must hold transfers.lock. */
+static bool start_transfer_scheduler(void)
+{
+	if (transfers.scheduler.running == false)
+	{
+		atomic_store(&transfers.scheduler.stopping, false);
+		transfers.scheduler.running = pthread_create(&transfers.scheduler.thread, NULL, &schedule_transfers, NULL) == 0;
+	}
+	return transfers.scheduler.running;
+}
+
+/* The caller must not hold transfers.lock. */
+static void stop_transfer_scheduler(void)
+{
+	if (transfers.scheduler.running == false)
+		return;
+	lock_mutex(&transfers.lock);
+	atomic_store(&transfers.scheduler.stopping, true);
+	pthread_cond_signal(&transfers.wake);
+	unlock_mutex(&transfers.lock);
+	pthread_join(transfers.scheduler.thread, NULL);
+	transfers.scheduler.running = false;
+}
+
+static void free_transfers(void)
+{
+	while (transfers.transfers != NULL)
+	{
+		struct Transfer *next = transfers.transfers->next;
+		free_transfer(transfers.transfers);
+		transfers.transfers = next;
+	}
+	while (transfers.connections != NULL)
+	{
+		struct TransferConnection *next = transfers.connections->next;
+		free(transfers.connections);
+		transfers.connections = next;
+	}
+}
+
+/* Appends a transfer to the queue and returns its ID, or 0 if it could not be queued and was freed. */
+static uint64_t add_transfer(struct Transfer *transfer)
+{
+	lock_mutex(&transfers.lock);
+	if (start_transfer_scheduler() == false)
+	{
+		unlock_mutex(&transfers.lock);
+		free_transfer(transfer);
+		return 0;
+	}
+	transfer->id = transfers.next_id++;
+	transfer->state = TRANSFER_QUEUED;
+	struct Transfer **tail = &transfers.transfers;
+	while (*tail != NULL)
+		tail = &(*tail)->next;
+	*tail = transfer;
+	transfers.pending = true;
+	pthread_cond_signal(&transfers.wake);
+	const uint64_t id = transfer->id;
+	unlock_mutex(&transfers.lock);
+	return id;
+}
+
+static unsigned int cancel_transfer(uint64_t id, bool deleteUnfinishedFile)
+{
+	unsigned int error = ERROR_file_invalid_transfer_id;
+	bool halt = false;
+	uint64_t serverConnectionHandlerID = 0;
+	anyID transfer_id = 0;
+	lock_mutex(&transfers.lock);
+	struct Transfer *transfer = find_transfer(id);
+	if (transfer != NULL)
+	{
+		error = ERROR_ok;
+		switch (transfer->state)
+		{
+			case TRANSFER_QUEUED:
+				end_transfer(transfer, TRANSFER_CANCELED, ERROR_ok);
+				break;
+			case TRANSFER_STARTING:
+				transfer->cancel = true;
+				break;
+			case TRANSFER_RUNNING:
+				halt = true;
+				serverConnectionHandlerID = transfer->serverConnectionHandlerID;
+				transfer_id = transfer->transfer_id;
+				end_transfer(transfer, TRANSFER_CANCELED, ERROR_ok);
+				break;
+			default:
+				error = ERROR_currently_not_possible;
+				break;
+		}
+	}
+	unlock_mutex(&transfers.lock);
+
+	if (halt)
+	{
+		throttle(serverConnectionHandlerID);
+		struct WaitItem* item = create_return_code_item();
+		error = handle_return_code(item, ts3client_haltTransfer(serverConnectionHandlerID, transfer_id, deleteUnfinishedFile, item->return_code_text));
+	}
+	return error;
+}
+
+/*
+ * Waits up to the given time for a transfer to end and reports its progress.
+ * Returns 0 for a transfer that does not exist (any more).
+ */
+static enum TransferState get_transfer_progress(uint64_t id, long milliseconds, uint64_t *size, uint64_t *done, unsigned int *error)
+{
+	struct timespec timeout;
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timespec_add_ms(&timeout, milliseconds);
+	enum TransferState state = 0;
+	lock_mutex(&transfers.lock);
+	struct Transfer *transfer = find_transfer(id);
+	while (transfer != NULL && transfer->state < TRANSFER_DONE && milliseconds > 0 && wait_mutex_cond(&transfers.ended, &transfers.lock, &timeout) == 0)
+		transfer = find_transfer(id);
+	if (transfer != NULL)
+	{
+		state = transfer->state;
+		*size = transfer->size;
+		*done = transfer->done;
+		*error = transfer->error;
+	}
+	unlock_mutex(&transfers.lock);
+	return state;
+}
+
+/* Removes a transfer that ended. Transfers that are still starting are left for ts3client_getTransfers to remove. */
+static void forget_transfer(uint64_t id)
+{
+	lock_mutex(&transfers.lock);
+	struct Transfer **parent = &transfers.transfers;
+	while (*parent != NULL && (*parent)->id != id)
+		parent = &(*parent)->next;
+	struct Transfer *transfer = *parent;
+	if (transfer != NULL && transfer->state >= TRANSFER_DONE)
+	{
+		*parent = transfer->next;
+		free_transfer(transfer);
+	}
+	unlock_mutex(&transfers.lock);
+}
+
+/* The caller must hold quality.lock. */
+static struct QualitySeries *find_quality_series(uint64_t serverConnectionHandlerID)
+{
+	struct QualitySeries *series = quality.series;
+	while (series != NULL && series->serverConnectionHandlerID != serverConnectionHandlerID)
+		series = series->next;
+	return series;
+}
+
+static void free_quality_series(struct QualitySeries *series)
+{
+	free(series->points);
+	free(series);
+}
+
+/* The caller must hold quality.lock. */
+static bool remove_quality_series(uint64_t serverConnectionHandlerID)
+{
+	struct QualitySeries **parent = &quality.series;
+	while (*parent != NULL && (*parent)->serverConnectionHandlerID != serverConnectionHandlerID)
+		parent = &(*parent)->next;
+	struct QualitySeries *series = *parent;
+	if (series == NULL)
+		return false;
+	*parent = series->next;
+	free_quality_series(series);
+	return true;
+}
+
+/* Reads the values the client lib updated when the server answered a connection info request. */
+static void read_quality_point(uint64_t serverConnectionHandlerID, struct QualityPoint *point)
+{
+	anyID clientID = 0;
+	uint64 ping = 0, bandwidth_sent = 0, bandwidth_received = 0, packets_sent = 0, packets_received = 0;
+	double ping_deviation = 0;
+	float packetloss = 0, packetloss_speech = 0;
+	if (ts3client_getClientID(serverConnectionHandlerID, &clientID) == ERROR_ok)
+	{
+		ts3client_getConnectionVariableAsUInt64(serverConnectionHandlerID, clientID, CONNECTION_PING, &ping);
+		ts3client_getConnectionVariableAsDouble(serverConnectionHandlerID, clientID, CONNECTION_PING_DEVIATION, &ping_deviation);
+	}
+	ts3client_getServerConnectionVariableAsFloat(serverConnectionHandlerID, CONNECTION_PACKETLOSS_TOTAL, &packetloss);
+	ts3client_getServerConnectionVariableAsFloat(serverConnectionHandlerID, CONNECTION_PACKETLOSS_SPEECH, &packetloss_speech);
+	ts3client_getServerConnectionVariableAsUInt64(serverConnectionHandlerID, CONNECTION_BANDWIDTH_SENT_LAST_SECOND_TOTAL, &bandwidth_sent);
+	ts3client_getServerConnectionVariableAsUInt64(serverConnectionHandlerID, CONNECTION_BANDWIDTH_RECEIVED_LAST_SECOND_TOTAL, &bandwidth_received);
+	ts3client_getServerConnectionVariableAsUInt64(serverConnectionHandlerID, CONNECTION_PACKETS_SENT_TOTAL, &packets_sent);
+	ts3client_getServerConnectionVariableAsUInt64(serverConnectionHandlerID, CONNECTION_PACKETS_RECEIVED_TOTAL, &packets_received);
+
+	point->time = realtime_ms();
+	point->ping = ping;
+	point->ping_deviation = ping_deviation;
+	point->packetloss = packetloss;
+	point->packetloss_speech = packetloss_speech;
+	point->bandwidth_sent = bandwidth_sent;
+	point->bandwidth_received = bandwidth_received;
+	point->packets_sent = packets_sent;
+	point->packets_received = packets_received;
+}
+
+/* Requests the connection info of every due connection pipelined and appends a sample for each answer. */
+static void sample_quality(const uint64_t *handlers, size_t count)
+{
+	struct WaitItem **items = calloc(count, sizeof(*items));
+	unsigned int *errors = calloc(count, sizeof(*errors));
+	for (size_t i = 0; i < count; ++i)
+	{
+		throttle_native(handlers[i]);
+		items[i] = create_return_code_item();
+		batch_sent(&items[i], &errors[i], ts3client_requestServerConnectionInfo(handlers[i], items[i]->return_code_text));
+	}
+
+	static atomic_int stats_id = ATOMIC_VAR_INIT(-1);
+	struct timespec started, timeout;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	clock_gettime(CLOCK_REALTIME, &timeout);
+	timeout.tv_sec += TIMEOUT;
+	wait_for_items_until(items, errors, count, &timeout);
+	size_t timeouts = 0;
+	for (size_t i = 0; i < count; ++i)
+		timeouts += items[i] != NULL && errors[i] == ERROR_connection_lost;
+	record_wait_in(&stats.native, register_stats_function(&stats_id, "quality sampler"), &started, timeouts);
+	free_items(items, count);
+
+	struct QualityPoint *points = calloc(count, sizeof(*points));
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (errors[i] == ERROR_ok)
+			read_quality_point(handlers[i], &points[i]);
+	}
+
+	lock_mutex(&quality.lock);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (errors[i] == ERROR_invalid_server_connection_handler_id)
+		{
+			remove_quality_series(handlers[i]);
+			continue;
+		}
+		struct QualitySeries *series = find_quality_series(handlers[i]);
+		if (series == NULL)
+			continue;
+		if (errors[i] != ERROR_ok)
+		{
+			++series->failed;
+			series->last_error = errors[i];
+			continue;
+		}
+		series->points[series->head] = points[i];
+		series->head = (series->head + 1) % series->capacity;
+		if (series->count < series->capacity)
+			++series->count;
+	}
+	unlock_mutex(&quality.lock);
+	free(points);
+	free(items);
+	free(errors);
+}
+
+static void *sample_connections(void *argument)
+{
+	(void)argument;
+	uint64_t *due = NULL;
+	size_t capacity = 0;
+	while (atomic_load(&quality.sampler.stopping) == false)
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long wait = QUALITY_SWEEP_MS;
+		size_t count = 0;
+		lock_mutex(&quality.lock);
+		for (struct QualitySeries *series = quality.series; series != NULL; series = series->next)
+		{
+			long remaining = timespec_diff_ms(&series->due, &now);
+			if (remaining > 0)
+			{
+				wait = remaining < wait ? remaining : wait;
+				continue;
+			}
+			if (count == capacity)
+			{
+				capacity = capacity ? capacity * 2 : 8;
+				due = realloc(due, capacity * sizeof(*due));
+			}
+			due[count++] = series->serverConnectionHandlerID;
+			/* Keeps the cadence, but a sampler that fell behind starts over instead of catching up. */
+			timespec_add_ms(&series->due, series->interval);
+			if (timespec_diff_ms(&series->due, &now) <= 0)
+			{
+				series->due = now;
+				timespec_add_ms(&series->due, series->interval);
+			}
+		}
+		if (count == 0 && atomic_load(&quality.sampler.stopping) == false)
+		{
+			struct timespec timeout;
+			clock_gettime(CLOCK_REALTIME, &timeout);
+			timespec_add_ms(&timeout, wait);
+			wait_mutex_cond(&quality.wake, &quality.lock, &timeout);
+		}
+		unlock_mutex(&quality.lock);
+
+		if (count > 0)
+			sample_quality(due, count);
+	}
+	free(due);
+	return NULL;
+}
+
+/* The caller must hold quality.lock. */
+static bool start_quality_sampler(void)
+{
+	if (quality.sampler.running == false)
+	{
+		atomic_store(&quality.sampler.stopping, false);
+		quality.sampler.running = pthread_create(&quality.sampler.thread, NULL, &sample_connections, NULL) == 0;
+	}
+	return quality.sampler.running;
+}
+
+/* The caller must not hold quality.lock. */
+static void stop_quality_sampler(void)
+{
+	if (quality.sampler.running == false)
+		return;
+	lock_mutex(&quality.lock);
+	atomic_store(&quality.sampler.stopping, true);
+	pthread_cond_signal(&quality.wake);
+	unlock_mutex(&quality.lock);
+	pthread_join(quality.sampler.thread, NULL);
+	quality.sampler.running = false;
+}
+
+static void free_quality(void)
+{
+	lock_mutex(&quality.lock);
+	struct QualitySeries *series = quality.series;
+	quality.series = NULL;
+	unlock_mutex(&quality.lock);
+	while (series != NULL)
+	{
+		struct QualitySeries *next = series->next;
+		free_quality_series(series);
+		series = next;
+	}
+}
+
+/* Registers the known devices with a freshly initialized client lib. */
+static void register_custom_devices(void)
+{
+	lock_mutex(&device_mutex);
+	bool recording = false;
+	for (struct CustomDevice *device = custom_devices; device != NULL; device = device->next)
+	{
+		ts3client_registerCustomDevice(device->id, device->display_name, device->capture_frequency, device->capture_channels, device->playback_frequency, device->playback_channels);
+		recording = recording || device->recording != NULL;
+	}
+	if (custom_devices != NULL)
+		start_pacer();
+	if (recording)
+		start_recorder();
+	unlock_mutex(&device_mutex);
+}
+
+static void free_custom_devices(void)
+{
+	lock_mutex(&device_mutex);
+	struct CustomDevice *device = custom_devices;
+	custom_devices = NULL;
+	unlock_mutex(&device_mutex);
+	while (device != NULL)
+	{
+		struct CustomDevice *next = device->next;
+		release_custom_device(device);
+		device = next;
+	}
+}
+
+static void free_return_codes(struct WaitItem* item)
+{
+	if (item != NULL)
+	{
+		free_return_codes(item->next);
+		free_return_code_item(item);
+	}
+}
+
+static void free_connections(struct ConnectionItem* item)
+{
+	if (item != NULL)
+	{
+		free_connections(item->next);
+		free_connection_item(item);
+	}
+}
+
+static void free_tables(void)
+{
+	for (size_t i = 0; i < WAIT_ITEM_BUCKETS; ++i)
+	{
+		free_return_codes(wait_items[i]);
+		wait_items[i] = NULL;
+	}
+	free_connections(connection_items);
+	connection_items = NULL;
+}
+
+/*
+ * Client lib log messages are filtered by level and channel in the callback
+ * and copied into a bounded ring that many SDK threads can write to without
+ * a lock (a Vyukov queue: every slot carries the position it may be written
+ * or read at). Messages that find the ring full are counted and dropped.
+ * The writer thread appends them to ts3client.log_file.
+ */
+struct LogSlot
+{
+	atomic_size_t sequence;
+	char line[LOG_LINE_SIZE];
+};
+
+struct LogRouter
+{
+	struct Pacer writer;
+	int fd;
+	int level;
+	char file[PATH_MAX];
+	size_t channel_count;
+	char channels[LOG_MAX_CHANNELS][LOG_CHANNEL_SIZE];
+	atomic_size_t head;
+	size_t tail;
+	atomic_ullong written;
+	atomic_ullong dropped;
+	unsigned long long reported_drops;
+	struct LogSlot slots[LOG_RING_SLOTS];
+};
+
+static struct LogRouter logs = { .fd = -1, .level = LogLevel_WARNING };
+
+static const struct
+{
+	const char *name;
+	int level;
+} log_levels[] = {
+	{ "critical", LogLevel_CRITICAL },
+	{ "error", LogLevel_ERROR },
+	{ "warning", LogLevel_WARNING },
+	{ "debug", LogLevel_DEBUG },
+	{ "info", LogLevel_INFO },
+	{ "devel", LogLevel_DEVEL },
+};
+
+static ZEND_INI_MH(OnUpdateLogFile)
+{
+	snprintf(logs.file, sizeof(logs.file), "%s", ZSTR_VAL(new_value));
+	return SUCCESS;
+}
+
+static ZEND_INI_MH(OnUpdateLogLevel)
+{
+	for (size_t i = 0; i < sizeof(log_levels) / sizeof(*log_levels); ++i)
+	{
+		if (strcasecmp(ZSTR_VAL(new_value), log_levels[i].name) == 0)
+		{
+			logs.level = log_levels[i].level;
+			return SUCCESS;
+		}
+	}
+	return FAILURE;
+}
+
+/* A comma separated list of channels to keep; empty keeps all. */
+static ZEND_INI_MH(OnUpdateLogChannels)
+{
+	size_t count = 0;
+	const char *channel = ZSTR_VAL(new_value);
+	while (*channel != '\0')
+	{
+		size_t length = strcspn(channel, ",");
+		while (length > 0 && channel[0] == ' ')
+		{
+			++channel;
+			--length;
+		}
+		while (length > 0 && channel[length - 1] == ' ')
+			--length;
+		if (length >= LOG_CHANNEL_SIZE || (length > 0 && count == LOG_MAX_CHANNELS))
+			return FAILURE;
+		if (length > 0)
+		{
+			memcpy(logs.channels[count], channel, length);
+			logs.channels[count++][length] = '\0';
+		}
+		channel += strcspn(channel, ",");
+		if (*channel == ',')
+			++channel;
+	}
+	logs.channel_count = count;
+	return SUCCESS;
+}
+
+static bool log_channel_enabled(const char *channel)
+{
+	if (logs.channel_count == 0)
+		return true;
+	for (size_t i = 0; i < logs.channel_count; ++i)
+	{
+		if (strcasecmp(logs.channels[i], channel) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void reset_log_ring(void)
+{
+	for (size_t i = 0; i < LOG_RING_SLOTS; ++i)
+		atomic_store_explicit(&logs.slots[i].sequence, i, memory_order_relaxed);
+	atomic_store(&logs.head, 0);
+	logs.tail = 0;
+	atomic_store(&logs.written, 0);
+	atomic_store(&logs.dropped, 0);
+	logs.reported_drops = 0;
+}
+
+TS3_CALLBACK(onUserLoggingMessageEvent, (const char* logMessage, int logLevel, const char* logChannel, uint64 logID, const char* logTime, const char* completeLogString),
+	(logMessage, logLevel, logChannel, logID, logTime, completeLogString))
+{
+	if (logLevel > logs.level || log_channel_enabled(logChannel ? logChannel : "") == false)
+		return;
+
+	size_t position = atomic_load_explicit(&logs.head, memory_order_relaxed);
+	struct LogSlot *slot;
+	while (true)
+	{
+		slot = &logs.slots[position % LOG_RING_SLOTS];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+		if (difference == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&logs.head, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			atomic_fetch_add_explicit(&logs.dropped, 1, memory_order_relaxed);
+			return;
+		}
+		else
+			position = atomic_load_explicit(&logs.head, memory_order_relaxed);
+	}
+
+	if (completeLogString != NULL)
+		snprintf(slot->line, sizeof(slot->line), "%s", completeLogString);
+	else
+		snprintf(slot->line, sizeof(slot->line), "%s|%d|%s|%llu|%s", logTime ? logTime : "", logLevel, logChannel ? logChannel : "", (unsigned long long)logID, logMessage ? logMessage : "");
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+/* Moves the queued lines into the buffer as long as they fit. Only the writer thread reads the ring. */
+static size_t take_log_lines(char *buffer, size_t capacity)
+{
+	size_t length = 0;
+	while (true)
+	{
+		struct LogSlot *slot = &logs.slots[logs.tail % LOG_RING_SLOTS];
+		if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != logs.tail + 1)
+			break;
+		size_t line = strlen(slot->line);
+		if (length + line + 1 > capacity)
+			break;
+		memcpy(buffer + length, slot->line, line);
+		length += line;
+		buffer[length++] = '\n';
+		atomic_store_explicit(&slot->sequence, logs.tail + LOG_RING_SLOTS, memory_order_release);
+		++logs.tail;
+		atomic_fetch_add_explicit(&logs.written, 1, memory_order_relaxed);
+	}
+
+	unsigned long long dropped = atomic_load_explicit(&logs.dropped, memory_order_relaxed);
+	if (dropped != logs.reported_drops && length + 64 <= capacity)
+	{
+		length += snprintf(buffer + length, capacity - length, "ts3client: %llu log messages dropped\n", dropped - logs.reported_drops);
+		logs.reported_drops = dropped;
+	}
+	return length;
+}
+
+static void *write_logs(void *argument)
+{
+	(void)argument;
+	char *buffer = malloc(LOG_BUFFER_SIZE);
+	while (true)
+	{
+		const bool stopping = atomic_load(&logs.writer.stopping);
+		size_t length;
+		while ((length = take_log_lines(buffer, LOG_BUFFER_SIZE)) > 0)
+			write_fully(logs.fd, buffer, length);
+		if (stopping)
+			break;
+		struct timespec interval = { 0, LOG_FLUSH_MS * 1000000L };
+		nanosleep(&interval, NULL);
+	}
+	free(buffer);
+	return NULL;
+}
+
+static bool log_routing_enabled(void)
+{
+	return logs.file[0] != '\0';
+}
+
+/* The caller must hold init_mutex. */
+static void start_log_writer(void)
+{
+	if (logs.writer.running || log_routing_enabled() == false)
+		return;
+	logs.fd = open(logs.file, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (logs.fd < 0)
+		return;
+	atomic_store(&logs.writer.stopping, false);
+	logs.writer.running = pthread_create(&logs.writer.thread, NULL, &write_logs, NULL) == 0;
+	if (logs.writer.running == false)
+	{
+		close(logs.fd);
+		logs.fd = -1;
+	}
+}
+
+/* Flushes what is queued; called after the client lib is destroyed so its last messages are kept. */
+static void stop_log_writer(void)
+{
+	if (logs.writer.running == false)
+		return;
+	atomic_store(&logs.writer.stopping, true);
+	pthread_join(logs.writer.thread, NULL);
+	logs.writer.running = false;
+	close(logs.fd);
+	logs.fd = -1;
+}
+
+/* A process only destroys the client lib it initialized itself; the threads of an inherited one are gone. */
+void deinialize(void)
+{
+	if (pid && pid == getpid())
+	{
+		atomic_store(&client_lib_ready, false);
+		stop_io_worker();
+		stop_pacer();
+		stop_recorder();
+		stop_transfer_scheduler();
+		stop_quality_sampler();
+		ts3client_destroyClientLib();
+		stop_log_writer();
+		free_tables();
+		free_custom_devices();
+		free_speaker_tracks();
+		free_transfers();
+		free_quality();
+	}
+}
+
+/* The caller must hold init_mutex. */
+static bool init_client_lib(void)
+{
+	struct ClientUIFunctions funcs;
+	memset(&funcs, 0, sizeof(funcs));
+	funcs.onConnectStatusChangeEvent    = onConnectStatusChangeEvent;
+	funcs.onServerErrorEvent            = onServerErrorEvent;
+	funcs.onNewChannelCreatedEvent      = onNewChannelCreatedEvent;
+	funcs.onEditPlaybackVoiceDataEvent  = onEditPlaybackVoiceDataEvent;
+	funcs.onTalkStatusChangeEvent       = onTalkStatusChangeEvent;
+	funcs.onFileTransferStatusEvent     = onFileTransferStatusEvent;
+	funcs.onFileListEvent               = onFileListEvent;
+	funcs.onUserLoggingMessageEvent     = onUserLoggingMessageEvent;
+	if (inherited_client_lib)
+	{
+		/* The parent had no server connection handlers, so only the global state of its client lib is left to release. */
+		ts3client_destroyClientLib();
+		inherited_client_lib = false;
+	}
+	start_log_writer();
+	if (ts3client_initClientLib(&funcs, NULL, logs.writer.running ? LogType_USERLOGGING : LogType_NONE, NULL, NULL) != ERROR_ok)
+	{
+		stop_log_writer();
+		return false;
+	}
+	if (logs.writer.running)
+		ts3client_setLogVerbosity(logs.level);
+
+	pid = getpid();
+	atomic_store(&client_lib_ready, true);
+	register_custom_devices();
+	if (atomic_load(&speakers.active))
+	{
+		lock_mutex(&device_mutex);
+		start_recorder();
+		unlock_mutex(&device_mutex);
+	}
+	return true;
+}
+
+static bool has_server_connection_handlers(void)
+{
+	uint64 *handlers;
+	if (ts3client_getServerConnectionHandlerList(&handlers) != ERROR_ok)
+		return true;
+	bool result = handlers[0] != 0;
+	ts3client_freeMemory(handlers);
+	return result;
+}
+
+/*
+ * The threads of the client lib do not survive fork(), so a child can not use
+ * the client lib it inherits. The parent keeps its client lib and threads. As
+ * long as the parent has no server connection handlers, the child forgets the
+ * inherited copy and empties its connection and return code tables; the first
+ * request or ts3client_* call of the child (pcntl_fork workers never pass
+ * RINIT again) destroys the inherited copy and initializes a client lib of its
+ * own, so children that exec never start one. Otherwise the child keeps the
+ * unusable copy and its requests and calls fail with ERROR_undefined.
+ */
+static void fork_prepare(void)
+{
+	pthread_mutex_lock(&init_mutex);
+	reinitialize_after_fork = pid == getpid() && !has_server_connection_handlers();
+	pthread_mutex_lock(&device_mutex);
+	pthread_mutex_lock(&transfers.lock);
+	pthread_mutex_lock(&quality.lock);
+	pthread_mutex_lock(&mutex);
+}
+
+static void fork_parent(void)
+{
+	pthread_mutex_unlock(&mutex);
+	pthread_mutex_unlock(&quality.lock);
+	pthread_mutex_unlock(&transfers.lock);
+	pthread_mutex_unlock(&device_mutex);
+	pthread_mutex_unlock(&init_mutex);
+}
+
+static void fork_child(void)
+{
+	atomic_store(&client_lib_ready, false);
+	pthread_mutex_init(&mutex, NULL);
+	pthread_mutex_init(&device_mutex, NULL);
+	pthread_mutex_init(&init_mutex, NULL);
+	pthread_mutex_init(&stats.lock, NULL);
+	for (struct CustomDevice *device = custom_devices; device != NULL; device = device->next)
+	{
+		pthread_mutex_init(&device->feed_lock, NULL);
+		pthread_mutex_init(&device->record_lock, NULL);
+	}
+	pthread_mutex_init(&speakers.lock, NULL);
+	forget_speaker_tracks();
+	pthread_mutex_init(&transfers.lock, NULL);
+	pthread_cond_init(&transfers.wake, NULL);
+	pthread_cond_init(&transfers.ended, NULL);
+	transfers.scheduler.running = false;
+	free_transfers();
+	pthread_mutex_init(&quality.lock, NULL);
+	pthread_cond_init(&quality.wake, NULL);
+	quality.sampler.running = false;
+	free_quality();
+	pacer.running = false;
+	recorder.running = false;
+	logs.writer.running = false;
+	if (logs.fd >= 0)
+	{
+		close(logs.fd);
+		logs.fd = -1;
+	}
+	reset_log_ring();
+	reset_trace_ring();
+	if (submissions.running)
+	{
+		close(submissions.doorbell);
+		submissions.running = false;
+	}
+	if (reinitialize_after_fork)
+	{
+		free_tables();
+		inherited_client_lib = true;
+		pid = 0;
+	}
+}
+
+/* Called by every request and PHP function of every thread; only the first one initializes the client lib. */
+static bool initialize(void)
+{
+	if (atomic_load(&client_lib_ready))
+		return true;
+	lock_mutex(&init_mutex);
+	if (pid == 0)
+	{
+		static bool registered = false;
+		if (init_client_lib() && registered == false)
+		{
+			atexit(&deinialize);
+			pthread_atfork(&fork_prepare, &fork_parent, &fork_child);
+			registered = true;
+		}
+	}
+	bool initialized = pid != 0 && pid == getpid();
+	unlock_mutex(&init_mutex);
+	return initialized;
+}
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientLibVersion, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientLibVersionNumber, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_spawnNewServerConnectionHandler, 0)
+	ZEND_ARG_INFO(0, port)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_destroyServerConnectionHandler, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_createIdentity, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_identityStringToUniqueIdentifier, 0)
+	ZEND_ARG_INFO(0, identityString)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getErrorMessage, 0)
+	ZEND_ARG_INFO(0, errorCode)
+	ZEND_ARG_INFO(1, error)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_startConnection, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, identity)
+	ZEND_ARG_INFO(0, ip)
+	ZEND_ARG_INFO(0, port)
+	ZEND_ARG_INFO(0, nickname)
+	ZEND_ARG_INFO(0, defaultChannelID)
+	ZEND_ARG_INFO(0, defaultChannelPassword)
+	ZEND_ARG_INFO(0, serverPassword)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_stopConnection, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, quitMessage)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientMove, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, newChannelID)
+	ZEND_ARG_INFO(0, password)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientVariables, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientKickFromChannel, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, kickReason)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientKickFromServer, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, kickReason)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestClientMoveMany, 0, 0, 5)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, clientIDs, 0)
+	ZEND_ARG_INFO(0, newChannelID)
+	ZEND_ARG_INFO(0, password)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, stopOnError)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestClientKickFromChannelMany, 0, 0, 4)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, clientIDs, 0)
+	ZEND_ARG_INFO(0, kickReason)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, stopOnError)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestClientKickFromServerMany, 0, 0, 4)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, clientIDs, 0)
+	ZEND_ARG_INFO(0, kickReason)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, stopOnError)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelDelete, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, force)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelMove, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, newChannelParentID)
+	ZEND_ARG_INFO(0, newChannelOrder)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestSendPrivateTextMsg, 0, 0, 3)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, message)
+	ZEND_ARG_INFO(0, targetClientID)
+	ZEND_ARG_INFO(0, confirmed)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestSendChannelTextMsg, 0, 0, 3)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, message)
+	ZEND_ARG_INFO(0, targetChannelID)
+	ZEND_ARG_INFO(0, confirmed)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestSendServerTextMsg, 0, 0, 2)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, message)
+	ZEND_ARG_INFO(0, confirmed)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestSendTextMsgs, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, messages, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_sendPrivateTextMsgMany, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, message)
+	ZEND_ARG_ARRAY_INFO(0, clientIDs, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_requestSendTextMsgChunked, 0, 0, 4)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, targetMode)
+	ZEND_ARG_INFO(0, targetID)
+	ZEND_ARG_INFO(0, message)
+	ZEND_ARG_INFO(0, maxLength)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestConnectionInfo, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelSubscribeAll, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestChannelUnsubscribeAll, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientID, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionStatus, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionVariableAsUInt64, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionVariableAsDouble, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getConnectionVariableAsString, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_cleanUpConnectionInfo, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestServerConnectionInfo, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerConnectionVariableAsUInt64, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerConnectionVariableAsFloat, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientSelfVariableAsInt, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientSelfVariableAsString, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setClientSelfVariableAsInt, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setClientSelfVariableAsString, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+    ZEND_ARG_INFO(0, flag)
+    ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_flushClientSelfUpdates, 0)
+    ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientVariableAsInt, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientVariableAsUInt64, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientVariableAsString, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getClientList, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelOfClient, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelVariableAsInt, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelVariableAsUInt64, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelVariableAsString, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setChannelVariableAsInt, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setChannelVariableAsUInt64, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setChannelVariableAsString, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_flushChannelUpdates, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_flushChannelCreation, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelParentID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_editChannels, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, channels, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_provisionChannels, 0, 0, 3)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, tree, 0)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, channelParentID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelList, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelClientList, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getParentChannelOfChannel, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelEmptySecs, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerVariableAsInt, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerVariableAsUInt64, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerVariableAsString, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, flag)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestServerVariables, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setFloodControl, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, commandsPerSecond)
+	ZEND_ARG_INFO(0, burst)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getFloodControl, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_submit, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, operation)
+	ZEND_ARG_ARRAY_INFO(0, arguments, 0)
+	ZEND_ARG_INFO(1, ticket)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getCompletionFd, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_reapCompletions, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_dispatchCompletions, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_registerCustomDevice, 0)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(0, deviceDisplayName)
+	ZEND_ARG_INFO(0, capFrequency)
+	ZEND_ARG_INFO(0, capChannels)
+	ZEND_ARG_INFO(0, playFrequency)
+	ZEND_ARG_INFO(0, playChannels)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_unregisterCustomDevice, 0)
+	ZEND_ARG_INFO(0, deviceID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_openCaptureDevice, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, modeID)
+	ZEND_ARG_INFO(0, captureDevice)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_closeCaptureDevice, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_feedCustomCapture, 0)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(0, data)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getCustomCaptureStatus, 0)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_openPlaybackDevice, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, modeID)
+	ZEND_ARG_INFO(0, playbackDevice)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_closePlaybackDevice, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_startCustomPlayback, 0, 0, 1)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(0, path)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_stopCustomPlayback, 0)
+	ZEND_ARG_INFO(0, deviceID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_readCustomPlayback, 0)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(0, stream)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getCustomPlaybackStatus, 0)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_startSpeakerRecording, 0)
+	ZEND_ARG_INFO(0, directory)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_stopSpeakerRecording, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getSpeakerRecordingStatus, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setCustomDeviceGain, 0)
+	ZEND_ARG_INFO(0, deviceID)
+	ZEND_ARG_INFO(0, captureGain)
+	ZEND_ARG_INFO(0, playbackGain)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getTalkStats, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, reset)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientSetWhisperList, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_ARRAY_INFO(0, targetChannelIDs, 0)
+	ZEND_ARG_ARRAY_INFO(0, targetClientIDs, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestClientSetWhisperListMany, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_ARRAY_INFO(0, whisperLists, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getWhisperList, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, clientID)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_queueUpload, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, channelPassword)
+	ZEND_ARG_INFO(0, file)
+	ZEND_ARG_INFO(0, sourceDirectory)
+	ZEND_ARG_INFO(0, overwrite)
+	ZEND_ARG_INFO(0, resume)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_queueDownload, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, channelID)
+	ZEND_ARG_INFO(0, channelPassword)
+	ZEND_ARG_INFO(0, file)
+	ZEND_ARG_INFO(0, destinationDirectory)
+	ZEND_ARG_INFO(0, overwrite)
+	ZEND_ARG_INFO(0, resume)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_cancelTransfer, 0)
+	ZEND_ARG_INFO(0, transferID)
+	ZEND_ARG_INFO(0, deleteUnfinishedFile)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_setTransferLimits, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, parallelism)
+	ZEND_ARG_INFO(0, uploadLimit)
+	ZEND_ARG_INFO(0, downloadLimit)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_getTransfers, 0, 0, 2)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, removeEnded)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_getStats, 0, 0, 1)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, reset)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_getLockStats, 0, 0, 1)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, reset)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getLogStatus, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_metrics, 0)
+	ZEND_ARG_INFO(1, result)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_dumpTrace, 0)
+	ZEND_ARG_INFO(0, path)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_startQualitySampler, 0, 0, 1)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(0, interval)
+	ZEND_ARG_INFO(0, capacity)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO(arginfo_ts3client_stopQualitySampler, 0)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_ts3client_getQualitySamples, 0, 0, 2)
+	ZEND_ARG_INFO(0, serverConnectionHandlerID)
+	ZEND_ARG_INFO(1, result)
+	ZEND_ARG_INFO(0, since)
+	ZEND_ARG_INFO(0, bucket)
+ZEND_END_ARG_INFO()
+
+TS3_FUNCTION(getClientLibVersion)
+{
+	char *result;
+	unsigned int error = ts3client_getClientLibVersion(&result);
+	if (error == ERROR_ok)
+	{
+		zval *zresult;
+		if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
+			return;
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+		ts3client_freeMemory(result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getClientLibVersionNumber)
+{
+	uint64_t result;
+	unsigned int error = ts3client_getClientLibVersionNumber(&result);
+	if (error == ERROR_ok)
+	{
+		zval *zresult;
+		if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
+			return;
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(spawnNewServerConnectionHandler)
+{
+	zend_long port;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &port, &zresult) == FAILURE)
+		return;
+	uint64_t result;
+	unsigned int error = ts3client_spawnNewServerConnectionHandler(port, &result);
+	if (error == ERROR_ok)
+	{
+		get_connection_item(result);
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(destroyServerConnectionHandler)
+{
+	zend_long serverConnectionHandlerID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+		return;
+	unsigned int error = ts3client_destroyServerConnectionHandler(serverConnectionHandlerID);
+	if (error == ERROR_ok)
+		delete_connection_item(serverConnectionHandlerID);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(createIdentity)
+{
+	char *identity;
+	unsigned int error = ts3client_createIdentity(&identity);
+	if (error== ERROR_ok)
+	{
+		zval *zidentity;
+		if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zidentity) == FAILURE)
+			return;
+		zval_dtor(zidentity);
+		ZVAL_STRING(zidentity, identity);
+		ts3client_freeMemory(identity);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(identityStringToUniqueIdentifier)
+{
+	char *identityString, *result;
+	size_t identityString_len;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz/", &identityString, &identityString_len, &zresult) == FAILURE)
+		return;
+	to_asciiz(&identityString, identityString_len);
+	unsigned int error = ts3client_identityStringToUniqueIdentifier(identityString, &result);
+	free(identityString);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getErrorMessage)
+{
+	zend_long errorCode;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &errorCode, &zresult) == FAILURE)
+		return;
+	char *result;
+	unsigned int error = ts3client_getErrorMessage(errorCode, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+		ts3client_freeMemory(result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(startConnection)
+{
+	zend_long serverConnectionHandlerID;
+	char* identity;               size_t identity_len;
+	char* ip;                     size_t ip_len;
+	zend_long port;
+	char* nickname;               size_t nickname_len;
+	zend_long defaultChannelID;
+	char* defaultChannelPassword; size_t defaultChannelPassword_len;
+	char* serverPassword;         size_t serverPassword_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lsslslss",
+				&serverConnectionHandlerID,
+				&identity, &identity_len,
+			   	&ip, &ip_len,
+				&port,
+				&nickname, &nickname_len,
+				&defaultChannelID,
+				&defaultChannelPassword, &defaultChannelPassword_len,
+				&serverPassword, &serverPassword_len)
+			== FAILURE)
+		return;
+	struct ConnectionItem* connection_item = lookup_connection_item(serverConnectionHandlerID);
+	if (connection_item == NULL)
+		RETURN_LONG(ERROR_invalid_server_connection_handler_id);
+	to_asciiz(&identity, identity_len);
+	to_asciiz(&ip, ip_len);
+	to_asciiz(&nickname, nickname_len);
+	to_asciiz(&defaultChannelPassword, defaultChannelPassword_len);
+	to_asciiz(&serverPassword, serverPassword_len);
+
+	enum ConnectState expected = CONNECT_STATE_NONE;
+	if (atomic_compare_exchange_strong(&connection_item->expected_state, &expected, CONNECT_STATE_CONNECTING) == false)
+		RETURN_LONG(ERROR_currently_not_possible);
+
+	unsigned int error = ts3client_startConnectionWithChannelID(
+			serverConnectionHandlerID,
+			identity,
+			ip,
+			port,
+			nickname,
+			defaultChannelID,
+			defaultChannelPassword,
+			serverPassword);
+
+	free(identity);
+	free(ip);
+	free(nickname);
+	free(defaultChannelPassword);
+	free(serverPassword);
+
+	if (error == ERROR_ok)
+	{
+		wait_for(&connection_item->state_changed);
+		RETVAL_LONG(connection_item->state_changed.result);
+	}
+	else
+	{
+		RETVAL_LONG(error)
+	}
+
+	atomic_exchange(&connection_item->expected_state, CONNECT_STATE_NONE);
+}
+
+TS3_FUNCTION(stopConnection)
+{
+	zend_long serverConnectionHandlerID;
+	char* reason; size_t reason_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ls", &serverConnectionHandlerID, &reason, &reason_len) == FAILURE)
+		return;
+	struct ConnectionItem* connection_item = lookup_connection_item(serverConnectionHandlerID);
+	if (connection_item == NULL)
+		RETURN_LONG(ERROR_invalid_server_connection_handler_id);
+	to_asciiz(&reason, reason_len);
+
+	enum ConnectState expected = CONNECT_STATE_NONE;
+	if (atomic_compare_exchange_strong(&connection_item->expected_state, &expected, CONNECT_STATE_DISCONNECTING) == false)
+		RETURN_LONG(ERROR_currently_not_possible);
+
+	unsigned int error = ts3client_stopConnection(serverConnectionHandlerID, reason);
+
+	free(reason);
+
+	if (error == ERROR_ok)
+	{
+		wait_for(&connection_item->state_changed);
+		RETVAL_LONG(connection_item->state_changed.result);
+	}
+	else
+	{
+		RETVAL_LONG(error)
+	}
+
+	atomic_exchange(&connection_item->expected_state, CONNECT_STATE_NONE);
+}
+
+TS3_FUNCTION(requestClientMove)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long newChannelID;
+	char* password; size_t password_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llls", &serverConnectionHandlerID, &clientID, &newChannelID, &password, &password_len) == FAILURE)
+		return;
+	to_asciiz(&password, password_len);
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestClientMove(serverConnectionHandlerID, clientID, newChannelID, password, item->return_code_text);
+	free(password);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+TS3_FUNCTION(requestClientVariables)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &clientID) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestClientVariables(serverConnectionHandlerID, clientID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+TS3_FUNCTION(requestClientKickFromChannel)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	char* kickReason; size_t kickReason_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lls", &serverConnectionHandlerID, &clientID, &kickReason, &kickReason_len) == FAILURE)
+		return;
+	to_asciiz(&kickReason, kickReason_len);
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestClientKickFromChannel(serverConnectionHandlerID, clientID, kickReason, item->return_code_text);
+	free(kickReason);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+TS3_FUNCTION(requestClientKickFromServer)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	char* kickReason; size_t kickReason_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lls", &serverConnectionHandlerID, &clientID, &kickReason, &kickReason_len) == FAILURE)
+		return;
+	to_asciiz(&kickReason, kickReason_len);
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestClientKickFromServer(serverConnectionHandlerID, clientID, kickReason, item->return_code_text);
+	free(kickReason);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+enum ClientAction
+{
+	CLIENT_ACTION_MOVE,
+	CLIENT_ACTION_KICK_FROM_CHANNEL,
+	CLIENT_ACTION_KICK_FROM_SERVER,
+};
+
+/*
+ * Sends one request per client without waiting in between and stores the
+ * error code of every client in zresult, keyed by client ID. With
+ * stop_on_error no further requests are sent once one has failed; clients
+ * that were not handled are missing from zresult.
+ */
+static unsigned int request_for_clients(uint64_t serverConnectionHandlerID, HashTable *clientIDs, enum ClientAction action, uint64_t channelID, const char *text, bool stop_on_error, zval *zresult)
+{
+	size_t count = zend_hash_num_elements(clientIDs), i;
+	struct WaitItem **items = ecalloc(count, sizeof(*items));
+	unsigned int *errors = ecalloc(count, sizeof(*errors));
+	zend_long *clients = ecalloc(count, sizeof(*clients));
+	const size_t distinct = distinct_client_ids(clientIDs, clients);
+	atomic_uint failures = ATOMIC_VAR_INIT(0);
+	for (i = 0; i < distinct; ++i)
+	{
+		if (stop_on_error && atomic_load(&failures) > 0)
+			break;
+		throttle(serverConnectionHandlerID);
+		items[i] = create_batch_item(&failures);
+		unsigned int error;
+		switch (action)
+		{
+			case CLIENT_ACTION_MOVE:
+				error = ts3client_requestClientMove(serverConnectionHandlerID, clients[i], channelID, text, items[i]->return_code_text);
+				break;
+			case CLIENT_ACTION_KICK_FROM_CHANNEL:
+				error = ts3client_requestClientKickFromChannel(serverConnectionHandlerID, clients[i], text, items[i]->return_code_text);
+				break;
+			case CLIENT_ACTION_KICK_FROM_SERVER:
+				error = ts3client_requestClientKickFromServer(serverConnectionHandlerID, clients[i], text, items[i]->return_code_text);
+				break;
+		}
+		batch_sent(&items[i], &errors[i], error);
+	}
+	count = i;
+
+	wait_for_all(items, errors, count);
+
+	unsigned int error = ERROR_ok;
+	zval_dtor(zresult);
+	array_init_size(zresult, count);
+	for (i = 0; i < count; ++i)
+	{
+		if (error == ERROR_ok)
+			error = errors[i];
+		add_index_long(zresult, clients[i], errors[i]);
+	}
+
+	efree(items);
+	efree(errors);
+	efree(clients);
+	return error;
+}
+
+TS3_FUNCTION(requestClientMoveMany)
+{
+	zend_long serverConnectionHandlerID;
+	HashTable *clientIDs;
+	zend_long newChannelID;
+	char* password; size_t password_len;
+	zval *zresult;
+	zend_bool stopOnError = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhlsz/|b", &serverConnectionHandlerID, &clientIDs, &newChannelID, &password, &password_len, &zresult, &stopOnError) == FAILURE)
+		return;
+	RETURN_LONG(request_for_clients(serverConnectionHandlerID, clientIDs, CLIENT_ACTION_MOVE, newChannelID, password, stopOnError, zresult));
+}
+
+TS3_FUNCTION(requestClientKickFromChannelMany)
+{
+	zend_long serverConnectionHandlerID;
+	HashTable *clientIDs;
+	char* kickReason; size_t kickReason_len;
+	zval *zresult;
+	zend_bool stopOnError = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhsz/|b", &serverConnectionHandlerID, &clientIDs, &kickReason, &kickReason_len, &zresult, &stopOnError) == FAILURE)
+		return;
+	RETURN_LONG(request_for_clients(serverConnectionHandlerID, clientIDs, CLIENT_ACTION_KICK_FROM_CHANNEL, 0, kickReason, stopOnError, zresult));
+}
+
+TS3_FUNCTION(requestClientKickFromServerMany)
+{
+	zend_long serverConnectionHandlerID;
+	HashTable *clientIDs;
+	char* kickReason; size_t kickReason_len;
+	zval *zresult;
+	zend_bool stopOnError = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhsz/|b", &serverConnectionHandlerID, &clientIDs, &kickReason, &kickReason_len, &zresult, &stopOnError) == FAILURE)
+		return;
+	RETURN_LONG(request_for_clients(serverConnectionHandlerID, clientIDs, CLIENT_ACTION_KICK_FROM_SERVER, 0, kickReason, stopOnError, zresult));
+}
+
+TS3_FUNCTION(requestChannelDelete)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_bool force;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llb", &serverConnectionHandlerID, &channelID, &force) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestChannelDelete(serverConnectionHandlerID, channelID, force, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+TS3_FUNCTION(requestChannelMove)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long newChannelParentID;
+	zend_long newChannelOrder;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &channelID, &newChannelParentID, &newChannelOrder) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestChannelMove(serverConnectionHandlerID, channelID, newChannelParentID, newChannelOrder, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error))
+}
+
+TS3_FUNCTION(requestSendPrivateTextMsg)
+{
+	zend_long serverConnectionHandlerID;
+	char* message; size_t message_len;
+	zend_long targetClientID;
+	zend_bool confirmed = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lsl|b", &serverConnectionHandlerID, &message, &message_len, &targetClientID, &confirmed) == FAILURE)
+		return;
+	to_asciiz(&message, message_len);
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = confirmed ? create_return_code_item() : NULL;
+	unsigned int error = ts3client_requestSendPrivateTextMsg(serverConnectionHandlerID, message, targetClientID, item ? item->return_code_text : NULL);
+	free(message);
+	if (item)
+		error = handle_return_code(item, error);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestSendChannelTextMsg)
+{
+	zend_long serverConnectionHandlerID;
+	char* message; size_t message_len;
+	zend_long targetChannelID;
+	zend_bool confirmed = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lsl|b", &serverConnectionHandlerID, &message, &message_len, &targetChannelID, &confirmed) == FAILURE)
+		return;
+	to_asciiz(&message, message_len);
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = confirmed ? create_return_code_item() : NULL;
+	unsigned int error = ts3client_requestSendChannelTextMsg(serverConnectionHandlerID, message, targetChannelID, item ? item->return_code_text : NULL);
+	free(message);
+	if (item)
+		error = handle_return_code(item, error);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestSendServerTextMsg)
+{
+	zend_long serverConnectionHandlerID;
+	char* message; size_t message_len;
+	zend_bool confirmed = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ls|b", &serverConnectionHandlerID, &message, &message_len, &confirmed) == FAILURE)
+		return;
+	to_asciiz(&message, message_len);
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = confirmed ? create_return_code_item() : NULL;
+	unsigned int error = ts3client_requestSendServerTextMsg(serverConnectionHandlerID, message, item ? item->return_code_text : NULL);
+	free(message);
+	if (item)
+		error = handle_return_code(item, error);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestSendTextMsgs)
+{
+	zend_long serverConnectionHandlerID;
+	HashTable *messages;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhz/", &serverConnectionHandlerID, &messages, &zresult) == FAILURE)
+		return;
+
+	size_t count = zend_hash_num_elements(messages), i = 0;
+	struct WaitItem **items = ecalloc(count, sizeof(*items));
+	unsigned int *errors = ecalloc(count, sizeof(*errors));
+	zval *zmessage;
+	ZEND_HASH_FOREACH_VAL(messages, zmessage)
+	{
+		zval *targetMode, *targetID, *message;
+		if (Z_TYPE_P(zmessage) != IS_ARRAY
+				|| (targetMode = zend_hash_str_find(Z_ARRVAL_P(zmessage), ZEND_STRL("targetMode"))) == NULL
+				|| (message = zend_hash_str_find(Z_ARRVAL_P(zmessage), ZEND_STRL("message"))) == NULL
+				|| Z_TYPE_P(message) != IS_STRING)
+		{
+			errors[i++] = ERROR_parameter_invalid;
+			continue;
+		}
+		targetID = zend_hash_str_find(Z_ARRVAL_P(zmessage), ZEND_STRL("targetID"));
+
+		throttle(serverConnectionHandlerID);
+		items[i] = create_return_code_item();
+		unsigned int error = send_text_message(serverConnectionHandlerID, zval_get_long(targetMode), targetID ? zval_get_long(targetID) : 0, Z_STRVAL_P(message), items[i]->return_code_text);
+		batch_sent(&items[i], &errors[i], error);
+		++i;
+	}
+	ZEND_HASH_FOREACH_END();
+
+	wait_for_all(items, errors, count);
+
+	unsigned int error = ERROR_ok;
+	zend_ulong index;
+	zend_string *key;
+	zval_dtor(zresult);
+	array_init_size(zresult, count);
+	i = 0;
+	ZEND_HASH_FOREACH_KEY_VAL(messages, index, key, zmessage)
+	{
+		(void)zmessage;
+		if (error == ERROR_ok)
+			error = errors[i];
+		if (key)
+			add_assoc_long_ex(zresult, ZSTR_VAL(key), ZSTR_LEN(key), errors[i]);
+		else
+			add_index_long(zresult, index, errors[i]);
+		++i;
+	}
+	ZEND_HASH_FOREACH_END();
+
+	efree(items);
+	efree(errors);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(sendPrivateTextMsgMany)
+{
+	zend_long serverConnectionHandlerID;
+	zend_string *message;
+	HashTable *clientIDs;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lShz/", &serverConnectionHandlerID, &message, &clientIDs, &zresult) == FAILURE)
+		return;
+
+	size_t count = zend_hash_num_elements(clientIDs), i;
+	struct WaitItem **items = ecalloc(count, sizeof(*items));
+	unsigned int *errors = ecalloc(count, sizeof(*errors));
+	zend_long *targets = ecalloc(count, sizeof(*targets));
+	count = distinct_client_ids(clientIDs, targets);
+	for (i = 0; i < count; ++i)
+	{
+		throttle(serverConnectionHandlerID);
+		items[i] = create_return_code_item();
+		unsigned int error = ts3client_requestSendPrivateTextMsg(serverConnectionHandlerID, ZSTR_VAL(message), targets[i], items[i]->return_code_text);
+		batch_sent(&items[i], &errors[i], error);
+	}
+
+	wait_for_all(items, errors, count);
+
+	unsigned int error = ERROR_ok;
+	zval_dtor(zresult);
+	array_init_size(zresult, count);
+	for (i = 0; i < count; ++i)
+	{
+		if (error == ERROR_ok)
+			error = errors[i];
+		add_index_long(zresult, targets[i], errors[i]);
+	}
+
+	efree(items);
+	efree(errors);
+	efree(targets);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestSendTextMsgChunked)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long targetMode;
+	zend_long targetID;
+	char *message; size_t message_len;
+	zend_long maxLength = TEXTMESSAGE_MAX_LENGTH;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llls|l", &serverConnectionHandlerID, &targetMode, &targetID, &message, &message_len, &maxLength) == FAILURE)
+		return;
+	if (maxLength < TEXTMESSAGE_MIN_LENGTH || maxLength > TEXTMESSAGE_MAX_LENGTH || memchr(message, '\0', message_len) != NULL)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	struct TextChunker chunker;
+	init_text_chunker(&chunker, message, message_len, maxLength);
+	size_t count = chunker.length / (maxLength / 2) + 1, i = 0;
+	struct WaitItem **items = ecalloc(count, sizeof(*items));
+	unsigned int *errors = ecalloc(count, sizeof(*errors));
+
+	smart_str chunk = {0};
+	while (next_text_chunk(&chunker, &chunk))
+	{
+		if (i == count)
+		{
+			count *= 2;
+			items = erealloc(items, count * sizeof(*items));
+			errors = erealloc(errors, count * sizeof(*errors));
+		}
+		throttle(serverConnectionHandlerID);
+		items[i] = create_return_code_item();
+		unsigned int error = send_text_message(serverConnectionHandlerID, targetMode, targetID, ZSTR_VAL(chunk.s), items[i]->return_code_text);
+		smart_str_free(&chunk);
+		batch_sent(&items[i], &errors[i], error);
+		if (errors[i++] != ERROR_ok)
+			break;
+	}
+
+	wait_for_all(items, errors, i);
+
+	unsigned int error = ERROR_ok;
+	for (size_t j = 0; j < i && error == ERROR_ok; ++j)
+		error = errors[j];
+
+	efree(items);
+	efree(errors);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestConnectionInfo)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &clientID) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestConnectionInfo(serverConnectionHandlerID, clientID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error))
+}
+
+TS3_FUNCTION(getConnectionStatus)
+{
+	zend_long serverConnectionHandlerID;
+	zval* zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+		return;
+	int result;
+	unsigned int error = ts3client_getConnectionStatus(serverConnectionHandlerID, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestChannelSubscribeAll)
+{
+	zend_long serverConnectionHandlerID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestChannelSubscribeAll(serverConnectionHandlerID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error))
+}
+
+TS3_FUNCTION(requestChannelUnsubscribeAll)
+{
+	zend_long serverConnectionHandlerID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_requestChannelUnsubscribeAll(serverConnectionHandlerID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error))
+}
+
+TS3_FUNCTION(getClientID)
+{
+	zend_long serverConnectionHandlerID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+		return;
+	anyID result;
+	unsigned int error = ts3client_getClientID(serverConnectionHandlerID, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getConnectionVariableAsUInt64)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+        return;
+	uint64_t result;
+    unsigned int error = ts3client_getConnectionVariableAsUInt64(serverConnectionHandlerID, clientID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getConnectionVariableAsDouble)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+        return;
+	double result;
+    unsigned int error = ts3client_getConnectionVariableAsDouble(serverConnectionHandlerID, clientID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_DOUBLE(zresult, result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getConnectionVariableAsString)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+        return;
+	char* result;
+    unsigned int error = ts3client_getConnectionVariableAsString(serverConnectionHandlerID, clientID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+		ts3client_freeMemory(result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(cleanUpConnectionInfo)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long clientID;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &clientID) == FAILURE)
+        return;
+    unsigned int error = ts3client_cleanUpConnectionInfo(serverConnectionHandlerID, clientID);
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(requestServerConnectionInfo)
+{
+    zend_long serverConnectionHandlerID;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+        return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+    unsigned int error = ts3client_requestServerConnectionInfo(serverConnectionHandlerID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error))
+}
+
+TS3_FUNCTION(getServerConnectionVariableAsUInt64)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
+        return;
+	uint64_t result;
+    unsigned int error = ts3client_getServerConnectionVariableAsUInt64(serverConnectionHandlerID, flag, &result);
+	if (error != ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getServerConnectionVariableAsFloat)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
+        return;
+	float result;
+    unsigned int error = ts3client_getServerConnectionVariableAsFloat(serverConnectionHandlerID, flag, &result);
+	if (error != ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_DOUBLE(zresult, result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getClientSelfVariableAsInt)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
+        return;
+	int result;
+    unsigned int error = ts3client_getClientSelfVariableAsInt(serverConnectionHandlerID, flag, &result);
+	if (error != ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getClientSelfVariableAsString)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long flag;
+	zval *zresult;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
+        return;
+	char *result;
+    unsigned int error = ts3client_getClientSelfVariableAsString(serverConnectionHandlerID, flag, &result);
+	if (error != ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+		ts3client_freeMemory(result);
+	}
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(setClientSelfVariableAsInt)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long flag;
+	zend_long value;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lll", &serverConnectionHandlerID, flag, value) == FAILURE)
+        return;
+    unsigned int error = ts3client_setClientSelfVariableAsInt(serverConnectionHandlerID, flag, value);
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(setClientSelfVariableAsString)
+{
+    zend_long serverConnectionHandlerID;
+	zend_long flag;
+	char* value; size_t value_len;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lls", &serverConnectionHandlerID, &flag, &value, &value_len) == FAILURE)
+        return;
+	to_asciiz(&value, value_len);
+    unsigned int error = ts3client_setClientSelfVariableAsString(serverConnectionHandlerID, flag, value);
+	free(value);
+    RETURN_LONG(error);
+}
+
+TS3_FUNCTION(flushClientSelfUpdates)
+{
+    zend_long serverConnectionHandlerID;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+        return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+    unsigned int error = ts3client_flushClientSelfUpdates(serverConnectionHandlerID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error))
+}
+
+TS3_FUNCTION(getClientVariableAsInt)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+		return;
+	int result;
+	unsigned int error = ts3client_getClientVariableAsInt(serverConnectionHandlerID, clientID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getClientVariableAsUInt64)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+		return;
+	uint64_t result;
+	unsigned int error = ts3client_getClientVariableAsUInt64(serverConnectionHandlerID, clientID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getParentChannelOfChannel, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+TS3_FUNCTION(getClientVariableAsString)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long clientID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+		return;
+	char *result;
+	unsigned int error = ts3client_getClientVariableAsString(serverConnectionHandlerID, clientID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+		ts3client_freeMemory(result);
+	}
+	RETURN_LONG(error);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getChannelEmptySecs, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, channelID)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+TS3_FUNCTION(getClientList)
+{
+	zend_long serverConnectionHandlerID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+		return;
+	anyID* result;
+	unsigned int error = ts3client_getClientList(serverConnectionHandlerID, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		array_init(zresult);
+		for  (anyID* p = result; *p; ++p)
+		{
+			add_next_index_long(zresult, *p);
+		}
+		ts3client_freeMemory(result);
+	}
+	RETURN_LONG(error);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerVariableAsInt, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+TS3_FUNCTION(getChannelOfClient)
+{
+	zend_long serverConnectionHandlerID = 25;
+	zend_long clientID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &clientID, &zresult) == FAILURE)
+		return;
+	uint64_t result;
+	unsigned int error = ts3client_getChannelOfClient(serverConnectionHandlerID, clientID, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerVariableAsUInt64, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+TS3_FUNCTION(getChannelVariableAsInt)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &channelID, &flag, &zresult) == FAILURE)
+		return;
+	int result;
+	unsigned int error = ts3client_getChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_getServerVariableAsString, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-	ZEND_ARG_INFO(0, flag)
-	ZEND_ARG_INFO(1, result)
-ZEND_END_ARG_INFO()
+TS3_FUNCTION(getChannelVariableAsUInt64)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &channelID, &flag, &zresult) == FAILURE)
+		return;
+	uint64_t result;
+	unsigned int error = ts3client_getChannelVariableAsUInt64(serverConnectionHandlerID, channelID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
+	RETURN_LONG(error);
+}
 
-ZEND_BEGIN_ARG_INFO(arginfo_ts3client_requestServerVariables, 0)
-	ZEND_ARG_INFO(0, serverConnectionHandlerID)
-ZEND_END_ARG_INFO()
+TS3_FUNCTION(getChannelVariableAsString)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &channelID, &flag, &zresult) == FAILURE)
+		return;
+	char *result;
+	unsigned int error = ts3client_getChannelVariableAsString(serverConnectionHandlerID, channelID, flag, &result);
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_STRING(zresult, result);
+		ts3client_freeMemory(result);
+	}
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(setChannelVariableAsInt)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long flag;
+	zend_long value;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &channelID, &flag, &value) == FAILURE)
+		return;
+	unsigned int error = ts3client_setChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, value);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(setChannelVariableAsUInt64)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long flag;
+	zend_long value;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &channelID, &flag, &value) == FAILURE)
+		return;
+	unsigned int error = ts3client_setChannelVariableAsUInt64(serverConnectionHandlerID, channelID, flag, value);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(setChannelVariableAsString)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zend_long flag;
+	char *value; size_t value_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llls", &serverConnectionHandlerID, &channelID, &flag, &value, &value_len) == FAILURE)
+		return;
+	to_asciiz(&value, value_len);
+	unsigned int error = ts3client_setChannelVariableAsString(serverConnectionHandlerID, channelID, flag, value);
+	free(value);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(flushChannelUpdates)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &channelID) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_flushChannelUpdates(serverConnectionHandlerID, channelID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+TS3_FUNCTION(flushChannelCreation)
+{
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &channelID) == FAILURE)
+		return;
+	throttle(serverConnectionHandlerID);
+	struct WaitItem* item = create_return_code_item();
+	unsigned int error = ts3client_flushChannelCreation(serverConnectionHandlerID, channelID, item->return_code_text);
+	RETURN_LONG(handle_return_code(item, error));
+}
+
+/* Stages one channel property, picking the setter that matches the value. */
+static unsigned int set_channel_variable(uint64_t serverConnectionHandlerID, uint64_t channelID, zend_ulong flag, zval *value)
+{
+	switch (Z_TYPE_P(value))
+	{
+		case IS_STRING:
+			return ts3client_setChannelVariableAsString(serverConnectionHandlerID, channelID, flag, Z_STRVAL_P(value));
+		case IS_FALSE:
+		case IS_TRUE:
+			return ts3client_setChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, Z_TYPE_P(value) == IS_TRUE);
+		case IS_LONG:
+			if (flag == CHANNEL_ORDER || Z_LVAL_P(value) > INT_MAX || Z_LVAL_P(value) < INT_MIN)
+				return ts3client_setChannelVariableAsUInt64(serverConnectionHandlerID, channelID, flag, Z_LVAL_P(value));
+			return ts3client_setChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, Z_LVAL_P(value));
+		default:
+			return ERROR_parameter_invalid;
+	}
+}
+
+static const zend_ulong channel_properties[] = {
+	CHANNEL_NAME, CHANNEL_TOPIC, CHANNEL_DESCRIPTION, CHANNEL_PASSWORD, CHANNEL_CODEC, CHANNEL_CODEC_QUALITY,
+	CHANNEL_MAXCLIENTS, CHANNEL_MAXFAMILYCLIENTS, CHANNEL_ORDER, CHANNEL_FLAG_PERMANENT, CHANNEL_FLAG_SEMI_PERMANENT,
+	CHANNEL_FLAG_DEFAULT, CHANNEL_FLAG_PASSWORD, CHANNEL_CODEC_LATENCY_FACTOR, CHANNEL_CODEC_IS_UNENCRYPTED,
+	CHANNEL_SECURITY_SALT, CHANNEL_DELETE_DELAY,
+};
+
+/*
+ * Whether every property of a channel spec is known and has a value
+ * set_channel_variable can stage. The client lib keeps staged properties
+ * until the next flush, so a spec is checked completely before any of it is
+ * staged; otherwise a rejected spec would leak into the next channel.
+ */
+static bool channel_variables_valid(HashTable *properties)
+{
+	zend_ulong flag;
+	zend_string *key;
+	zval *value;
+	ZEND_HASH_FOREACH_KEY_VAL(properties, flag, key, value)
+	{
+		if (key)
+			continue;
+		if (Z_TYPE_P(value) != IS_STRING && Z_TYPE_P(value) != IS_FALSE && Z_TYPE_P(value) != IS_TRUE && Z_TYPE_P(value) != IS_LONG)
+			return false;
+		size_t i = 0;
+		while (i < sizeof(channel_properties) / sizeof(*channel_properties) && channel_properties[i] != flag)
+			++i;
+		if (i == sizeof(channel_properties) / sizeof(*channel_properties))
+			return false;
+	}
+	ZEND_HASH_FOREACH_END();
+	return true;
+}
+
+/* Stages all properties of a channel spec. String keys are not properties. */
+static unsigned int set_channel_variables(uint64_t serverConnectionHandlerID, uint64_t channelID, HashTable *properties)
+{
+	zend_ulong flag;
+	zend_string *key;
+	zval *value;
+	ZEND_HASH_FOREACH_KEY_VAL(properties, flag, key, value)
+	{
+		if (key)
+			continue;
+		unsigned int error = set_channel_variable(serverConnectionHandlerID, channelID, flag, value);
+		if (error != ERROR_ok)
+			return error;
+	}
+	ZEND_HASH_FOREACH_END();
+	return ERROR_ok;
+}
+
+TS3_FUNCTION(editChannels)
+{
+	zend_long serverConnectionHandlerID;
+	HashTable *channels;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhz/", &serverConnectionHandlerID, &channels, &zresult) == FAILURE)
+		return;
+
+	size_t count = zend_hash_num_elements(channels), i = 0;
+	struct WaitItem **items = ecalloc(count, sizeof(*items));
+	unsigned int *errors = ecalloc(count, sizeof(*errors));
+	zend_ulong channelID;
+	zend_string *key;
+	zval *properties;
+	ZEND_HASH_FOREACH_KEY_VAL(channels, channelID, key, properties)
+	{
+		if (key || Z_TYPE_P(properties) != IS_ARRAY || channel_variables_valid(Z_ARRVAL_P(properties)) == false)
+			errors[i] = ERROR_parameter_invalid;
+		else
+			errors[i] = set_channel_variables(serverConnectionHandlerID, channelID, Z_ARRVAL_P(properties));
+		if (errors[i] == ERROR_ok)
+		{
+			throttle(serverConnectionHandlerID);
+			items[i] = create_return_code_item();
+			unsigned int error = ts3client_flushChannelUpdates(serverConnectionHandlerID, channelID, items[i]->return_code_text);
+			batch_sent(&items[i], &errors[i], error);
+		}
+		++i;
+	}
+	ZEND_HASH_FOREACH_END();
+
+	wait_for_all(items, errors, count);
+
+	unsigned int error = ERROR_ok;
+	zval_dtor(zresult);
+	array_init_size(zresult, count);
+	i = 0;
+	ZEND_HASH_FOREACH_KEY_VAL(channels, channelID, key, properties)
+	{
+		(void)properties;
+		if (error == ERROR_ok)
+			error = errors[i];
+		if (key)
+			add_assoc_long_ex(zresult, ZSTR_VAL(key), ZSTR_LEN(key), errors[i]);
+		else
+			add_index_long(zresult, channelID, errors[i]);
+		++i;
+	}
+	ZEND_HASH_FOREACH_END();
+
+	efree(items);
+	efree(errors);
+	RETURN_LONG(error);
+}
+
+struct ChannelNode
+{
+	HashTable *spec;
+	zend_string *key;
+	zend_ulong index;
+	uint64_t parent_channel;
+	size_t first_child;
+	size_t child_count;
+	uint64_t channel;
+	unsigned int error;
+};
+
+static size_t add_channel_nodes(struct ChannelNode **nodes, size_t *count, size_t *capacity, HashTable *specs, uint64_t parent_channel)
+{
+	size_t first = *count;
+	zend_ulong index;
+	zend_string *key;
+	zval *spec;
+	ZEND_HASH_FOREACH_KEY_VAL(specs, index, key, spec)
+	{
+		if (*count == *capacity)
+		{
+			*capacity = *capacity ? *capacity * 2 : 16;
+			*nodes = erealloc(*nodes, *capacity * sizeof(**nodes));
+		}
+		struct ChannelNode *node = &(*nodes)[(*count)++];
+		node->spec = Z_TYPE_P(spec) == IS_ARRAY ? Z_ARRVAL_P(spec) : NULL;
+		node->key = key;
+		node->index = index;
+		node->parent_channel = parent_channel;
+		node->first_child = 0;
+		node->child_count = 0;
+		node->channel = 0;
+		node->error = node->spec ? ERROR_ok : ERROR_parameter_invalid;
+	}
+	ZEND_HASH_FOREACH_END();
+	return *count - first;
+}
+
+static void channel_nodes_to_zval(const struct ChannelNode *nodes, size_t first, size_t count, zval *zresult)
+{
+	array_init_size(zresult, count);
+	for (size_t i = first; i < first + count; ++i)
+	{
+		zval znode;
+		array_init(&znode);
+		add_assoc_long(&znode, "channelID", nodes[i].channel);
+		add_assoc_long(&znode, "error", nodes[i].error);
+		if (nodes[i].child_count)
+		{
+			zval zchildren;
+			channel_nodes_to_zval(nodes, nodes[i].first_child, nodes[i].child_count, &zchildren);
+			add_assoc_zval(&znode, "children", &zchildren);
+		}
+		if (nodes[i].key)
+			add_assoc_zval_ex(zresult, ZSTR_VAL(nodes[i].key), ZSTR_LEN(nodes[i].key), &znode);
+		else
+			add_index_zval(zresult, nodes[i].index, &znode);
+	}
+}
+
+TS3_FUNCTION(provisionChannels)
+{
+	zend_long serverConnectionHandlerID;
+	HashTable *tree;
+	zval *zresult;
+	zend_long channelParentID = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhz/|l", &serverConnectionHandlerID, &tree, &zresult, &channelParentID) == FAILURE)
+		return;
+
+	struct ChannelNode *nodes = NULL;
+	size_t count = 0, capacity = 0;
+	size_t top_level = add_channel_nodes(&nodes, &count, &capacity, tree, channelParentID);
+
+	/* Siblings are created together, children once their parent's ID is known. */
+	size_t level_begin = 0, level_end = count;
+	while (level_begin < level_end)
+	{
+		size_t level_size = level_end - level_begin;
+		struct WaitItem **items = ecalloc(level_size, sizeof(*items));
+		unsigned int *errors = ecalloc(level_size, sizeof(*errors));
+		for (size_t i = 0; i < level_size; ++i)
+		{
+			struct ChannelNode *node = &nodes[level_begin + i];
+			errors[i] = node->error;
+			if (errors[i] == ERROR_ok && channel_variables_valid(node->spec) == false)
+				errors[i] = ERROR_parameter_invalid;
+			if (errors[i] == ERROR_ok)
+				errors[i] = set_channel_variables(serverConnectionHandlerID, 0, node->spec);
+			if (errors[i] != ERROR_ok)
+				continue;
+			throttle(serverConnectionHandlerID);
+			items[i] = create_return_code_item();
+			unsigned int error = ts3client_flushChannelCreation(serverConnectionHandlerID, node->parent_channel, items[i]->return_code_text);
+			batch_sent(&items[i], &errors[i], error);
+		}
+
+		wait_for_items(items, errors, level_size);
+		for (size_t i = 0; i < level_size; ++i)
+		{
+			struct ChannelNode *node = &nodes[level_begin + i];
+			node->error = errors[i];
+			if (items[i] != NULL)
+			{
+				node->channel = items[i]->created_channel;
+				if (node->error == ERROR_ok && node->channel == 0)
+					node->error = ERROR_undefined;
+			}
+		}
+		free_items(items, level_size);
+		efree(items);
+		efree(errors);
+
+		for (size_t i = level_begin; i < level_end; ++i)
+		{
+			zval *children;
+			if (nodes[i].error != ERROR_ok || (children = zend_hash_str_find(nodes[i].spec, ZEND_STRL("children"))) == NULL || Z_TYPE_P(children) != IS_ARRAY)
+				continue;
+			const size_t first_child = count;
+			const size_t child_count = add_channel_nodes(&nodes, &count, &capacity, Z_ARRVAL_P(children), nodes[i].channel);
+			nodes[i].first_child = first_child;
+			nodes[i].child_count = child_count;
+		}
+		level_begin = level_end;
+		level_end = count;
+	}
+
+	unsigned int error = ERROR_ok;
+	for (size_t i = 0; i < count && error == ERROR_ok; ++i)
+		error = nodes[i].error;
 
-PHP_FUNCTION(ts3client_getClientLibVersion)
+	zval_dtor(zresult);
+	channel_nodes_to_zval(nodes, 0, top_level, zresult);
+	if (nodes)
+		efree(nodes);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(getChannelList)
 {
-	char *result;
-	unsigned int error = ts3client_getClientLibVersion(&result);
+	zend_long serverConnectionHandlerID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+		return;
+	uint64_t* result;
+	unsigned int error = ts3client_getChannelList(serverConnectionHandlerID, &result);
 	if (error == ERROR_ok)
 	{
-		zval *zresult;
-		if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
-			return;
 		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
+		array_init(zresult);
+		for  (uint64_t* p = result; *p; ++p)
+		{
+			add_next_index_long(zresult, *p);
+		}
 		ts3client_freeMemory(result);
 	}
-    RETURN_LONG(error);
+	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_getClientLibVersionNumber)
+TS3_FUNCTION(getChannelClientList)
 {
-	uint64_t result;
-	unsigned int error = ts3client_getClientLibVersionNumber(&result);
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &channelID, &zresult) == FAILURE)
+		return;
+	anyID* result;
+	unsigned int error = ts3client_getChannelClientList(serverConnectionHandlerID, channelID, &result);
 	if (error == ERROR_ok)
 	{
-		zval *zresult;
-		if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
-			return;
 		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		array_init(zresult);
+		for  (anyID* p = result; *p; ++p)
+		{
+			add_next_index_long(zresult, *p);
+		}
+		ts3client_freeMemory(result);
 	}
-    RETURN_LONG(error);
+	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_spawnNewServerConnectionHandler)
+TS3_FUNCTION(getParentChannelOfChannel)
 {
-	zend_long port;
+	zend_long serverConnectionHandlerID;
+	zend_long channelID;
 	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &port, &zresult) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &channelID, &zresult) == FAILURE)
 		return;
 	uint64_t result;
-	unsigned int error = ts3client_spawnNewServerConnectionHandler(port, &result);
+	unsigned int error = ts3client_getParentChannelOfChannel(serverConnectionHandlerID, channelID, &result);
 	if (error == ERROR_ok)
 	{
 		zval_dtor(zresult);
@@ -675,59 +6480,66 @@ PHP_FUNCTION(ts3client_spawnNewServerConnectionHandler)
 	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_destroyServerConnectionHandler)
+TS3_FUNCTION(getChannelEmptySecs)
 {
 	zend_long serverConnectionHandlerID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+	zend_long channelID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &channelID, &zresult) == FAILURE)
 		return;
-	unsigned int error = ts3client_destroyServerConnectionHandler(serverConnectionHandlerID);
+	int result;
+	unsigned int error = ts3client_getChannelEmptySecs(serverConnectionHandlerID, channelID, &result);
 	if (error == ERROR_ok)
-		delete_connection_item(serverConnectionHandlerID);
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
+	}
 	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_createIdentity)
+TS3_FUNCTION(getServerVariableAsInt)
 {
-	char *identity;
-	unsigned int error = ts3client_createIdentity(&identity);
-	if (error== ERROR_ok)
+	zend_long serverConnectionHandlerID;
+	zend_long flag;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
+		return;
+	int result;
+	unsigned int error = ts3client_getServerVariableAsInt(serverConnectionHandlerID, flag, &result);
+	if (error == ERROR_ok)
 	{
-		zval *zidentity;
-		if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zidentity) == FAILURE)
-			return;
-		zval_dtor(zidentity);
-		ZVAL_STRING(zidentity, identity);
-		ts3client_freeMemory(identity);
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, result);
 	}
-    RETURN_LONG(error);
+	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_identityStringToUniqueIdentifier)
+TS3_FUNCTION(getServerVariableAsUInt64)
 {
-	char *identityString, *result;
-	size_t identityString_len;
+	zend_long serverConnectionHandlerID;
+	zend_long flag;
 	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz/", &identityString, &identityString_len, &zresult) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
 		return;
-	to_asciiz(&identityString, identityString_len);
-	unsigned int error = ts3client_identityStringToUniqueIdentifier(identityString, &result);
-	free(identityString);
+	uint64_t result;
+	unsigned int error = ts3client_getServerVariableAsUInt64(serverConnectionHandlerID, flag, &result);
 	if (error == ERROR_ok)
 	{
 		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
+		ZVAL_LONG(zresult, result);
 	}
 	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_getErrorMessage)
+TS3_FUNCTION(getServerVariableAsString)
 {
-	zend_long errorCode;
+	zend_long serverConnectionHandlerID;
+	zend_long flag;
 	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &errorCode, &zresult) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
 		return;
 	char *result;
-	unsigned int error = ts3client_getErrorMessage(errorCode, &result);
+	unsigned int error = ts3client_getServerVariableAsString(serverConnectionHandlerID, flag, &result);
 	if (error == ERROR_ok)
 	{
 		zval_dtor(zresult);
@@ -737,801 +6549,2092 @@ PHP_FUNCTION(ts3client_getErrorMessage)
 	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_startConnection)
+TS3_FUNCTION(requestServerVariables)
 {
 	zend_long serverConnectionHandlerID;
-	char* identity;               size_t identity_len;
-	char* ip;                     size_t ip_len;
-	zend_long port;
-	char* nickname;               size_t nickname_len;
-	zend_long defaultChannelID;
-	char* defaultChannelPassword; size_t defaultChannelPassword_len;
-	char* serverPassword;         size_t serverPassword_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lsslslss",
-				&serverConnectionHandlerID,
-				&identity, &identity_len,
-			   	&ip, &ip_len,
-				&port,
-				&nickname, &nickname_len,
-				&defaultChannelID,
-				&defaultChannelPassword, &defaultChannelPassword_len,
-				&serverPassword, &serverPassword_len)
-			== FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
 		return;
-	to_asciiz(&identity, identity_len);
-	to_asciiz(&ip, ip_len);
-	to_asciiz(&nickname, nickname_len);
-	to_asciiz(&defaultChannelPassword, defaultChannelPassword_len);
-	to_asciiz(&serverPassword, serverPassword_len);
+	throttle(serverConnectionHandlerID);
+	unsigned int error = ts3client_requestServerVariables(serverConnectionHandlerID);
+	RETURN_LONG(error);
+}
 
-	struct ConnectionItem* connection_item = get_connection_item(serverConnectionHandlerID);
-	enum ConnectState expected = CONNECT_STATE_NONE;
-	if (atomic_compare_exchange_strong(&connection_item->expected_state, &expected, CONNECT_STATE_CONNECTING) == false)
+TS3_FUNCTION(setFloodControl)
+{
+	zend_long serverConnectionHandlerID;
+	double commandsPerSecond;
+	double burst;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ldd", &serverConnectionHandlerID, &commandsPerSecond, &burst) == FAILURE)
+		return;
+	if (commandsPerSecond < 0 || (commandsPerSecond > 0 && burst < 1))
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	if (item == NULL)
+	{
+		unlock_mutex(&mutex);
+		RETURN_LONG(ERROR_invalid_server_connection_handler_id);
+	}
+	item->flood.rate = commandsPerSecond;
+	item->flood.burst = burst;
+	item->flood.current_rate = commandsPerSecond;
+	item->flood.tokens = burst;
+	clock_gettime(CLOCK_MONOTONIC, &item->flood.updated);
+	unlock_mutex(&mutex);
+	RETURN_LONG(ERROR_ok);
+}
+
+TS3_FUNCTION(getFloodControl)
+{
+	zend_long serverConnectionHandlerID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+		return;
+
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	if (item == NULL)
+	{
+		unlock_mutex(&mutex);
+		RETURN_LONG(ERROR_invalid_server_connection_handler_id);
+	}
+	struct FloodBucket flood = item->flood;
+	unlock_mutex(&mutex);
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_double(zresult, "commandsPerSecond", flood.rate);
+	add_assoc_double(zresult, "burst", flood.burst);
+	add_assoc_double(zresult, "currentCommandsPerSecond", flood.current_rate);
+	RETURN_LONG(ERROR_ok);
+}
+
+/* Argument types of every operation, in order: 'l' for integers, 's' for strings. */
+static const char *const operation_arguments[OPERATION_COUNT] =
+{
+	[OPERATION_START_CONNECTION]          = "sslslss",
+	[OPERATION_STOP_CONNECTION]           = "s",
+	[OPERATION_CLIENT_MOVE]               = "lls",
+	[OPERATION_CHANNEL_DELETE]            = "ll",
+	[OPERATION_FLUSH_CLIENT_SELF_UPDATES] = "",
+	[OPERATION_FLUSH_CHANNEL_UPDATES]     = "l",
+	[OPERATION_FLUSH_CHANNEL_CREATION]    = "l",
+	[OPERATION_SEND_TEXT_MESSAGE]         = "lls",
+};
+
+TS3_FUNCTION(submit)
+{
+	static _Atomic zend_long next_ticket = ATOMIC_VAR_INIT(1);
+	zend_long serverConnectionHandlerID;
+	zend_long operation;
+	HashTable *arguments;
+	zval *zticket;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llhz/", &serverConnectionHandlerID, &operation, &arguments, &zticket) == FAILURE)
+		return;
+	if (operation < OPERATION_START_CONNECTION || operation >= OPERATION_COUNT)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	struct CompletionQueue *completions = get_completion_queue();
+	if (completions == NULL || start_io_worker() == false)
+		RETURN_LONG(ERROR_undefined);
+
+	struct Submission *submission = calloc(1, sizeof(struct Submission));
+	atomic_fetch_add(&completions->references, 1);
+	submission->completions = completions;
+	submission->serverConnectionHandlerID = serverConnectionHandlerID;
+	submission->operation = operation;
+	const char *types = operation_arguments[operation];
+	for (size_t i = 0; types[i] != '\0'; ++i)
+	{
+		zval *argument = zend_hash_index_find(arguments, i);
+		if (argument == NULL)
+		{
+			free_submission(submission);
+			RETURN_LONG(ERROR_parameter_invalid);
+		}
+		if (types[i] == 's')
+		{
+			zend_string *string = zval_get_string(argument);
+			submission->strings[i] = strndup(ZSTR_VAL(string), ZSTR_LEN(string));
+			zend_string_release(string);
+		}
+		else submission->numbers[i] = zval_get_long(argument);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &submission->deadline);
+	submission->deadline.tv_sec += TS3CLIENT_G(timeout);
+	submission->ticket = next_ticket++;
+
+	zend_long ticket = submission->ticket;
+	if (push_submission(submission) == false)
+	{
+		free_submission(submission);
 		RETURN_LONG(ERROR_currently_not_possible);
+	}
+	ring_io_worker();
 
-	unsigned int error = ts3client_startConnectionWithChannelID(
-			serverConnectionHandlerID,
-			identity,
-			ip,
-			port,
-			nickname,
-			defaultChannelID,
-			defaultChannelPassword,
-			serverPassword);
+	zval_dtor(zticket);
+	ZVAL_LONG(zticket, ticket);
+	RETURN_LONG(ERROR_ok);
+}
 
-	free(identity);
-	free(ip);
-	free(nickname);
-	free(defaultChannelPassword);
-	free(serverPassword);
+TS3_FUNCTION(getCompletionFd)
+{
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
+		return;
+
+	struct CompletionQueue *completions = get_completion_queue();
+	if (completions == NULL)
+		RETURN_LONG(ERROR_undefined);
+	int fd = dup(completions->fd);
+	php_stream *stream = fd < 0 ? NULL : php_stream_fopen_from_fd(fd, "r", NULL);
+	if (stream == NULL)
+	{
+		if (fd >= 0)
+			close(fd);
+		RETURN_LONG(ERROR_undefined);
+	}
+	zval_dtor(zresult);
+	php_stream_to_zval(stream, zresult);
+	RETURN_LONG(ERROR_ok);
+}
+
+TS3_FUNCTION(reapCompletions)
+{
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
+		return;
 
+	zval_dtor(zresult);
+	array_init(zresult);
+	struct CompletionQueue *completions = TS3CLIENT_G(completions);
+	if (completions == NULL)
+		RETURN_LONG(ERROR_ok);
+
+	uint64_t count;
+	ssize_t read_bytes = read(completions->fd, &count, sizeof(count));
+	(void)read_bytes;
+
+	pthread_mutex_lock(&completions->lock);
+	struct Completion *completion = completions->head;
+	completions->head = NULL;
+	completions->tail = &completions->head;
+	pthread_mutex_unlock(&completions->lock);
+
+	while (completion != NULL)
+	{
+		zval entry;
+		array_init(&entry);
+		add_assoc_long(&entry, "ticket", completion->ticket);
+		add_assoc_long(&entry, "serverConnectionHandlerID", completion->serverConnectionHandlerID);
+		add_assoc_long(&entry, "operation", completion->operation);
+		add_assoc_long(&entry, "error", completion->error);
+		if (completion->operation == OPERATION_FLUSH_CHANNEL_CREATION)
+			add_assoc_long(&entry, "channelID", completion->channelID);
+		add_next_index_zval(zresult, &entry);
+
+		struct Completion *next = completion->next;
+		free(completion);
+		completion = next;
+	}
+	RETURN_LONG(ERROR_ok);
+}
+
+TS3_FUNCTION(dispatchCompletions)
+{
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "") == FAILURE)
+		return;
+
+	struct CompletionQueue *completions = TS3CLIENT_G(completions);
+	if (completions == NULL)
+		RETURN_LONG(ERROR_ok);
+
+	uint64_t count;
+	ssize_t read_bytes = read(completions->fd, &count, sizeof(count));
+	(void)read_bytes;
+
+#if PHP_VERSION_ID >= 80100
+	/* A resumed fiber may start new waits or end others, so the scan restarts after every resume. */
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	struct FiberWait *wait = TS3CLIENT_G(fiber_waits);
+	while (wait != NULL)
+	{
+		if (fiber_wait_ready(wait, &now) == false)
+		{
+			wait = wait->next;
+			continue;
+		}
+
+		zend_fiber *fiber = wait->fiber;
+		unlink_fiber_wait(wait);
+		GC_ADDREF(&fiber->std);
+		zval retval;
+		ZVAL_UNDEF(&retval);
+		struct FiberScope scope;
+		swap_out_fiber_scope(&scope);
+		zend_call_method_with_0_params(&fiber->std, zend_ce_fiber, NULL, "resume", &retval);
+		swap_in_fiber_scope(&scope);
+		zval_ptr_dtor(&retval);
+		OBJ_RELEASE(&fiber->std);
+		if (EG(exception))
+		{
+			uint64_t one = 1;
+			ssize_t written = write(completions->fd, &one, sizeof(one));
+			(void)written;
+			return;
+		}
+		clock_gettime(CLOCK_REALTIME, &now);
+		wait = TS3CLIENT_G(fiber_waits);
+	}
+#endif
+	RETURN_LONG(ERROR_ok);
+}
+
+TS3_FUNCTION(registerCustomDevice)
+{
+	char* deviceID;          size_t deviceID_len;
+	char* deviceDisplayName; size_t deviceDisplayName_len;
+	zend_long capFrequency;
+	zend_long capChannels;
+	zend_long playFrequency;
+	zend_long playChannels;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ssllll", &deviceID, &deviceID_len, &deviceDisplayName, &deviceDisplayName_len, &capFrequency, &capChannels, &playFrequency, &playChannels) == FAILURE)
+		return;
+	if (capFrequency <= 0 || capFrequency > CUSTOM_DEVICE_MAX_FREQUENCY || capFrequency % (1000 / CUSTOM_DEVICE_FRAME_MS) != 0
+			|| capChannels < 1 || capChannels > CUSTOM_DEVICE_MAX_CHANNELS
+			|| playFrequency <= 0 || playFrequency > CUSTOM_DEVICE_MAX_FREQUENCY || playFrequency % (1000 / CUSTOM_DEVICE_FRAME_MS) != 0
+			|| playChannels < 1 || playChannels > CUSTOM_DEVICE_MAX_CHANNELS)
+		RETURN_LONG(ERROR_parameter_invalid);
+	to_asciiz(&deviceID, deviceID_len);
+	to_asciiz(&deviceDisplayName, deviceDisplayName_len);
+
+	struct CustomDevice *device = calloc(1, sizeof(struct CustomDevice));
+	device->id = deviceID;
+	device->display_name = deviceDisplayName;
+	device->capture_frequency = capFrequency;
+	device->capture_channels = capChannels;
+	device->playback_frequency = playFrequency;
+	device->playback_channels = playChannels;
+	device->playback_writing = &device->playback;
+	device->playback_reading = &device->playback;
+	pthread_mutex_init(&device->feed_lock, NULL);
+	pthread_mutex_init(&device->record_lock, NULL);
+	atomic_init(&device->capture_underruns, 0);
+	atomic_init(&device->capture_gain, 1.0f);
+	atomic_init(&device->playback_capturing, false);
+	atomic_init(&device->playback_overruns, 0);
+	atomic_init(&device->playback_gain, 1.0f);
+	atomic_init(&device->references, 1);
+	if (init_sample_ring(&device->capture, (size_t)capFrequency * capChannels / 1000 * CUSTOM_DEVICE_BUFFER_MS) == false
+			|| init_sample_ring(&device->playback, (size_t)playFrequency * playChannels / 1000 * CUSTOM_PLAYBACK_BUFFER_MS) == false)
+	{
+		release_custom_device(device);
+		RETURN_LONG(ERROR_undefined);
+	}
+
+	unsigned int error = ERROR_sound_device_already_registerred;
+	lock_mutex(&device_mutex);
+	if (find_custom_device(deviceID) == NULL)
+	{
+		error = ts3client_registerCustomDevice(deviceID, deviceDisplayName, capFrequency, capChannels, playFrequency, playChannels);
+		if (error == ERROR_ok && start_pacer() == false)
+		{
+			ts3client_unregisterCustomDevice(deviceID);
+			error = ERROR_undefined;
+		}
+	}
 	if (error == ERROR_ok)
 	{
-		wait_for(&connection_item->state_changed);
-		RETVAL_LONG(connection_item->state_changed.result);
+		device->next = custom_devices;
+		custom_devices = device;
+	}
+	unlock_mutex(&device_mutex);
+
+	if (error != ERROR_ok)
+		release_custom_device(device);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(unregisterCustomDevice)
+{
+	char* deviceID; size_t deviceID_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "s", &deviceID, &deviceID_len) == FAILURE)
+		return;
+
+	lock_mutex(&device_mutex);
+	struct CustomDevice **parent = &custom_devices;
+	while (*parent != NULL && strcmp((*parent)->id, deviceID) != 0)
+		parent = &(*parent)->next;
+	struct CustomDevice *device = *parent;
+	unsigned int error = device != NULL ? ts3client_unregisterCustomDevice(device->id) : ERROR_sound_unknown_device;
+	if (error == ERROR_ok)
+		*parent = device->next;
+	unlock_mutex(&device_mutex);
+
+	if (error == ERROR_ok)
+		release_custom_device(device);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(openCaptureDevice)
+{
+	zend_long serverConnectionHandlerID;
+	char* modeID;        size_t modeID_len;
+	char* captureDevice; size_t captureDevice_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lss", &serverConnectionHandlerID, &modeID, &modeID_len, &captureDevice, &captureDevice_len) == FAILURE)
+		return;
+	to_asciiz(&modeID, modeID_len);
+	to_asciiz(&captureDevice, captureDevice_len);
+	unsigned int error = ts3client_openCaptureDevice(serverConnectionHandlerID, modeID, captureDevice);
+	free(modeID);
+	free(captureDevice);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(closeCaptureDevice)
+{
+	zend_long serverConnectionHandlerID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+		return;
+	RETURN_LONG(ts3client_closeCaptureDevice(serverConnectionHandlerID));
+}
+
+TS3_FUNCTION(feedCustomCapture)
+{
+	char* deviceID; size_t deviceID_len;
+	zval *zdata;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "szz/", &deviceID, &deviceID_len, &zdata, &zresult) == FAILURE)
+		return;
+
+	php_stream *stream = NULL;
+	if (Z_TYPE_P(zdata) == IS_RESOURCE)
+	{
+		php_stream_from_zval_no_verify(stream, zdata);
+		if (stream == NULL)
+			RETURN_LONG(ERROR_parameter_invalid);
 	}
+	else if (Z_TYPE_P(zdata) != IS_STRING)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
+
+	size_t consumed;
+	pthread_mutex_lock(&device->feed_lock);
+	if (stream != NULL)
+		consumed = sample_ring_write_stream(&device->capture, stream, &device->has_carry, &device->carry);
 	else
-	{
-		RETVAL_LONG(error)
-	}
+		consumed = sample_ring_write_bytes(&device->capture, Z_STRVAL_P(zdata), Z_STRLEN_P(zdata));
+	pthread_mutex_unlock(&device->feed_lock);
+	release_custom_device(device);
 
-	atomic_exchange(&connection_item->expected_state, CONNECT_STATE_NONE);
+	zval_dtor(zresult);
+	ZVAL_LONG(zresult, consumed);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_stopConnection)
+TS3_FUNCTION(getCustomCaptureStatus)
+{
+	char* deviceID; size_t deviceID_len;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz/", &deviceID, &deviceID_len, &zresult) == FAILURE)
+		return;
+
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
+
+	const size_t buffered = sample_ring_readable(&device->capture);
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_long(zresult, "buffered", buffered * sizeof(int16_t));
+	add_assoc_long(zresult, "capacity", device->capture.capacity * sizeof(int16_t));
+	add_assoc_long(zresult, "bufferedMilliseconds", buffered * 1000 / ((size_t)device->capture_frequency * device->capture_channels));
+	add_assoc_long(zresult, "underruns", atomic_load(&device->capture_underruns));
+	add_assoc_double(zresult, "gain", atomic_load(&device->capture_gain));
+	add_assoc_long(zresult, "peak", atomic_load(&device->capture_peak));
+	add_assoc_long(zresult, "rms", atomic_load(&device->capture_rms));
+	release_custom_device(device);
+	RETURN_LONG(ERROR_ok);
+}
+
+TS3_FUNCTION(openPlaybackDevice)
 {
 	zend_long serverConnectionHandlerID;
-	char* reason; size_t reason_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ls", &serverConnectionHandlerID, &reason, &reason_len) == FAILURE)
+	char* modeID;         size_t modeID_len;
+	char* playbackDevice; size_t playbackDevice_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lss", &serverConnectionHandlerID, &modeID, &modeID_len, &playbackDevice, &playbackDevice_len) == FAILURE)
 		return;
-	to_asciiz(&reason, reason_len);
+	to_asciiz(&modeID, modeID_len);
+	to_asciiz(&playbackDevice, playbackDevice_len);
+	unsigned int error = ts3client_openPlaybackDevice(serverConnectionHandlerID, modeID, playbackDevice);
+	free(modeID);
+	free(playbackDevice);
+	RETURN_LONG(error);
+}
 
-	struct ConnectionItem* connection_item = get_connection_item(serverConnectionHandlerID);
-	enum ConnectState expected = CONNECT_STATE_NONE;
-	if (atomic_compare_exchange_strong(&connection_item->expected_state, &expected, CONNECT_STATE_DISCONNECTING) == false)
-		RETURN_LONG(ERROR_currently_not_possible);
+TS3_FUNCTION(closePlaybackDevice)
+{
+	zend_long serverConnectionHandlerID;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+		return;
+	RETURN_LONG(ts3client_closePlaybackDevice(serverConnectionHandlerID));
+}
 
-	unsigned int error = ts3client_stopConnection(serverConnectionHandlerID, reason);
+TS3_FUNCTION(startCustomPlayback)
+{
+	char* deviceID; size_t deviceID_len;
+	char* path = NULL; size_t path_len = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "s|s!", &deviceID, &deviceID_len, &path, &path_len) == FAILURE)
+		return;
 
-	free(reason);
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
 
+	unsigned int error = ERROR_ok;
+	pthread_mutex_lock(&device->record_lock);
+	if (atomic_load(&device->playback_capturing))
+		error = ERROR_currently_not_possible;
+	else if (path != NULL)
+	{
+		lock_mutex(&device_mutex);
+		bool started = start_recorder();
+		unlock_mutex(&device_mutex);
+		device->recording = started ? wav_create(path, device->playback_frequency, device->playback_channels) : NULL;
+		if (device->recording == NULL)
+			error = started ? ERROR_file_io_error : ERROR_undefined;
+	}
 	if (error == ERROR_ok)
 	{
-		wait_for(&connection_item->state_changed);
-		RETVAL_LONG(connection_item->state_changed.result);
+		drain_playback(device, &discard_sink, NULL);
+		atomic_store(&device->playback_capturing, true);
 	}
-	else
+	pthread_mutex_unlock(&device->record_lock);
+	release_custom_device(device);
+	RETURN_LONG(error);
+}
+
+TS3_FUNCTION(stopCustomPlayback)
+{
+	char* deviceID; size_t deviceID_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "s", &deviceID, &deviceID_len) == FAILURE)
+		return;
+
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
+
+	unsigned int error = ERROR_ok;
+	pthread_mutex_lock(&device->record_lock);
+	atomic_store(&device->playback_capturing, false);
+	if (device->recording != NULL)
 	{
-		RETVAL_LONG(error)
+		drain_playback(device, &wav_sink, device->recording);
+		if (wav_close(device->recording) == false)
+			error = ERROR_file_io_error;
+		device->recording = NULL;
 	}
+	pthread_mutex_unlock(&device->record_lock);
+	release_custom_device(device);
+	RETURN_LONG(error);
+}
 
-	atomic_exchange(&connection_item->expected_state, CONNECT_STATE_NONE);
+static size_t php_stream_sink(void *context, const int16_t *samples, size_t count)
+{
+	ssize_t written = php_stream_write((php_stream *)context, (const char *)samples, count * sizeof(int16_t));
+	return written > 0 ? (size_t)written / sizeof(int16_t) : 0;
 }
 
-PHP_FUNCTION(ts3client_requestClientMove)
+TS3_FUNCTION(readCustomPlayback)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long newChannelID;
-	char* password; size_t password_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llls", &serverConnectionHandlerID, &clientID, &newChannelID, &password, &password_len) == FAILURE)
+	char* deviceID; size_t deviceID_len;
+	zval *zstream;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "szz/", &deviceID, &deviceID_len, &zstream, &zresult) == FAILURE)
 		return;
-	to_asciiz(&password, password_len);
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestClientMove(serverConnectionHandlerID, clientID, newChannelID, password, item->return_code_text);
-	free(password);
-	RETURN_LONG(handle_return_code(item, error));
+
+	php_stream *stream = NULL;
+	if (Z_TYPE_P(zstream) == IS_RESOURCE)
+		php_stream_from_zval_no_verify(stream, zstream);
+	if (stream == NULL)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
+
+	size_t samples = 0;
+	unsigned int error = ERROR_ok;
+	pthread_mutex_lock(&device->record_lock);
+	if (device->recording != NULL)
+		error = ERROR_currently_not_possible;
+	else
+		samples = drain_playback(device, &php_stream_sink, stream);
+	pthread_mutex_unlock(&device->record_lock);
+	release_custom_device(device);
+
+	if (error == ERROR_ok)
+	{
+		zval_dtor(zresult);
+		ZVAL_LONG(zresult, samples * sizeof(int16_t));
+	}
+	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_requestClientVariables)
+TS3_FUNCTION(getCustomPlaybackStatus)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &clientID) == FAILURE)
+	char* deviceID; size_t deviceID_len;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz/", &deviceID, &deviceID_len, &zresult) == FAILURE)
 		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestClientVariables(serverConnectionHandlerID, clientID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error));
+
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
+
+	size_t capacity = 0;
+	pthread_mutex_lock(&device->record_lock);
+	const size_t buffered = buffered_playback(device, &capacity);
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_bool(zresult, "capturing", atomic_load(&device->playback_capturing));
+	add_assoc_long(zresult, "buffered", buffered * sizeof(int16_t));
+	add_assoc_long(zresult, "capacity", capacity * sizeof(int16_t));
+	add_assoc_long(zresult, "bufferedMilliseconds", buffered * 1000 / ((size_t)device->playback_frequency * device->playback_channels));
+	add_assoc_long(zresult, "overruns", atomic_load(&device->playback_overruns));
+	add_assoc_double(zresult, "gain", atomic_load(&device->playback_gain));
+	add_assoc_long(zresult, "peak", atomic_load(&device->playback_peak));
+	add_assoc_long(zresult, "rms", atomic_load(&device->playback_rms));
+	add_assoc_long(zresult, "recorded", device->recording != NULL ? device->recording->data_bytes : 0);
+	add_assoc_long(zresult, "error", device->recording != NULL && device->recording->failed ? ERROR_file_io_error : ERROR_ok);
+	pthread_mutex_unlock(&device->record_lock);
+	release_custom_device(device);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestClientKickFromChannel)
+static bool allocate_speaker_tracks(void)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	char* kickReason; size_t kickReason_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lls", &serverConnectionHandlerID, &clientID, &kickReason, &kickReason_len) == FAILURE)
-		return;
-	to_asciiz(&kickReason, kickReason_len);
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestClientKickFromChannel(serverConnectionHandlerID, clientID, kickReason, item->return_code_text);
-	free(kickReason);
-	RETURN_LONG(handle_return_code(item, error));
+	if (speakers.tracks != NULL)
+		return true;
+	struct SpeakerTrack *tracks = calloc(SPEAKER_TRACKS, sizeof(struct SpeakerTrack));
+	if (tracks == NULL)
+		return false;
+	for (int i = 0; i < SPEAKER_TRACKS; ++i)
+	{
+		if (init_sample_ring(&tracks[i].samples, SPEAKER_FREQUENCY / 1000 * SPEAKER_BUFFER_MS) == false)
+		{
+			while (i-- > 0)
+				free(tracks[i].samples.samples);
+			free(tracks);
+			return false;
+		}
+		atomic_init(&tracks[i].state, SPEAKER_FREE);
+		atomic_init(&tracks[i].writers, 0);
+	}
+	speakers.tracks = tracks;
+	return true;
 }
 
-PHP_FUNCTION(ts3client_requestClientKickFromServer)
+TS3_FUNCTION(startSpeakerRecording)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	char* kickReason; size_t kickReason_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lls", &serverConnectionHandlerID, &clientID, &kickReason, &kickReason_len) == FAILURE)
+	char* directory; size_t directory_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "p", &directory, &directory_len) == FAILURE)
 		return;
-	to_asciiz(&kickReason, kickReason_len);
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestClientKickFromServer(serverConnectionHandlerID, clientID, kickReason, item->return_code_text);
-	free(kickReason);
-	RETURN_LONG(handle_return_code(item, error));
+
+	struct stat info;
+	if (stat(directory, &info) != 0 || S_ISDIR(info.st_mode) == false)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	unsigned int error = ERROR_ok;
+	lock_mutex(&speakers.lock);
+	if (atomic_load(&speakers.active))
+		error = ERROR_currently_not_possible;
+	else if (allocate_speaker_tracks() == false)
+		error = ERROR_undefined;
+	else
+	{
+		lock_mutex(&device_mutex);
+		bool started = start_recorder();
+		unlock_mutex(&device_mutex);
+		if (started)
+		{
+			free(speakers.directory);
+			speakers.directory = strdup(directory);
+			atomic_store(&speakers.dropped, 0);
+			atomic_store(&speakers.active, true);
+		}
+		else
+			error = ERROR_undefined;
+	}
+	unlock_mutex(&speakers.lock);
+	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_requestChannelDelete)
+TS3_FUNCTION(stopSpeakerRecording)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_bool force;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llb", &serverConnectionHandlerID, &channelID, &force) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "") == FAILURE)
 		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestChannelDelete(serverConnectionHandlerID, channelID, force, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error));
+
+	lock_mutex(&speakers.lock);
+	atomic_store(&speakers.active, false);
+	if (speakers.tracks != NULL)
+	{
+		for (int i = 0; i < SPEAKER_TRACKS; ++i)
+			close_speaker_track(&speakers.tracks[i]);
+	}
+	unlock_mutex(&speakers.lock);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestChannelMove)
+TS3_FUNCTION(getSpeakerRecordingStatus)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long newChannelParentID;
-	zend_long newChannelOrder;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &channelID, &newChannelParentID, &newChannelOrder) == FAILURE)
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
 		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestChannelMove(serverConnectionHandlerID, channelID, newChannelParentID, newChannelOrder, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error))
+
+	zval ztracks;
+	array_init(&ztracks);
+	lock_mutex(&speakers.lock);
+	for (int i = 0; speakers.tracks != NULL && i < SPEAKER_TRACKS; ++i)
+	{
+		struct SpeakerTrack *track = &speakers.tracks[i];
+		if (atomic_load(&track->state) != SPEAKER_ACTIVE)
+			continue;
+		zval ztrack;
+		array_init(&ztrack);
+		add_assoc_long(&ztrack, "serverConnectionHandlerID", track->serverConnectionHandlerID);
+		add_assoc_long(&ztrack, "clientID", track->clientID);
+		add_assoc_long(&ztrack, "started", track->started.tv_sec);
+		if (track->path != NULL)
+			add_assoc_string(&ztrack, "path", track->path);
+		else
+			add_assoc_null(&ztrack, "path");
+		add_assoc_long(&ztrack, "recorded", track->file != NULL ? track->file->data_bytes : 0);
+		add_assoc_long(&ztrack, "overruns", atomic_load(&track->overruns));
+		add_assoc_long(&ztrack, "peak", atomic_load(&track->peak));
+		add_assoc_long(&ztrack, "rms", atomic_load(&track->rms));
+		add_next_index_zval(&ztracks, &ztrack);
+	}
+	unlock_mutex(&speakers.lock);
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_bool(zresult, "recording", atomic_load(&speakers.active));
+	add_assoc_long(zresult, "dropped", atomic_load(&speakers.dropped));
+	add_assoc_zval(zresult, "tracks", &ztracks);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestSendPrivateTextMsg)
+TS3_FUNCTION(setCustomDeviceGain)
 {
-	zend_long serverConnectionHandlerID;
-	char* message; size_t message_len;
-	zend_long targetClientID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lsl", &serverConnectionHandlerID, &message, &message_len, &targetClientID) == FAILURE)
+	char* deviceID; size_t deviceID_len;
+	double captureGain;
+	double playbackGain;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "sdd", &deviceID, &deviceID_len, &captureGain, &playbackGain) == FAILURE)
 		return;
-	to_asciiz(&message, message_len);
-	unsigned int error = ts3client_requestSendPrivateTextMsg(serverConnectionHandlerID, message, targetClientID, NULL);
-	free(message);
-	RETURN_LONG(error);
+	if (!(captureGain >= 0 && captureGain <= CUSTOM_DEVICE_MAX_GAIN) || !(playbackGain >= 0 && playbackGain <= CUSTOM_DEVICE_MAX_GAIN))
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	struct CustomDevice *device = acquire_custom_device(deviceID);
+	if (device == NULL)
+		RETURN_LONG(ERROR_sound_unknown_device);
+	atomic_store(&device->capture_gain, (float)captureGain);
+	atomic_store(&device->playback_gain, (float)playbackGain);
+	release_custom_device(device);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestSendChannelTextMsg)
+TS3_FUNCTION(getTalkStats)
 {
 	zend_long serverConnectionHandlerID;
-	char* message; size_t message_len;
-	zend_long targetChannelID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lsl", &serverConnectionHandlerID, &message, &message_len, &targetChannelID) == FAILURE)
+	zend_bool reset;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lbz/", &serverConnectionHandlerID, &reset, &zresult) == FAILURE)
 		return;
-	to_asciiz(&message, message_len);
-	unsigned int error = ts3client_requestSendChannelTextMsg(serverConnectionHandlerID, message, targetChannelID, NULL);
-	free(message);
-	RETURN_LONG(error);
+
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	if (item == NULL)
+	{
+		unlock_mutex(&mutex);
+		RETURN_LONG(ERROR_invalid_server_connection_handler_id);
+	}
+	size_t count = 0;
+	struct TalkEntry *entries = malloc((item->talk.count ? item->talk.count : 1) * sizeof(struct TalkEntry));
+	for (size_t i = 0; i < item->talk.capacity; ++i)
+	{
+		struct TalkEntry *entry = &item->talk.entries[i];
+		if (entry->bursts + entry->talking == 0)
+			continue;
+		entries[count++] = *entry;
+		if (reset)
+		{
+			entry->bursts = entry->whisper_bursts = entry->milliseconds = entry->longest = 0;
+			memset(entry->histogram, 0, sizeof(entry->histogram));
+		}
+	}
+	if (reset && item->talk.capacity)
+		rehash_talk_table(&item->talk, item->talk.capacity);
+	unlock_mutex(&mutex);
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const struct TalkEntry *entry = &entries[i];
+		zval zentry, zhistogram;
+		array_init(&zentry);
+		array_init(&zhistogram);
+		for (int bucket = 0; bucket < TALK_HISTOGRAM_BUCKETS; ++bucket)
+			add_next_index_long(&zhistogram, entry->histogram[bucket]);
+		add_assoc_long(&zentry, "clientID", entry->clientID);
+		add_assoc_long(&zentry, "channelID", entry->channelID);
+		add_assoc_bool(&zentry, "talking", entry->talking);
+		add_assoc_long(&zentry, "bursts", entry->bursts);
+		add_assoc_long(&zentry, "whisperBursts", entry->whisper_bursts);
+		add_assoc_long(&zentry, "milliseconds", entry->milliseconds);
+		add_assoc_long(&zentry, "longest", entry->longest);
+		add_assoc_zval(&zentry, "histogram", &zhistogram);
+		add_next_index_zval(zresult, &zentry);
+	}
+	free(entries);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestSendServerTextMsg)
+/* Zero terminated copy of a list of IDs, or NULL for an empty list. */
+static uint64 *to_channel_list(HashTable *ids)
 {
-	zend_long serverConnectionHandlerID;
-	char* message; size_t message_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ls", &serverConnectionHandlerID, &message, &message_len) == FAILURE)
-		return;
-	to_asciiz(&message, message_len);
-	unsigned int error = ts3client_requestSendServerTextMsg(serverConnectionHandlerID, message, NULL);
-	free(message);
-	RETURN_LONG(error);
+	size_t count = zend_hash_num_elements(ids), i = 0;
+	if (count == 0)
+		return NULL;
+	uint64 *list = malloc((count + 1) * sizeof(uint64));
+	zval *zid;
+	ZEND_HASH_FOREACH_VAL(ids, zid)
+	{
+		list[i++] = zval_get_long(zid);
+	}
+	ZEND_HASH_FOREACH_END();
+	list[i] = 0;
+	return list;
+}
+
+static anyID *to_client_list(HashTable *ids)
+{
+	size_t count = zend_hash_num_elements(ids), i = 0;
+	if (count == 0)
+		return NULL;
+	anyID *list = malloc((count + 1) * sizeof(anyID));
+	zval *zid;
+	ZEND_HASH_FOREACH_VAL(ids, zid)
+	{
+		list[i++] = zval_get_long(zid);
+	}
+	ZEND_HASH_FOREACH_END();
+	list[i] = 0;
+	return list;
+}
+
+/* Reads the optional "channels" and "clients" lists of a whisper list specification. */
+static bool parse_whisper_list(HashTable *spec, uint64 **channels, anyID **clients)
+{
+	zval *zchannels = zend_hash_str_find(spec, "channels", sizeof("channels") - 1);
+	zval *zclients = zend_hash_str_find(spec, "clients", sizeof("clients") - 1);
+	if ((zchannels && Z_TYPE_P(zchannels) != IS_ARRAY) || (zclients && Z_TYPE_P(zclients) != IS_ARRAY))
+		return false;
+	*channels = zchannels ? to_channel_list(Z_ARRVAL_P(zchannels)) : NULL;
+	*clients = zclients ? to_client_list(Z_ARRVAL_P(zclients)) : NULL;
+	return true;
+}
+
+/* Takes ownership of both lists; a client without targets is removed from the cache. */
+static void cache_whisper_list(uint64_t serverConnectionHandlerID, anyID clientID, uint64 *channels, anyID *clients)
+{
+	struct ConnectionItem *item = get_connection_item(serverConnectionHandlerID);
+	lock_mutex(&mutex);
+	struct WhisperList **parent = &item->whisper_lists;
+	while (*parent != NULL && (*parent)->clientID != clientID)
+		parent = &(*parent)->next;
+
+	struct WhisperList *list = *parent;
+	if (list != NULL)
+	{
+		*parent = list->next;
+		free_whisper_list(list);
+	}
+	if (channels != NULL || clients != NULL)
+	{
+		list = malloc(sizeof(struct WhisperList));
+		list->clientID = clientID;
+		list->channels = channels;
+		list->clients = clients;
+		list->next = item->whisper_lists;
+		item->whisper_lists = list;
+	}
+	unlock_mutex(&mutex);
 }
 
-PHP_FUNCTION(ts3client_requestConnectionInfo)
+TS3_FUNCTION(requestClientSetWhisperList)
 {
 	zend_long serverConnectionHandlerID;
 	zend_long clientID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &clientID) == FAILURE)
+	HashTable *targetChannelIDs;
+	HashTable *targetClientIDs;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llhh", &serverConnectionHandlerID, &clientID, &targetChannelIDs, &targetClientIDs) == FAILURE)
 		return;
+	uint64 *channels = to_channel_list(targetChannelIDs);
+	anyID *clients = to_client_list(targetClientIDs);
+	throttle(serverConnectionHandlerID);
 	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestConnectionInfo(serverConnectionHandlerID, clientID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error))
+	unsigned int error = ts3client_requestClientSetWhisperList(serverConnectionHandlerID, clientID, channels, clients, item->return_code_text);
+	error = handle_return_code(item, error);
+	if (error == ERROR_ok)
+		cache_whisper_list(serverConnectionHandlerID, clientID, channels, clients);
+	else
+	{
+		free(channels);
+		free(clients);
+	}
+	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_getConnectionStatus)
+/*
+ * Sends the whisper lists of many clients without waiting in between. The
+ * lists are keyed by client ID, 0 being the own client, and every list that
+ * the server confirmed replaces the cached one.
+ */
+TS3_FUNCTION(requestClientSetWhisperListMany)
 {
 	zend_long serverConnectionHandlerID;
-	zval* zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+	HashTable *whisperLists;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lhz/", &serverConnectionHandlerID, &whisperLists, &zresult) == FAILURE)
 		return;
-	int result;
-	unsigned int error = ts3client_getConnectionStatus(serverConnectionHandlerID, &result);
-	if (error == ERROR_ok)
+
+	size_t count = zend_hash_num_elements(whisperLists), i = 0;
+	struct WaitItem **items = ecalloc(count, sizeof(*items));
+	unsigned int *errors = ecalloc(count, sizeof(*errors));
+	uint64 **channels = ecalloc(count, sizeof(*channels));
+	anyID **clients = ecalloc(count, sizeof(*clients));
+	zend_ulong clientID;
+	zend_string *key;
+	zval *spec;
+	ZEND_HASH_FOREACH_KEY_VAL(whisperLists, clientID, key, spec)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		if (key || Z_TYPE_P(spec) != IS_ARRAY || parse_whisper_list(Z_ARRVAL_P(spec), &channels[i], &clients[i]) == false)
+			errors[i] = ERROR_parameter_invalid;
+		else
+		{
+			throttle(serverConnectionHandlerID);
+			items[i] = create_return_code_item();
+			unsigned int error = ts3client_requestClientSetWhisperList(serverConnectionHandlerID, clientID, channels[i], clients[i], items[i]->return_code_text);
+			batch_sent(&items[i], &errors[i], error);
+		}
+		++i;
+	}
+	ZEND_HASH_FOREACH_END();
+
+	wait_for_all(items, errors, count);
+
+	unsigned int error = ERROR_ok;
+	zval_dtor(zresult);
+	array_init_size(zresult, count);
+	i = 0;
+	ZEND_HASH_FOREACH_KEY_VAL(whisperLists, clientID, key, spec)
+	{
+		(void)spec;
+		if (error == ERROR_ok)
+			error = errors[i];
+		if (key)
+			add_assoc_long_ex(zresult, ZSTR_VAL(key), ZSTR_LEN(key), errors[i]);
+		else
+			add_index_long(zresult, clientID, errors[i]);
+		if (errors[i] == ERROR_ok)
+			cache_whisper_list(serverConnectionHandlerID, clientID, channels[i], clients[i]);
+		else
+		{
+			free(channels[i]);
+			free(clients[i]);
+		}
+		++i;
 	}
+	ZEND_HASH_FOREACH_END();
+
+	efree(items);
+	efree(errors);
+	efree(channels);
+	efree(clients);
 	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_requestChannelSubscribeAll)
+TS3_FUNCTION(getWhisperList)
 {
 	zend_long serverConnectionHandlerID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+	zend_long clientID;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &clientID, &zresult) == FAILURE)
 		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestChannelSubscribeAll(serverConnectionHandlerID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error))
+
+	lock_mutex(&mutex);
+	struct ConnectionItem *item = find_connection_item(serverConnectionHandlerID);
+	if (item == NULL)
+	{
+		unlock_mutex(&mutex);
+		RETURN_LONG(ERROR_invalid_server_connection_handler_id);
+	}
+	zval zchannels, zclients;
+	array_init(&zchannels);
+	array_init(&zclients);
+	struct WhisperList *list = item->whisper_lists;
+	while (list != NULL && list->clientID != clientID)
+		list = list->next;
+	for (uint64 *channel = list ? list->channels : NULL; channel && *channel; ++channel)
+		add_next_index_long(&zchannels, *channel);
+	for (anyID *client = list ? list->clients : NULL; client && *client; ++client)
+		add_next_index_long(&zclients, *client);
+	unlock_mutex(&mutex);
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_zval(zresult, "channels", &zchannels);
+	add_assoc_zval(zresult, "clients", &zclients);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestChannelUnsubscribeAll)
+static void queue_transfer(INTERNAL_FUNCTION_PARAMETERS, bool upload)
 {
 	zend_long serverConnectionHandlerID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
+	zend_long channelID;
+	char* channelPassword; size_t channelPassword_len;
+	char* file;            size_t file_len;
+	char* directory;       size_t directory_len;
+	zend_bool overwrite;
+	zend_bool resume;
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llsspbbz/", &serverConnectionHandlerID, &channelID, &channelPassword, &channelPassword_len, &file, &file_len, &directory, &directory_len, &overwrite, &resume, &zresult) == FAILURE)
 		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_requestChannelUnsubscribeAll(serverConnectionHandlerID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error))
+
+	struct Transfer *transfer = calloc(1, sizeof(struct Transfer));
+	to_asciiz(&channelPassword, channelPassword_len);
+	to_asciiz(&file, file_len);
+	transfer->serverConnectionHandlerID = serverConnectionHandlerID;
+	transfer->channelID = channelID;
+	transfer->channel_password = channelPassword;
+	transfer->file = file;
+	transfer->directory = strdup(directory);
+	transfer->upload = upload;
+	transfer->overwrite = overwrite;
+	transfer->resume = resume;
+	const uint64_t id = add_transfer(transfer);
+	if (id == 0)
+		RETURN_LONG(ERROR_undefined);
+
+	zval_dtor(zresult);
+	ZVAL_LONG(zresult, id);
+	RETURN_LONG(ERROR_ok);
+}
+
+TS3_FUNCTION(queueUpload)
+{
+	queue_transfer(INTERNAL_FUNCTION_PARAM_PASSTHRU, true);
+}
+
+TS3_FUNCTION(queueDownload)
+{
+	queue_transfer(INTERNAL_FUNCTION_PARAM_PASSTHRU, false);
+}
+
+TS3_FUNCTION(cancelTransfer)
+{
+	zend_long transferID;
+	zend_bool deleteUnfinishedFile;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lb", &transferID, &deleteUnfinishedFile) == FAILURE)
+		return;
+	RETURN_LONG(cancel_transfer(transferID, deleteUnfinishedFile));
 }
 
-PHP_FUNCTION(ts3client_getClientID)
+/* Parallelism is enforced by the scheduler, the bandwidth caps by the client lib. */
+TS3_FUNCTION(setTransferLimits)
 {
 	zend_long serverConnectionHandlerID;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+	zend_long parallelism;
+	zend_long uploadLimit;
+	zend_long downloadLimit;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &parallelism, &uploadLimit, &downloadLimit) == FAILURE)
 		return;
-	anyID result;
-	unsigned int error = ts3client_getClientID(serverConnectionHandlerID, &result);
+	if (parallelism < 1 || uploadLimit < 0 || downloadLimit < 0)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	unsigned int error = ts3client_setServerConnectionHandlerSpeedLimitUp(serverConnectionHandlerID, uploadLimit);
 	if (error == ERROR_ok)
-	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
-	}
-	RETURN_LONG(error);
+		error = ts3client_setServerConnectionHandlerSpeedLimitDown(serverConnectionHandlerID, downloadLimit);
+	if (error != ERROR_ok)
+		RETURN_LONG(error);
+
+	lock_mutex(&transfers.lock);
+	get_transfer_connection(serverConnectionHandlerID)->parallelism = parallelism;
+	transfers.pending = true;
+	pthread_cond_signal(&transfers.wake);
+	unlock_mutex(&transfers.lock);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_getConnectionVariableAsUInt64)
+TS3_FUNCTION(getTransfers)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long flag;
+	zend_long serverConnectionHandlerID;
 	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
-        return;
-	uint64_t result;
-    unsigned int error = ts3client_getConnectionVariableAsUInt64(serverConnectionHandlerID, clientID, flag, &result);
-	if (error == ERROR_ok)
+	zend_bool removeEnded = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/|b", &serverConnectionHandlerID, &zresult, &removeEnded) == FAILURE)
+		return;
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	lock_mutex(&transfers.lock);
+	struct Transfer **parent = &transfers.transfers;
+	while (*parent != NULL)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		struct Transfer *transfer = *parent;
+		if (serverConnectionHandlerID != 0 && transfer->serverConnectionHandlerID != (uint64_t)serverConnectionHandlerID)
+		{
+			parent = &transfer->next;
+			continue;
+		}
+
+		zval ztransfer;
+		array_init(&ztransfer);
+		add_assoc_long(&ztransfer, "serverConnectionHandlerID", transfer->serverConnectionHandlerID);
+		add_assoc_long(&ztransfer, "channelID", transfer->channelID);
+		add_assoc_string(&ztransfer, "file", transfer->file);
+		add_assoc_bool(&ztransfer, "upload", transfer->upload);
+		add_assoc_long(&ztransfer, "state", transfer->state);
+		add_assoc_long(&ztransfer, "error", transfer->error);
+		add_assoc_long(&ztransfer, "size", transfer->size);
+		add_assoc_long(&ztransfer, "done", transfer->done);
+		add_assoc_double(&ztransfer, "speed", transfer->speed);
+		add_index_zval(zresult, transfer->id, &ztransfer);
+
+		if (removeEnded && transfer->state >= TRANSFER_DONE)
+		{
+			*parent = transfer->next;
+			free_transfer(transfer);
+		}
+		else
+			parent = &transfer->next;
 	}
-    RETURN_LONG(error);
+	unlock_mutex(&transfers.lock);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_getConnectionVariableAsDouble)
+static void add_histogram_summary(zval *zstats, const char *prefix, const struct HistogramSummary *summary)
+{
+	char key[32];
+	snprintf(key, sizeof(key), "%scount", prefix);
+	add_assoc_long(zstats, key, summary->count);
+	snprintf(key, sizeof(key), "%smean", prefix);
+	add_assoc_double(zstats, key, summary->count ? (double)summary->sum / summary->count : 0.0);
+	snprintf(key, sizeof(key), "%sp50", prefix);
+	add_assoc_long(zstats, key, summary->p50);
+	snprintf(key, sizeof(key), "%sp99", prefix);
+	add_assoc_long(zstats, key, summary->p99);
+	snprintf(key, sizeof(key), "%sp999", prefix);
+	add_assoc_long(zstats, key, summary->p999);
+	snprintf(key, sizeof(key), "%smax", prefix);
+	add_assoc_long(zstats, key, summary->max);
+}
+
+TS3_FUNCTION(getStats)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long flag;
 	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
-        return;
-	double result;
-    unsigned int error = ts3client_getConnectionVariableAsDouble(serverConnectionHandlerID, clientID, flag, &result);
-	if (error == ERROR_ok)
+	zend_bool reset = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/|b", &zresult, &reset) == FAILURE)
+		return;
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	struct FunctionSummary *summary = malloc(sizeof(struct FunctionSummary));
+	pthread_mutex_lock(&stats.lock);
+	const int count = atomic_load(&stats.function_count);
+	for (int function = 0; function < count; ++function)
 	{
-		zval_dtor(zresult);
-		ZVAL_DOUBLE(zresult, result);
+		summarize_function(function, summary, reset);
+		if (summary->calls.count == 0 && summary->waits.count == 0)
+			continue;
+
+		zval zstats, zerrors;
+		array_init(&zstats);
+		array_init(&zerrors);
+		add_histogram_summary(&zstats, "", &summary->calls);
+		add_histogram_summary(&zstats, "wait_", &summary->waits);
+		add_assoc_long(&zstats, "timeouts", summary->timeouts);
+		for (size_t i = 0; i < summary->error_count; ++i)
+		{
+			if (summary->error_counts[i] > 0)
+				add_index_long(&zerrors, summary->error_codes[i], summary->error_counts[i]);
+		}
+		add_assoc_zval(&zstats, "errors", &zerrors);
+		add_assoc_long(&zstats, "other_errors", summary->other_errors);
+		add_assoc_zval(zresult, stats.functions[function], &zstats);
 	}
-    RETURN_LONG(error);
+	pthread_mutex_unlock(&stats.lock);
+	free(summary);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_getConnectionVariableAsString)
+TS3_FUNCTION(getLockStats)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long flag;
 	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
-        return;
-	char* result;
-    unsigned int error = ts3client_getConnectionVariableAsString(serverConnectionHandlerID, clientID, flag, &result);
-	if (error == ERROR_ok)
+	zend_bool reset = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/|b", &zresult, &reset) == FAILURE)
+		return;
+
+	zval zlocks, zcallbacks;
+	zval_dtor(zresult);
+	array_init(zresult);
+	array_init(&zlocks);
+	array_init(&zcallbacks);
+	struct HistogramSummary *summary = malloc(sizeof(struct HistogramSummary));
+	for (size_t i = 0; i < sizeof(lock_profiles) / sizeof(*lock_profiles); ++i)
 	{
-		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
-		ts3client_freeMemory(result);
+		struct LockProfile *profile = &lock_profiles[i];
+		const char *worst_wait_by = atomic_load(&profile->worst_wait_by);
+		const char *worst_hold_by = atomic_load(&profile->worst_hold_by);
+		zval zlock;
+		array_init(&zlock);
+		add_assoc_long(&zlock, "contended", atomic_load(&profile->contended));
+		summarize_histogram(&profile->wait, summary, reset);
+		add_histogram_summary(&zlock, "wait_", summary);
+		summarize_histogram(&profile->hold, summary, reset);
+		add_histogram_summary(&zlock, "hold_", summary);
+		add_assoc_long(&zlock, "worst_wait_at", atomic_load(&profile->worst_wait_at));
+		add_assoc_string(&zlock, "worst_wait_by", worst_wait_by != NULL ? worst_wait_by : "");
+		add_assoc_long(&zlock, "worst_hold_at", atomic_load(&profile->worst_hold_at));
+		add_assoc_string(&zlock, "worst_hold_by", worst_hold_by != NULL ? worst_hold_by : "");
+		add_assoc_zval(&zlocks, profile->name, &zlock);
+		if (reset)
+			atomic_store(&profile->contended, 0);
 	}
-    RETURN_LONG(error);
+	for (struct CallbackProfile *profile = atomic_load(&callback_profiles); profile != NULL; profile = profile->next)
+	{
+		zval zcallback;
+		array_init(&zcallback);
+		summarize_histogram(&profile->duration, summary, reset);
+		add_histogram_summary(&zcallback, "", summary);
+		summarize_histogram(&profile->lock_wait, summary, reset);
+		add_histogram_summary(&zcallback, "lock_wait_", summary);
+		add_assoc_long(&zcallback, "worst_at", atomic_load(&profile->worst_at));
+		add_assoc_zval(&zcallbacks, profile->name, &zcallback);
+	}
+	free(summary);
+
+	add_assoc_bool(zresult, "enabled", atomic_load(&lock_profiling));
+	add_assoc_zval(zresult, "locks", &zlocks);
+	add_assoc_zval(zresult, "callbacks", &zcallbacks);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_cleanUpConnectionInfo)
+TS3_FUNCTION(getLogStatus)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long clientID;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &clientID) == FAILURE)
-        return;
-    unsigned int error = ts3client_cleanUpConnectionInfo(serverConnectionHandlerID, clientID);
-    RETURN_LONG(error);
+	zval *zresult;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
+		return;
+
+	const unsigned long long written = atomic_load(&logs.written);
+	const size_t head = atomic_load(&logs.head);
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_bool(zresult, "enabled", logs.writer.running);
+	add_assoc_string(zresult, "file", logs.file);
+	add_assoc_long(zresult, "written", written);
+	add_assoc_long(zresult, "dropped", atomic_load(&logs.dropped));
+	add_assoc_long(zresult, "queued", head > written ? head - written : 0);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_requestServerConnectionInfo)
+/* Upper bounds of the request wait histogram in seconds, without +Inf. */
+static const double metrics_wait_buckets[] = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+
+static void metric_family(smart_str *out, const char *name, const char *type, const char *help)
 {
-    zend_long serverConnectionHandlerID;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
-        return;
-	struct WaitItem* item = create_return_code_item();
-    unsigned int error = ts3client_requestServerConnectionInfo(serverConnectionHandlerID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error))
+	smart_str_append_printf(out, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
 }
 
-PHP_FUNCTION(ts3client_getServerConnectionVariableAsUInt64)
+/* Waits of all functions; Prometheus buckets are accurate to the 1/16 of the native histogram. The caller must hold stats.lock. */
+static void render_wait_metrics(smart_str *out)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-        return;
-	uint64_t result;
-    unsigned int error = ts3client_getServerConnectionVariableAsUInt64(serverConnectionHandlerID, flag, &result);
-	if (error != ERROR_ok)
+	uint64_t *buckets = calloc(STATS_BUCKETS, sizeof(uint64_t));
+	uint64_t count = 0, sum = 0, max = 0, timeouts = 0;
+	const int functions = atomic_load(&stats.function_count);
+	FOREACH_STATS_SHARD(shard)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		for (int function = 0; function < functions; ++function)
+		{
+			struct FunctionStats *function_stats = atomic_load_explicit(&shard->functions[function], memory_order_acquire);
+			if (function_stats == NULL)
+				continue;
+			sum_histogram(&function_stats->waits, buckets, &count, &sum, &max);
+			timeouts += atomic_load_explicit(&function_stats->timeouts, memory_order_relaxed);
+		}
 	}
-    RETURN_LONG(error);
+
+	metric_family(out, "ts3client_request_wait_seconds", "histogram", "Time spent waiting for the server to answer requests.");
+	uint64_t cumulative = 0;
+	unsigned int bucket = 0;
+	for (size_t i = 0; i < sizeof(metrics_wait_buckets) / sizeof(*metrics_wait_buckets); ++i)
+	{
+		const uint64_t bound = (uint64_t)(metrics_wait_buckets[i] * 1000000);
+		for (; bucket < STATS_BUCKETS && stats_bucket_value(bucket) <= bound; ++bucket)
+			cumulative += buckets[bucket];
+		smart_str_append_printf(out, "ts3client_request_wait_seconds_bucket{le=\"%g\"} %llu\n", metrics_wait_buckets[i], (unsigned long long)cumulative);
+	}
+	/* The count read next to the buckets can be ahead of them while waits are recorded, so +Inf comes from the buckets as well. */
+	for (; bucket < STATS_BUCKETS; ++bucket)
+		cumulative += buckets[bucket];
+	smart_str_append_printf(out, "ts3client_request_wait_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+	smart_str_append_printf(out, "ts3client_request_wait_seconds_count %llu\n", (unsigned long long)cumulative);
+	smart_str_append_printf(out, "ts3client_request_wait_seconds_sum %.6f\n", sum / 1e6);
+	metric_family(out, "ts3client_request_timeouts", "counter", "Requests the server did not answer within ts3client.timeout.");
+	smart_str_append_printf(out, "ts3client_request_timeouts_total %llu\n", (unsigned long long)timeouts);
+	free(buckets);
 }
 
-PHP_FUNCTION(ts3client_getServerConnectionVariableAsFloat)
+static void render_connection_metrics(smart_str *out)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-        return;
-	float result;
-    unsigned int error = ts3client_getServerConnectionVariableAsFloat(serverConnectionHandlerID, flag, &result);
-	if (error != ERROR_ok)
+	static const struct
 	{
-		zval_dtor(zresult);
-		ZVAL_DOUBLE(zresult, result);
+		const char *name;
+		size_t flag;
+		const char *help;
+	} traffic[] = {
+		{ "ts3client_connection_sent_bytes", CONNECTION_BYTES_SENT_TOTAL, "Bytes sent to the server." },
+		{ "ts3client_connection_received_bytes", CONNECTION_BYTES_RECEIVED_TOTAL, "Bytes received from the server." },
+		{ "ts3client_connection_sent_packets", CONNECTION_PACKETS_SENT_TOTAL, "Packets sent to the server." },
+		{ "ts3client_connection_received_packets", CONNECTION_PACKETS_RECEIVED_TOTAL, "Packets received from the server." },
+	};
+	uint64 *handlers;
+	if (ts3client_getServerConnectionHandlerList(&handlers) != ERROR_ok)
+		return;
+
+	metric_family(out, "ts3client_connection_status", "gauge", "Connect status of a server connection handler, 0 (disconnected) to 4 (connection established).");
+	for (uint64 *handler = handlers; *handler != 0; ++handler)
+	{
+		int status = STATUS_DISCONNECTED;
+		ts3client_getConnectionStatus(*handler, &status);
+		smart_str_append_printf(out, "ts3client_connection_status{handler=\"%llu\"} %d\n", (unsigned long long)*handler, status);
 	}
-    RETURN_LONG(error);
+	metric_family(out, "ts3client_connection_reconnects", "counter", "Connections a server connection handler established after its first one.");
+	for (uint64 *handler = handlers; *handler != 0; ++handler)
+	{
+		lock_mutex(&mutex);
+		const struct ConnectionItem *item = find_connection_item(*handler);
+		const unsigned int established = item != NULL ? atomic_load(&item->established) : 0;
+		unlock_mutex(&mutex);
+		smart_str_append_printf(out, "ts3client_connection_reconnects_total{handler=\"%llu\"} %u\n", (unsigned long long)*handler, established > 1 ? established - 1 : 0);
+	}
+	for (size_t i = 0; i < sizeof(traffic) / sizeof(*traffic); ++i)
+	{
+		metric_family(out, traffic[i].name, "counter", traffic[i].help);
+		for (uint64 *handler = handlers; *handler != 0; ++handler)
+		{
+			uint64 value;
+			if (ts3client_getServerConnectionVariableAsUInt64(*handler, traffic[i].flag, &value) == ERROR_ok)
+				smart_str_append_printf(out, "%s_total{handler=\"%llu\"} %llu\n", traffic[i].name, (unsigned long long)*handler, (unsigned long long)value);
+		}
+	}
+	ts3client_freeMemory(handlers);
 }
 
-PHP_FUNCTION(ts3client_getClientSelfVariableAsInt)
+TS3_FUNCTION(metrics)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long flag;
 	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-        return;
-	int result;
-    unsigned int error = ts3client_getClientSelfVariableAsInt(serverConnectionHandlerID, flag, &result);
-	if (error != ERROR_ok)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "z/", &zresult) == FAILURE)
+		return;
+
+	size_t pending = 0;
+	lock_mutex(&mutex);
+	for (size_t i = 0; i < WAIT_ITEM_BUCKETS; ++i)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		for (struct WaitItem *item = wait_items[i]; item != NULL; item = item->next)
+			++pending;
 	}
-    RETURN_LONG(error);
+	unlock_mutex(&mutex);
+	const size_t enqueued = atomic_load(&submissions.enqueue_position);
+	const size_t dequeued = atomic_load(&submissions.dequeue_position);
+
+	smart_str out = {0};
+	metric_family(&out, "ts3client_pending_requests", "gauge", "Requests sent to the server that were not answered yet.");
+	smart_str_append_printf(&out, "ts3client_pending_requests %zu\n", pending);
+	metric_family(&out, "ts3client_submission_queue_depth", "gauge", "Submissions waiting for the I/O worker.");
+	smart_str_append_printf(&out, "ts3client_submission_queue_depth %zu\n", enqueued > dequeued ? enqueued - dequeued : 0);
+	metric_family(&out, "ts3client_submissions_rejected", "counter", "Submissions rejected because the queue was full.");
+	smart_str_append_printf(&out, "ts3client_submissions_rejected_total %llu\n", (unsigned long long)atomic_load(&submissions.rejected));
+	metric_family(&out, "ts3client_log_messages_dropped", "counter", "Client lib log messages dropped because the log ring was full.");
+	smart_str_append_printf(&out, "ts3client_log_messages_dropped_total %llu\n", (unsigned long long)atomic_load(&logs.dropped));
+	render_connection_metrics(&out);
+	pthread_mutex_lock(&stats.lock);
+	render_wait_metrics(&out);
+	pthread_mutex_unlock(&stats.lock);
+	smart_str_appends(&out, "# EOF\n");
+	smart_str_0(&out);
+
+	zval_dtor(zresult);
+	ZVAL_STR(zresult, out.s);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_getClientSelfVariableAsString)
+/* Copies the trace ring, leaving out slots that were overwritten while they were copied. */
+static size_t snapshot_trace(struct TraceEvent *events)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zval *zresult;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-        return;
-	char *result;
-    unsigned int error = ts3client_getClientSelfVariableAsString(serverConnectionHandlerID, flag, &result);
-	if (error != ERROR_ok)
+	size_t count = 0;
+	for (size_t i = 0; i < TRACE_RING_EVENTS; ++i)
 	{
-		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
-		ts3client_freeMemory(result);
+		const struct TraceEvent *slot = &trace_events[i];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence == 0)
+			continue;
+		struct TraceEvent *event = &events[count];
+		event->time = slot->time;
+		event->activity = slot->activity;
+		event->return_code = slot->return_code;
+		event->error = slot->error;
+		event->thread = slot->thread;
+		event->phase = slot->phase;
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence)
+			++count;
 	}
-    RETURN_LONG(error);
+	return count;
 }
 
-PHP_FUNCTION(ts3client_setClientSelfVariableAsInt)
+/*
+ * Orders events by request and then by phase. A request is only recorded as
+ * issued once the client lib returned, which can be after its answer arrived
+ * on the callback thread, so the phase is more reliable than the time.
+ */
+static int compare_trace_events(const void *left, const void *right)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zend_long value;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lll", &serverConnectionHandlerID, flag, value) == FAILURE)
-        return;
-    unsigned int error = ts3client_setClientSelfVariableAsInt(serverConnectionHandlerID, flag, value);
-    RETURN_LONG(error);
+	const struct TraceEvent *a = left, *b = right;
+	if (a->return_code != b->return_code)
+		return a->return_code < b->return_code ? -1 : 1;
+	if (a->phase != b->phase)
+		return a->phase < b->phase ? -1 : 1;
+	return (a->time > b->time) - (a->time < b->time);
 }
 
-PHP_FUNCTION(ts3client_setClientSelfVariableAsString)
+static void append_trace_event(smart_str *out, const char *name, char phase, unsigned int return_code, long long time, pid_t thread, const char *args)
 {
-    zend_long serverConnectionHandlerID;
-	zend_long flag;
-	char* value; size_t value_len;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "lls", &serverConnectionHandlerID, &flag, &value, &value_len) == FAILURE)
-        return;
-	to_asciiz(&value, value_len);
-    unsigned int error = ts3client_setClientSelfVariableAsString(serverConnectionHandlerID, flag, value);
-	free(value);
-    RETURN_LONG(error);
+	smart_str_append_printf(out, "{\"name\":\"%s\",\"cat\":\"ts3client\",\"ph\":\"%c\",\"id\":%u,\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d",
+		name, phase, return_code, time / 1000, time % 1000, (int)getpid(), (int)thread);
+	if (args != NULL)
+		smart_str_append_printf(out, ",\"args\":%s", args);
+	smart_str_appends(out, "},\n");
 }
 
-PHP_FUNCTION(ts3client_flushClientSelfUpdates)
+/*
+ * Renders every request as an async slice named after the function that sent
+ * it, with the nested slices "send" until the client lib accepted it,
+ * "server" until its answer arrived and "wake" until the waiting thread ran
+ * again. The answer is also marked on the thread that delivered it. Requests
+ * whose start was already overwritten are left out and requests still in
+ * flight end at the time of the dump.
+ */
+static void render_trace(smart_str *out, const struct TraceEvent *events, size_t count, long long now)
 {
-    zend_long serverConnectionHandlerID;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
-        return;
-	struct WaitItem* item = create_return_code_item();
-    unsigned int error = ts3client_flushClientSelfUpdates(serverConnectionHandlerID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error))
+	static const char *spans[] = { [TRACE_ALLOCATED] = "send", [TRACE_ISSUED] = "server", [TRACE_ANSWERED] = "wake" };
+	pid_t callback_threads[8];
+	size_t callback_thread_count = 0;
+	char args[64];
+
+	smart_str_appends(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (size_t start = 0, end; start < count; start = end)
+	{
+		for (end = start + 1; end < count && events[end].return_code == events[start].return_code; ++end);
+		const struct TraceEvent *first = &events[start];
+		if (first->phase != TRACE_ALLOCATED)
+			continue;
+
+		const char *name = first->activity != NULL ? first->activity : "native";
+		const char *open = NULL;
+		long long time = first->time;
+		bool finished = false;
+		append_trace_event(out, name, 'b', first->return_code, time, first->thread, NULL);
+		for (size_t i = start; i < end; ++i)
+		{
+			const struct TraceEvent *event = &events[i];
+			time = event->time > time ? event->time : time;
+			if (open != NULL)
+				append_trace_event(out, open, 'e', event->return_code, time, event->thread, NULL);
+			finished = event->phase == TRACE_WOKEN || event->phase == TRACE_TIMED_OUT || (event->phase == TRACE_ISSUED && event->error != ERROR_ok);
+			if (finished)
+			{
+				snprintf(args, sizeof(args), "{\"error\":%u,\"timed_out\":%s}", event->error, event->phase == TRACE_TIMED_OUT ? "true" : "false");
+				append_trace_event(out, name, 'e', event->return_code, time, event->thread, args);
+				break;
+			}
+			open = spans[event->phase];
+			append_trace_event(out, open, 'b', event->return_code, time, event->thread, NULL);
+			if (event->phase == TRACE_ANSWERED)
+			{
+				snprintf(args, sizeof(args), "{\"return_code\":%u,\"error\":%u}", event->return_code, event->error);
+				smart_str_append_printf(out, "{\"name\":\"answer\",\"cat\":\"ts3client\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d,\"args\":%s},\n",
+					time / 1000, time % 1000, (int)getpid(), (int)event->thread, args);
+				size_t known = 0;
+				while (known < callback_thread_count && callback_threads[known] != event->thread)
+					++known;
+				if (known == callback_thread_count && callback_thread_count < sizeof(callback_threads) / sizeof(*callback_threads))
+					callback_threads[callback_thread_count++] = event->thread;
+			}
+		}
+		if (finished == false)
+		{
+			time = now > time ? now : time;
+			append_trace_event(out, open, 'e', first->return_code, time, first->thread, NULL);
+			append_trace_event(out, name, 'e', first->return_code, time, first->thread, "{\"in_flight\":true}");
+		}
+	}
+	for (size_t i = 0; i < callback_thread_count; ++i)
+		smart_str_append_printf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"client lib callbacks\"}},\n", (int)getpid(), (int)callback_threads[i]);
+	smart_str_append_printf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"php %d\"}}\n]}\n", (int)getpid(), (int)getpid());
+	smart_str_0(out);
 }
 
-PHP_FUNCTION(ts3client_getClientVariableAsInt)
+TS3_FUNCTION(dumpTrace)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+	char* path; size_t path_len;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "p", &path, &path_len) == FAILURE)
 		return;
-	int result;
-	unsigned int error = ts3client_getClientVariableAsInt(serverConnectionHandlerID, clientID, flag, &result);
-	if (error == ERROR_ok)
-	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
-	}
-	RETURN_LONG(error);
+	if (atomic_load(&tracing) == false)
+		RETURN_LONG(ERROR_currently_not_possible);
+
+	struct TraceEvent *events = malloc(sizeof(struct TraceEvent) * TRACE_RING_EVENTS);
+	size_t count = snapshot_trace(events);
+	qsort(events, count, sizeof(struct TraceEvent), compare_trace_events);
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	smart_str out = {0};
+	render_trace(&out, events, count, now.tv_sec * 1000000000LL + now.tv_nsec);
+	free(events);
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	bool written = fd >= 0 && write_fully(fd, ZSTR_VAL(out.s), ZSTR_LEN(out.s));
+	if (fd >= 0 && close(fd) != 0)
+		written = false;
+	smart_str_free(&out);
+	RETURN_LONG(written ? ERROR_ok : ERROR_file_io_error);
 }
 
-PHP_FUNCTION(ts3client_getClientVariableAsUInt64)
+TS3_FUNCTION(startQualitySampler)
 {
 	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+	zend_long interval = QUALITY_DEFAULT_INTERVAL_MS;
+	zend_long capacity = QUALITY_DEFAULT_CAPACITY;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l|ll", &serverConnectionHandlerID, &interval, &capacity) == FAILURE)
 		return;
-	uint64_t result;
-	unsigned int error = ts3client_getClientVariableAsUInt64(serverConnectionHandlerID, clientID, flag, &result);
-	if (error == ERROR_ok)
+	if (interval < QUALITY_MINIMUM_INTERVAL_MS || capacity < 1 || capacity > QUALITY_MAXIMUM_CAPACITY)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	lock_mutex(&quality.lock);
+	if (start_quality_sampler() == false)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		unlock_mutex(&quality.lock);
+		RETURN_LONG(ERROR_undefined);
 	}
-	RETURN_LONG(error);
+	struct QualitySeries *series = find_quality_series(serverConnectionHandlerID);
+	if (series == NULL)
+	{
+		series = calloc(1, sizeof(struct QualitySeries));
+		series->serverConnectionHandlerID = serverConnectionHandlerID;
+		series->next = quality.series;
+		quality.series = series;
+	}
+	if (series->capacity != (size_t)capacity)
+	{
+		free(series->points);
+		series->points = calloc(capacity, sizeof(struct QualityPoint));
+		series->capacity = capacity;
+		series->count = 0;
+		series->head = 0;
+	}
+	series->interval = interval;
+	clock_gettime(CLOCK_MONOTONIC, &series->due);
+	pthread_cond_signal(&quality.wake);
+	unlock_mutex(&quality.lock);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_getClientVariableAsString)
+TS3_FUNCTION(stopQualitySampler)
 {
 	zend_long serverConnectionHandlerID;
-	zend_long clientID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &clientID, &flag, &zresult) == FAILURE)
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
 		return;
-	char *result;
-	unsigned int error = ts3client_getClientVariableAsString(serverConnectionHandlerID, clientID, flag, &result);
-	if (error == ERROR_ok)
+
+	lock_mutex(&quality.lock);
+	const bool removed = remove_quality_series(serverConnectionHandlerID);
+	unlock_mutex(&quality.lock);
+	RETURN_LONG(removed ? ERROR_ok : ERROR_parameter_invalid);
+}
+
+static const struct
+{
+	const char *name;
+	size_t offset;
+} quality_fields[] = {
+	{ "ping", offsetof(struct QualityPoint, ping) },
+	{ "ping_deviation", offsetof(struct QualityPoint, ping_deviation) },
+	{ "packetloss", offsetof(struct QualityPoint, packetloss) },
+	{ "packetloss_speech", offsetof(struct QualityPoint, packetloss_speech) },
+	{ "bandwidth_sent", offsetof(struct QualityPoint, bandwidth_sent) },
+	{ "bandwidth_received", offsetof(struct QualityPoint, bandwidth_received) },
+	{ "packets_sent", offsetof(struct QualityPoint, packets_sent) },
+	{ "packets_received", offsetof(struct QualityPoint, packets_received) },
+};
+
+static double quality_value(const struct QualityPoint *point, size_t field)
+{
+	return *(const double *)((const char *)point + quality_fields[field].offset);
+}
+
+/* Adds min, avg and max of every value for each bucket of consecutive samples. */
+static void add_quality_buckets(zval *zpoints, const struct QualityPoint *points, size_t count, zend_long bucket)
+{
+	for (size_t start = 0, end; start < count; start = end)
 	{
-		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
-		ts3client_freeMemory(result);
+		const long long bucket_start = points[start].time - points[start].time % bucket;
+		for (end = start + 1; end < count && points[end].time >= bucket_start && points[end].time < bucket_start + bucket; ++end);
+
+		zval zbucket;
+		array_init(&zbucket);
+		add_assoc_long(&zbucket, "time", bucket_start);
+		add_assoc_long(&zbucket, "samples", end - start);
+		for (size_t field = 0; field < sizeof(quality_fields) / sizeof(*quality_fields); ++field)
+		{
+			double min = quality_value(&points[start], field), max = min, sum = 0;
+			for (size_t i = start; i < end; ++i)
+			{
+				const double value = quality_value(&points[i], field);
+				min = value < min ? value : min;
+				max = value > max ? value : max;
+				sum += value;
+			}
+			zval zvalue;
+			array_init(&zvalue);
+			add_assoc_double(&zvalue, "min", min);
+			add_assoc_double(&zvalue, "avg", sum / (end - start));
+			add_assoc_double(&zvalue, "max", max);
+			add_assoc_zval(&zbucket, quality_fields[field].name, &zvalue);
+		}
+		add_next_index_zval(zpoints, &zbucket);
 	}
-	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_getClientList)
+TS3_FUNCTION(getQualitySamples)
 {
 	zend_long serverConnectionHandlerID;
 	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
+	zend_long since = 0;
+	zend_long bucket = 0;
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/|ll", &serverConnectionHandlerID, &zresult, &since, &bucket) == FAILURE)
 		return;
-	anyID* result;
-	unsigned int error = ts3client_getClientList(serverConnectionHandlerID, &result);
-	if (error == ERROR_ok)
+	if (bucket < 0)
+		RETURN_LONG(ERROR_parameter_invalid);
+
+	lock_mutex(&quality.lock);
+	struct QualitySeries *series = find_quality_series(serverConnectionHandlerID);
+	if (series == NULL)
 	{
-		zval_dtor(zresult);
-		array_init(zresult);
-		for  (anyID* p = result; *p; ++p)
+		unlock_mutex(&quality.lock);
+		RETURN_LONG(ERROR_parameter_invalid);
+	}
+	struct QualityPoint *points = malloc((series->count ? series->count : 1) * sizeof(struct QualityPoint));
+	size_t count = 0;
+	for (size_t i = 0; i < series->count; ++i)
+	{
+		const struct QualityPoint *point = &series->points[(series->head + series->capacity - series->count + i) % series->capacity];
+		if (point->time >= since)
+			points[count++] = *point;
+	}
+	const long long interval = series->interval;
+	const size_t capacity = series->capacity;
+	const unsigned long long failed = series->failed;
+	const unsigned int last_error = series->last_error;
+	unlock_mutex(&quality.lock);
+
+	zval zpoints;
+	array_init(&zpoints);
+	if (bucket > 0)
+		add_quality_buckets(&zpoints, points, count, bucket);
+	else
+	{
+		for (size_t i = 0; i < count; ++i)
 		{
-			add_next_index_long(zresult, *p);
+			zval zpoint;
+			array_init(&zpoint);
+			add_assoc_long(&zpoint, "time", points[i].time);
+			for (size_t field = 0; field < sizeof(quality_fields) / sizeof(*quality_fields); ++field)
+				add_assoc_double(&zpoint, quality_fields[field].name, quality_value(&points[i], field));
+			add_next_index_zval(&zpoints, &zpoint);
 		}
-		ts3client_freeMemory(result);
 	}
-	RETURN_LONG(error);
+	free(points);
+
+	zval_dtor(zresult);
+	array_init(zresult);
+	add_assoc_long(zresult, "interval", interval);
+	add_assoc_long(zresult, "capacity", capacity);
+	add_assoc_long(zresult, "failed", failed);
+	add_assoc_long(zresult, "last_error", last_error);
+	add_assoc_zval(zresult, "points", &zpoints);
+	RETURN_LONG(ERROR_ok);
 }
 
-PHP_FUNCTION(ts3client_getChannelOfClient)
+/*
+ * ts3file://<serverConnectionHandlerID>/<channelID>/<path> streams channel
+ * files through the transfer manager. The client lib only transfers to and
+ * from local files, so every stream owns a private temporary directory:
+ * downloads are read while the client lib is still writing them, uploads are
+ * spooled and sent when the stream is closed. A channel password can be
+ * passed as the "password" option of the "ts3file" stream context.
+ */
+struct FileUrl
 {
-	zend_long serverConnectionHandlerID = 25;
-	zend_long clientID;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &clientID, &zresult) == FAILURE)
-		return;
-	uint64_t result;
-	unsigned int error = ts3client_getChannelOfClient(serverConnectionHandlerID, clientID, &result);
-	if (error == ERROR_ok)
-	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
-	}
-	RETURN_LONG(error);
+	uint64_t serverConnectionHandlerID;
+	uint64_t channelID;
+	const char *path;
+};
+
+struct FileStream
+{
+	uint64_t transfer;
+	bool upload;
+	bool overwrite;
+	int fd;
+	enum TransferState ended;
+	unsigned int error;
+	uint64_t done;
+	long long progressed;
+	long long timeout;
+	struct FileUrl url;
+	char *file;
+	char *channel_password;
+	char directory[PATH_MAX];
+	char local[PATH_MAX];
+};
+
+static bool parse_file_url(const char *url, struct FileUrl *result)
+{
+	if (strncasecmp(url, "ts3file://", sizeof("ts3file://") - 1) != 0)
+		return false;
+	const char *handler = url + sizeof("ts3file://") - 1;
+	char *end;
+	result->serverConnectionHandlerID = strtoull(handler, &end, 10);
+	if (end == handler || *end != '/')
+		return false;
+	const char *channel = end + 1;
+	result->channelID = strtoull(channel, &end, 10);
+	if (end == channel || (*end != '/' && *end != '\0'))
+		return false;
+	result->path = *end == '/' ? end : "/";
+	return true;
 }
 
-PHP_FUNCTION(ts3client_getChannelVariableAsInt)
+static const char *file_url_password(php_stream_context *context)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &channelID, &flag, &zresult) == FAILURE)
-		return;
-	int result;
-	unsigned int error = ts3client_getChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, &result);
-	if (error == ERROR_ok)
-	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
-	}
-	RETURN_LONG(error);
+	zval *password = context != NULL ? php_stream_context_get_option(context, "ts3file", "password") : NULL;
+	return password != NULL && Z_TYPE_P(password) == IS_STRING ? Z_STRVAL_P(password) : "";
 }
 
-PHP_FUNCTION(ts3client_getChannelVariableAsUInt64)
+static unsigned int request_file_listing(const struct FileUrl *url, const char *channel_password, const char *path, struct FileListing **listing)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &channelID, &flag, &zresult) == FAILURE)
-		return;
-	uint64_t result;
-	unsigned int error = ts3client_getChannelVariableAsUInt64(serverConnectionHandlerID, channelID, flag, &result);
-	if (error == ERROR_ok)
+	throttle(url->serverConnectionHandlerID);
+	struct WaitItem *item = create_return_code_item();
+	unsigned int error = ts3client_requestFileList(url->serverConnectionHandlerID, url->channelID, channel_password, path, item->return_code_text);
+	batch_sent(&item, &error, error);
+	wait_for_items(&item, &error, 1);
+	*listing = NULL;
+	if (item != NULL)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		*listing = item->listing;
+		item->listing = NULL;
+		free_items(&item, 1);
 	}
-	RETURN_LONG(error);
+	if (error == ERROR_database_empty_result)
+		error = ERROR_ok;
+	if (error != ERROR_ok)
+	{
+		free_file_listing(*listing);
+		*listing = NULL;
+	}
+	else if (*listing == NULL)
+		*listing = calloc(1, sizeof(struct FileListing));
+	return error;
 }
 
-PHP_FUNCTION(ts3client_getChannelVariableAsString)
+/* Waits for the transfer of a stream to end or make progress and fails it once it made none for the configured timeout. */
+static void await_file_transfer(struct FileStream *stream, long milliseconds)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lllz/", &serverConnectionHandlerID, &channelID, &flag, &zresult) == FAILURE)
-		return;
-	char *result;
-	unsigned int error = ts3client_getChannelVariableAsString(serverConnectionHandlerID, channelID, flag, &result);
-	if (error == ERROR_ok)
+	uint64_t size, done = 0;
+	unsigned int error = ERROR_file_invalid_transfer_id;
+	enum TransferState state = get_transfer_progress(stream->transfer, milliseconds, &size, &done, &error);
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (state == 0 || state >= TRANSFER_DONE)
 	{
-		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
-		ts3client_freeMemory(result);
+		stream->ended = state == 0 ? TRANSFER_FAILED : state;
+		stream->error = error;
+	}
+	else if (done != stream->done)
+	{
+		stream->done = done;
+		stream->progressed = monotonic_ms(&now);
+	}
+	else if (monotonic_ms(&now) - stream->progressed > stream->timeout)
+	{
+		cancel_transfer(stream->transfer, true);
+		stream->ended = TRANSFER_FAILED;
+		stream->error = ERROR_file_transfer_connection_timeout;
 	}
-	RETURN_LONG(error);
 }
 
-PHP_FUNCTION(ts3client_setChannelVariableAsInt)
+static void free_file_stream(struct FileStream *stream)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long flag;
-	zend_long value;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &channelID, &flag, &value) == FAILURE)
-		return;
-	unsigned int error = ts3client_setChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, value);
-	RETURN_LONG(error);
+	if (stream->fd >= 0)
+		close(stream->fd);
+	if (stream->local[0] != '\0')
+		unlink(stream->local);
+	if (stream->directory[0] != '\0')
+		rmdir(stream->directory);
+	free(stream->file);
+	free(stream->channel_password);
+	free(stream);
 }
 
-PHP_FUNCTION(ts3client_setChannelVariableAsUInt64)
+static ssize_t file_stream_read(php_stream *php_stream, char *buffer, size_t count)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long flag;
-	zend_long value;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llll", &serverConnectionHandlerID, &channelID, &flag, &value) == FAILURE)
-		return;
-	unsigned int error = ts3client_setChannelVariableAsUInt64(serverConnectionHandlerID, channelID, flag, value);
-	RETURN_LONG(error);
+	struct FileStream *stream = php_stream->abstract;
+	if (stream->upload)
+		return -1;
+	while (true)
+	{
+		if (stream->fd < 0)
+			stream->fd = open(stream->local, O_RDONLY);
+		if (stream->fd >= 0)
+		{
+			ssize_t received = read(stream->fd, buffer, count);
+			if (received < 0 && errno == EINTR)
+				continue;
+			if (received != 0)
+			{
+				struct timespec now;
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				stream->progressed = monotonic_ms(&now);
+				return received;
+			}
+		}
+		if (stream->ended == TRANSFER_DONE)
+		{
+			php_stream->eof = 1;
+			return 0;
+		}
+		if (stream->ended != 0)
+		{
+			php_error_docref(NULL, E_WARNING, "Download of %s failed with error %u", stream->file, stream->error);
+			php_stream->eof = 1;
+			return -1;
+		}
+		await_file_transfer(stream, TRANSFER_TAIL_MS);
+	}
 }
 
-PHP_FUNCTION(ts3client_setChannelVariableAsString)
+static ssize_t file_stream_write(php_stream *php_stream, const char *buffer, size_t count)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zend_long flag;
-	char *value; size_t value_len;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llls", &serverConnectionHandlerID, &channelID, &flag, &value, &value_len) == FAILURE)
-		return;
-	to_asciiz(&value, value_len);
-	unsigned int error = ts3client_setChannelVariableAsString(serverConnectionHandlerID, channelID, flag, value);
-	free(value);
-	RETURN_LONG(error);
+	struct FileStream *stream = php_stream->abstract;
+	if (stream->upload == false || write_fully(stream->fd, buffer, count) == false)
+		return -1;
+	return count;
 }
 
-PHP_FUNCTION(ts3client_flushChannelUpdates)
+static int file_stream_close(php_stream *php_stream, int close_handle)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &channelID) == FAILURE)
-		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_flushChannelUpdates(serverConnectionHandlerID, channelID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error));
+	(void)close_handle;
+	struct FileStream *stream = php_stream->abstract;
+	int result = 0;
+	if (stream->upload)
+	{
+		close(stream->fd);
+		stream->fd = -1;
+		struct Transfer *transfer = calloc(1, sizeof(struct Transfer));
+		transfer->serverConnectionHandlerID = stream->url.serverConnectionHandlerID;
+		transfer->channelID = stream->url.channelID;
+		transfer->channel_password = strdup(stream->channel_password);
+		transfer->file = strdup(stream->file);
+		transfer->directory = strdup(stream->directory);
+		transfer->upload = true;
+		transfer->overwrite = stream->overwrite;
+		stream->transfer = add_transfer(transfer);
+		if (stream->transfer == 0)
+			stream->ended = TRANSFER_FAILED;
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		stream->progressed = monotonic_ms(&now);
+		while (stream->ended == 0)
+			await_file_transfer(stream, TRANSFER_SWEEP_MS);
+		if (stream->ended != TRANSFER_DONE)
+		{
+			php_error_docref(NULL, E_WARNING, "Upload of %s failed with error %u", stream->file, stream->error);
+			result = EOF;
+		}
+	}
+	else if (stream->ended == 0)
+		cancel_transfer(stream->transfer, true);
+
+	if (stream->transfer != 0)
+		forget_transfer(stream->transfer);
+	free_file_stream(stream);
+	return result;
 }
 
-PHP_FUNCTION(ts3client_flushChannelCreation)
+static int file_stream_flush(php_stream *php_stream)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "ll", &serverConnectionHandlerID, &channelID) == FAILURE)
-		return;
-	struct WaitItem* item = create_return_code_item();
-	unsigned int error = ts3client_flushChannelCreation(serverConnectionHandlerID, channelID, item->return_code_text);
-	RETURN_LONG(handle_return_code(item, error));
+	(void)php_stream;
+	return 0;
 }
 
-PHP_FUNCTION(ts3client_getChannelList)
+static int file_stream_stat(php_stream *php_stream, php_stream_statbuf *ssb)
 {
-	zend_long serverConnectionHandlerID;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lz/", &serverConnectionHandlerID, &zresult) == FAILURE)
-		return;
-	uint64_t* result;
-	unsigned int error = ts3client_getChannelList(serverConnectionHandlerID, &result);
-	if (error == ERROR_ok)
+	struct FileStream *stream = php_stream->abstract;
+	memset(ssb, 0, sizeof(*ssb));
+	ssb->sb.st_mode = S_IFREG | 0666;
+	if (stream->upload)
 	{
-		zval_dtor(zresult);
-		array_init(zresult);
-		for  (uint64_t* p = result; *p; ++p)
-		{
-			add_next_index_long(zresult, *p);
-		}
-		ts3client_freeMemory(result);
+		struct stat local;
+		if (fstat(stream->fd, &local) != 0)
+			return -1;
+		ssb->sb.st_size = local.st_size;
+		return 0;
 	}
-	RETURN_LONG(error);
+	uint64_t size = 0, done;
+	unsigned int error;
+	get_transfer_progress(stream->transfer, 0, &size, &done, &error);
+	ssb->sb.st_size = size;
+	return 0;
 }
 
-PHP_FUNCTION(ts3client_getChannelClientList)
+static const php_stream_ops file_stream_ops = {
+	.write = file_stream_write,
+	.read = file_stream_read,
+	.close = file_stream_close,
+	.flush = file_stream_flush,
+	.label = "ts3file",
+	.stat = file_stream_stat,
+};
+
+static php_stream *file_stream_open(php_stream_wrapper *wrapper, const char *path, const char *mode, int options, zend_string **opened_path, php_stream_context *context STREAMS_DC)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &channelID, &zresult) == FAILURE)
-		return;
-	anyID* result;
-	unsigned int error = ts3client_getChannelClientList(serverConnectionHandlerID, channelID, &result);
-	if (error == ERROR_ok)
+	(void)opened_path;
+	struct FileUrl url;
+	if (parse_file_url(path, &url) == false || url.path[strlen(url.path) - 1] == '/')
 	{
-		zval_dtor(zresult);
-		array_init(zresult);
-		for  (anyID* p = result; *p; ++p)
+		php_stream_wrapper_log_error(wrapper, options, "Invalid URL, expected ts3file://<serverConnectionHandlerID>/<channelID>/<file>");
+		return NULL;
+	}
+	if (strchr(mode, '+') != NULL || strchr("rwx", mode[0]) == NULL)
+	{
+		php_stream_wrapper_log_error(wrapper, options, "Channel files can only be opened for reading or writing");
+		return NULL;
+	}
+	if (initialize() == false)
+	{
+		php_stream_wrapper_log_error(wrapper, options, "The client lib could not be initialized");
+		return NULL;
+	}
+
+	struct FileStream *stream = calloc(1, sizeof(struct FileStream));
+	stream->fd = -1;
+	stream->upload = mode[0] != 'r';
+	stream->overwrite = mode[0] == 'w';
+	stream->timeout = TS3CLIENT_G(timeout) * 1000LL;
+	stream->file = strdup(url.path);
+	stream->channel_password = strdup(file_url_password(context));
+	stream->url = url;
+	stream->url.path = stream->file;
+	snprintf(stream->directory, sizeof(stream->directory), "%s/ts3fileXXXXXX", php_get_temporary_directory());
+	if (mkdtemp(stream->directory) == NULL)
+	{
+		stream->directory[0] = '\0';
+		php_stream_wrapper_log_error(wrapper, options, "Could not create a temporary directory: %s", strerror(errno));
+		free_file_stream(stream);
+		return NULL;
+	}
+	snprintf(stream->local, sizeof(stream->local), "%s/%s", stream->directory, strrchr(stream->file, '/') + 1);
+
+	if (stream->upload)
+	{
+		stream->fd = open(stream->local, O_WRONLY | O_CREAT | O_EXCL, 0600);
+		if (stream->fd < 0)
 		{
-			add_next_index_long(zresult, *p);
+			php_stream_wrapper_log_error(wrapper, options, "Could not create %s: %s", stream->local, strerror(errno));
+			free_file_stream(stream);
+			return NULL;
 		}
-		ts3client_freeMemory(result);
 	}
-	RETURN_LONG(error);
+	else
+	{
+		struct Transfer *transfer = calloc(1, sizeof(struct Transfer));
+		transfer->serverConnectionHandlerID = url.serverConnectionHandlerID;
+		transfer->channelID = url.channelID;
+		transfer->channel_password = strdup(stream->channel_password);
+		transfer->file = strdup(stream->file);
+		transfer->directory = strdup(stream->directory);
+		stream->transfer = add_transfer(transfer);
+		if (stream->transfer == 0)
+		{
+			php_stream_wrapper_log_error(wrapper, options, "Could not queue the download of %s", stream->file);
+			free_file_stream(stream);
+			return NULL;
+		}
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		stream->progressed = monotonic_ms(&now);
+	}
+	return php_stream_alloc(&file_stream_ops, stream, 0, mode);
 }
 
-PHP_FUNCTION(ts3client_getParentChannelOfChannel)
+static void file_entry_stat(const struct FileEntry *entry, php_stream_statbuf *ssb)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &channelID, &zresult) == FAILURE)
-		return;
-	uint64_t result;
-	unsigned int error = ts3client_getParentChannelOfChannel(serverConnectionHandlerID, channelID, &result);
-	if (error == ERROR_ok)
-	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
-	}
-	RETURN_LONG(error);
+	memset(ssb, 0, sizeof(*ssb));
+	ssb->sb.st_mode = entry->type == FileListType_Directory ? S_IFDIR | 0777 : S_IFREG | 0666;
+	ssb->sb.st_size = entry->size;
+	ssb->sb.st_mtime = entry->datetime;
 }
 
-PHP_FUNCTION(ts3client_getChannelEmptySecs)
+/* Channel files have no stat of their own; they are looked up in the listing of their directory. */
+static int file_url_stat(php_stream_wrapper *wrapper, const char *path, int flags, php_stream_statbuf *ssb, php_stream_context *context)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long channelID;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &channelID, &zresult) == FAILURE)
-		return;
-	int result;
-	unsigned int error = ts3client_getChannelEmptySecs(serverConnectionHandlerID, channelID, &result);
-	if (error == ERROR_ok)
+	(void)wrapper;
+	(void)flags;
+	struct FileUrl url;
+	if (parse_file_url(path, &url) == false || initialize() == false)
+		return -1;
+	size_t length = strlen(url.path);
+	while (length > 1 && url.path[length - 1] == '/')
+		--length;
+	if (length == 1)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		memset(ssb, 0, sizeof(*ssb));
+		ssb->sb.st_mode = S_IFDIR | 0777;
+		return 0;
 	}
-	RETURN_LONG(error);
-}
 
-PHP_FUNCTION(ts3client_getServerVariableAsInt)
-{
-	zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-		return;
-	int result;
-	unsigned int error = ts3client_getServerVariableAsInt(serverConnectionHandlerID, flag, &result);
-	if (error == ERROR_ok)
+	char *parent = strndup(url.path, length);
+	char *name = strrchr(parent, '/');
+	*name++ = '\0';
+	struct FileListing *listing;
+	int result = -1;
+	if (request_file_listing(&url, file_url_password(context), parent[0] ? parent : "/", &listing) == ERROR_ok)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		for (size_t i = 0; i < listing->count && result != 0; ++i)
+		{
+			if (strcmp(listing->entries[i].name, name) == 0)
+			{
+				file_entry_stat(&listing->entries[i], ssb);
+				result = 0;
+			}
+		}
+		free_file_listing(listing);
 	}
-	RETURN_LONG(error);
+	free(parent);
+	return result;
 }
 
-PHP_FUNCTION(ts3client_getServerVariableAsUInt64)
+struct FileDirectory
 {
-	zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-		return;
-	uint64_t result;
-	unsigned int error = ts3client_getServerVariableAsUInt64(serverConnectionHandlerID, flag, &result);
-	if (error == ERROR_ok)
+	struct FileListing *listing;
+	size_t position;
+};
+
+static ssize_t file_directory_read(php_stream *php_stream, char *buffer, size_t count)
+{
+	struct FileDirectory *directory = php_stream->abstract;
+	if (count != sizeof(php_stream_dirent) || directory->position == directory->listing->count)
 	{
-		zval_dtor(zresult);
-		ZVAL_LONG(zresult, result);
+		php_stream->eof = 1;
+		return 0;
 	}
-	RETURN_LONG(error);
+	php_stream_dirent *entry = (php_stream_dirent *)buffer;
+	memset(entry, 0, sizeof(*entry));
+	strncpy(entry->d_name, directory->listing->entries[directory->position++].name, sizeof(entry->d_name) - 1);
+	return sizeof(php_stream_dirent);
 }
 
-PHP_FUNCTION(ts3client_getServerVariableAsString)
+static int file_directory_close(php_stream *php_stream, int close_handle)
 {
-	zend_long serverConnectionHandlerID;
-	zend_long flag;
-	zval *zresult;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "llz/", &serverConnectionHandlerID, &flag, &zresult) == FAILURE)
-		return;
-	char *result;
-	unsigned int error = ts3client_getServerVariableAsString(serverConnectionHandlerID, flag, &result);
-	if (error == ERROR_ok)
-	{
-		zval_dtor(zresult);
-		ZVAL_STRING(zresult, result);
-		ts3client_freeMemory(result);
-	}
-	RETURN_LONG(error);
+	(void)close_handle;
+	struct FileDirectory *directory = php_stream->abstract;
+	free_file_listing(directory->listing);
+	free(directory);
+	return 0;
 }
 
-PHP_FUNCTION(ts3client_requestServerVariables)
+static int file_directory_rewind(php_stream *php_stream, zend_off_t offset, int whence, zend_off_t *newoffset)
 {
-	zend_long serverConnectionHandlerID;
-	if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &serverConnectionHandlerID) == FAILURE)
-		return;
-	unsigned int error = ts3client_requestServerVariables(serverConnectionHandlerID);
-	RETURN_LONG(error);
+	struct FileDirectory *directory = php_stream->abstract;
+	(void)whence;
+	directory->position = 0;
+	*newoffset = offset;
+	return 0;
 }
 
+static const php_stream_ops file_directory_ops = {
+	.read = file_directory_read,
+	.close = file_directory_close,
+	.flush = file_stream_flush,
+	.label = "ts3file dir",
+	.seek = file_directory_rewind,
+};
+
+static php_stream *file_directory_open(php_stream_wrapper *wrapper, const char *path, const char *mode, int options, zend_string **opened_path, php_stream_context *context STREAMS_DC)
+{
+	(void)opened_path;
+	struct FileUrl url;
+	if (parse_file_url(path, &url) == false)
+	{
+		php_stream_wrapper_log_error(wrapper, options, "Invalid URL, expected ts3file://<serverConnectionHandlerID>/<channelID>/<directory>");
+		return NULL;
+	}
+	if (initialize() == false)
+	{
+		php_stream_wrapper_log_error(wrapper, options, "The client lib could not be initialized");
+		return NULL;
+	}
+	struct FileListing *listing;
+	unsigned int error = request_file_listing(&url, file_url_password(context), url.path, &listing);
+	if (error != ERROR_ok)
+	{
+		php_stream_wrapper_log_error(wrapper, options, "Listing %s failed with error %u", url.path, error);
+		return NULL;
+	}
+	struct FileDirectory *directory = malloc(sizeof(struct FileDirectory));
+	directory->listing = listing;
+	directory->position = 0;
+	return php_stream_alloc(&file_directory_ops, directory, 0, mode);
+}
+
+static const php_stream_wrapper_ops file_wrapper_ops = {
+	.stream_opener = file_stream_open,
+	.url_stat = file_url_stat,
+	.dir_opener = file_directory_open,
+	.label = "ts3file",
+};
+
+static php_stream_wrapper file_wrapper = {
+	.wops = &file_wrapper_ops,
+	.abstract = NULL,
+	.is_url = 1,
+};
+
 zend_function_entry ts3client_functions[] =
 {
 	PHP_FE(ts3client_getClientLibVersion, arginfo_ts3client_getClientLibVersion)
@@ -1547,11 +8650,17 @@ zend_function_entry ts3client_functions[] =
 	PHP_FE(ts3client_requestClientVariables, arginfo_ts3client_requestClientVariables)
 	PHP_FE(ts3client_requestClientKickFromChannel, arginfo_ts3client_requestClientKickFromChannel)
 	PHP_FE(ts3client_requestClientKickFromServer, arginfo_ts3client_requestClientKickFromServer)
+	PHP_FE(ts3client_requestClientMoveMany, arginfo_ts3client_requestClientMoveMany)
+	PHP_FE(ts3client_requestClientKickFromChannelMany, arginfo_ts3client_requestClientKickFromChannelMany)
+	PHP_FE(ts3client_requestClientKickFromServerMany, arginfo_ts3client_requestClientKickFromServerMany)
 	PHP_FE(ts3client_requestChannelDelete, arginfo_ts3client_requestChannelDelete)
 	PHP_FE(ts3client_requestChannelMove, arginfo_ts3client_requestChannelMove)
 	PHP_FE(ts3client_requestSendPrivateTextMsg, arginfo_ts3client_requestSendPrivateTextMsg)
 	PHP_FE(ts3client_requestSendChannelTextMsg, arginfo_ts3client_requestSendChannelTextMsg)
 	PHP_FE(ts3client_requestSendServerTextMsg, arginfo_ts3client_requestSendServerTextMsg)
+	PHP_FE(ts3client_requestSendTextMsgs, arginfo_ts3client_requestSendTextMsgs)
+	PHP_FE(ts3client_sendPrivateTextMsgMany, arginfo_ts3client_sendPrivateTextMsgMany)
+	PHP_FE(ts3client_requestSendTextMsgChunked, arginfo_ts3client_requestSendTextMsgChunked)
 	PHP_FE(ts3client_requestConnectionInfo, arginfo_ts3client_requestConnectionInfo)
 	PHP_FE(ts3client_requestChannelSubscribeAll, arginfo_ts3client_requestChannelSubscribeAll)
 	PHP_FE(ts3client_requestChannelUnsubscribeAll, arginfo_ts3client_requestChannelUnsubscribeAll)
@@ -1582,6 +8691,8 @@ zend_function_entry ts3client_functions[] =
 	PHP_FE(ts3client_setChannelVariableAsString, arginfo_ts3client_setChannelVariableAsString)
 	PHP_FE(ts3client_flushChannelUpdates, arginfo_ts3client_flushChannelUpdates)
 	PHP_FE(ts3client_flushChannelCreation, arginfo_ts3client_flushChannelCreation)
+	PHP_FE(ts3client_editChannels, arginfo_ts3client_editChannels)
+	PHP_FE(ts3client_provisionChannels, arginfo_ts3client_provisionChannels)
 	PHP_FE(ts3client_getChannelList, arginfo_ts3client_getChannelList)
 	PHP_FE(ts3client_getChannelClientList, arginfo_ts3client_getChannelClientList)
 	PHP_FE(ts3client_getParentChannelOfChannel, arginfo_ts3client_getParentChannelOfChannel)
@@ -1590,11 +8701,91 @@ zend_function_entry ts3client_functions[] =
 	PHP_FE(ts3client_getServerVariableAsUInt64, arginfo_ts3client_getServerVariableAsUInt64)
 	PHP_FE(ts3client_getServerVariableAsString, arginfo_ts3client_getServerVariableAsString)
 	PHP_FE(ts3client_requestServerVariables, arginfo_ts3client_requestServerVariables)
+	PHP_FE(ts3client_setFloodControl, arginfo_ts3client_setFloodControl)
+	PHP_FE(ts3client_getFloodControl, arginfo_ts3client_getFloodControl)
+	PHP_FE(ts3client_submit, arginfo_ts3client_submit)
+	PHP_FE(ts3client_getCompletionFd, arginfo_ts3client_getCompletionFd)
+	PHP_FE(ts3client_reapCompletions, arginfo_ts3client_reapCompletions)
+	PHP_FE(ts3client_dispatchCompletions, arginfo_ts3client_dispatchCompletions)
+	PHP_FE(ts3client_registerCustomDevice, arginfo_ts3client_registerCustomDevice)
+	PHP_FE(ts3client_unregisterCustomDevice, arginfo_ts3client_unregisterCustomDevice)
+	PHP_FE(ts3client_openCaptureDevice, arginfo_ts3client_openCaptureDevice)
+	PHP_FE(ts3client_closeCaptureDevice, arginfo_ts3client_closeCaptureDevice)
+	PHP_FE(ts3client_feedCustomCapture, arginfo_ts3client_feedCustomCapture)
+	PHP_FE(ts3client_getCustomCaptureStatus, arginfo_ts3client_getCustomCaptureStatus)
+	PHP_FE(ts3client_openPlaybackDevice, arginfo_ts3client_openPlaybackDevice)
+	PHP_FE(ts3client_closePlaybackDevice, arginfo_ts3client_closePlaybackDevice)
+	PHP_FE(ts3client_startCustomPlayback, arginfo_ts3client_startCustomPlayback)
+	PHP_FE(ts3client_stopCustomPlayback, arginfo_ts3client_stopCustomPlayback)
+	PHP_FE(ts3client_readCustomPlayback, arginfo_ts3client_readCustomPlayback)
+	PHP_FE(ts3client_getCustomPlaybackStatus, arginfo_ts3client_getCustomPlaybackStatus)
+	PHP_FE(ts3client_startSpeakerRecording, arginfo_ts3client_startSpeakerRecording)
+	PHP_FE(ts3client_stopSpeakerRecording, arginfo_ts3client_stopSpeakerRecording)
+	PHP_FE(ts3client_getSpeakerRecordingStatus, arginfo_ts3client_getSpeakerRecordingStatus)
+	PHP_FE(ts3client_setCustomDeviceGain, arginfo_ts3client_setCustomDeviceGain)
+	PHP_FE(ts3client_getTalkStats, arginfo_ts3client_getTalkStats)
+	PHP_FE(ts3client_requestClientSetWhisperList, arginfo_ts3client_requestClientSetWhisperList)
+	PHP_FE(ts3client_requestClientSetWhisperListMany, arginfo_ts3client_requestClientSetWhisperListMany)
+	PHP_FE(ts3client_getWhisperList, arginfo_ts3client_getWhisperList)
+	PHP_FE(ts3client_queueUpload, arginfo_ts3client_queueUpload)
+	PHP_FE(ts3client_queueDownload, arginfo_ts3client_queueDownload)
+	PHP_FE(ts3client_cancelTransfer, arginfo_ts3client_cancelTransfer)
+	PHP_FE(ts3client_setTransferLimits, arginfo_ts3client_setTransferLimits)
+	PHP_FE(ts3client_getTransfers, arginfo_ts3client_getTransfers)
+	PHP_FE(ts3client_getStats, arginfo_ts3client_getStats)
+	PHP_FE(ts3client_getLockStats, arginfo_ts3client_getLockStats)
+	PHP_FE(ts3client_getLogStatus, arginfo_ts3client_getLogStatus)
+	PHP_FE(ts3client_metrics, arginfo_ts3client_metrics)
+	PHP_FE(ts3client_dumpTrace, arginfo_ts3client_dumpTrace)
+	PHP_FE(ts3client_startQualitySampler, arginfo_ts3client_startQualitySampler)
+	PHP_FE(ts3client_stopQualitySampler, arginfo_ts3client_stopQualitySampler)
+	PHP_FE(ts3client_getQualitySamples, arginfo_ts3client_getQualitySamples)
 	PHP_FE_END
 };
 
+PHP_INI_BEGIN()
+	STD_PHP_INI_ENTRY("ts3client.timeout", "5", PHP_INI_ALL, OnUpdateLong, timeout, zend_ts3client_globals, ts3client_globals)
+	STD_PHP_INI_BOOLEAN("ts3client.fiber_wait", "0", PHP_INI_ALL, OnUpdateBool, fiber_wait, zend_ts3client_globals, ts3client_globals)
+	PHP_INI_ENTRY("ts3client.flood_rate", "0", PHP_INI_SYSTEM, OnUpdateFloodRate)
+	PHP_INI_ENTRY("ts3client.flood_burst", "20", PHP_INI_SYSTEM, OnUpdateFloodBurst)
+	PHP_INI_ENTRY("ts3client.lock_profiling", "0", PHP_INI_SYSTEM, OnUpdateLockProfiling)
+	PHP_INI_ENTRY("ts3client.log_file", "", PHP_INI_SYSTEM, OnUpdateLogFile)
+	PHP_INI_ENTRY("ts3client.log_level", "warning", PHP_INI_SYSTEM, OnUpdateLogLevel)
+	PHP_INI_ENTRY("ts3client.log_channels", "", PHP_INI_SYSTEM, OnUpdateLogChannels)
+	PHP_INI_ENTRY("ts3client.tracing", "0", PHP_INI_SYSTEM, OnUpdateTracing)
+PHP_INI_END()
+
+static PHP_GINIT_FUNCTION(ts3client)
+{
+#if defined(COMPILE_DL_TS3CLIENT) && defined(ZTS)
+	ZEND_TSRMLS_CACHE_UPDATE();
+#endif
+	ts3client_globals->timeout = TIMEOUT;
+	ts3client_globals->completions = NULL;
+	ts3client_globals->fiber_wait = false;
+	ts3client_globals->fiber_waits = NULL;
+	ts3client_globals->stats = NULL;
+	ts3client_globals->stats_function = -1;
+}
+
+static PHP_GSHUTDOWN_FUNCTION(ts3client)
+{
+	if (ts3client_globals->completions != NULL)
+		release_completion_queue(ts3client_globals->completions);
+	if (ts3client_globals->stats != NULL)
+	{
+		pthread_mutex_lock(&stats.lock);
+		ts3client_globals->stats->retired = true;
+		pthread_mutex_unlock(&stats.lock);
+	}
+}
+
 PHP_MINIT_FUNCTION(ts3client)
 {
+	REGISTER_INI_ENTRIES();
+	audio_kernels = audio_kernels_select();
+	reset_log_ring();
+
 	REGISTER_LONG_CONSTANT("ERROR_ok", ERROR_ok, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
 	REGISTER_LONG_CONSTANT("ERROR_undefined", ERROR_undefined, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
 	REGISTER_LONG_CONSTANT("ERROR_not_implemented", ERROR_not_implemented, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
@@ -1823,6 +9014,25 @@ PHP_MINIT_FUNCTION(ts3client)
 	REGISTER_LONG_CONSTANT("TEST_MODE_OFF", TEST_MODE_OFF, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
 	REGISTER_LONG_CONSTANT("TEST_MODE_VOICE_LOCAL_ONLY", TEST_MODE_VOICE_LOCAL_ONLY, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
 	REGISTER_LONG_CONSTANT("TEST_MODE_VOICE_LOCAL_AND_REMOTE", TEST_MODE_VOICE_LOCAL_AND_REMOTE, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TextMessageTarget_CLIENT", TextMessageTarget_CLIENT, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TextMessageTarget_CHANNEL", TextMessageTarget_CHANNEL, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TextMessageTarget_SERVER", TextMessageTarget_SERVER, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_START_CONNECTION", OPERATION_START_CONNECTION, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_STOP_CONNECTION", OPERATION_STOP_CONNECTION, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_CLIENT_MOVE", OPERATION_CLIENT_MOVE, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_CHANNEL_DELETE", OPERATION_CHANNEL_DELETE, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_FLUSH_CLIENT_SELF_UPDATES", OPERATION_FLUSH_CLIENT_SELF_UPDATES, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_FLUSH_CHANNEL_UPDATES", OPERATION_FLUSH_CHANNEL_UPDATES, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_FLUSH_CHANNEL_CREATION", OPERATION_FLUSH_CHANNEL_CREATION, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_OP_SEND_TEXT_MESSAGE", OPERATION_SEND_TEXT_MESSAGE, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_TRANSFER_QUEUED", TRANSFER_QUEUED, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_TRANSFER_STARTING", TRANSFER_STARTING, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_TRANSFER_RUNNING", TRANSFER_RUNNING, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_TRANSFER_DONE", TRANSFER_DONE, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_TRANSFER_FAILED", TRANSFER_FAILED, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+	REGISTER_LONG_CONSTANT("TS3CLIENT_TRANSFER_CANCELED", TRANSFER_CANCELED, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
+
+	php_register_url_stream_wrapper("ts3file", &file_wrapper);
 	REGISTER_LONG_CONSTANT("CONNECTION_PING", CONNECTION_PING, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
 	REGISTER_LONG_CONSTANT("CONNECTION_PING_DEVIATION", CONNECTION_PING_DEVIATION, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
 	REGISTER_LONG_CONSTANT("CONNECTION_CONNECTED_TIME", CONNECTION_CONNECTED_TIME, CONST_CS|CONST_PERSISTENT|CONST_CT_SUBST);
@@ -1879,16 +9089,92 @@ PHP_MINIT_FUNCTION(ts3client)
 	return SUCCESS;
 }
 
+PHP_MSHUTDOWN_FUNCTION(ts3client)
+{
+	php_unregister_url_stream_wrapper("ts3file");
+	UNREGISTER_INI_ENTRIES();
+	return SUCCESS;
+}
+
 PHP_MINFO_FUNCTION(ts3client)
 {
 	php_info_print_table_start();
 	php_info_print_table_header(2, "Teamspeak Client SDK support", "enabled");
 	php_info_print_table_row(2, "Version", PHP_TS3CLIENT_VERSION);
+#ifdef ZTS
+	php_info_print_table_row(2, "Thread Safety", "enabled");
+#else
+	php_info_print_table_row(2, "Thread Safety", "disabled");
+#endif
+	php_info_print_table_row(2, "Audio Kernels", audio_kernels->name);
+	php_info_print_table_end();
+
+	php_info_print_table_start();
+	php_info_print_table_header(7, "Function", "Calls", "Errors", "Timeouts", "p50 (us)", "p99 (us)", "p999 (us)");
+	struct FunctionSummary *summary = malloc(sizeof(struct FunctionSummary));
+	pthread_mutex_lock(&stats.lock);
+	const int count = atomic_load(&stats.function_count);
+	for (int function = 0; function < count; ++function)
+	{
+		summarize_function(function, summary, false);
+		if (summary->calls.count == 0 && summary->waits.count == 0)
+			continue;
+		uint64_t errors = summary->other_errors;
+		for (size_t i = 0; i < summary->error_count; ++i)
+			errors += summary->error_counts[i];
+		const struct HistogramSummary *latency = summary->calls.count ? &summary->calls : &summary->waits;
+		char calls[24], error_count[24], timeouts[24], p50[24], p99[24], p999[24];
+		snprintf(calls, sizeof(calls), "%llu", (unsigned long long)latency->count);
+		snprintf(error_count, sizeof(error_count), "%llu", (unsigned long long)errors);
+		snprintf(timeouts, sizeof(timeouts), "%llu", (unsigned long long)summary->timeouts);
+		snprintf(p50, sizeof(p50), "%llu", (unsigned long long)latency->p50);
+		snprintf(p99, sizeof(p99), "%llu", (unsigned long long)latency->p99);
+		snprintf(p999, sizeof(p999), "%llu", (unsigned long long)latency->p999);
+		php_info_print_table_row(7, stats.functions[function], calls, error_count, timeouts, p50, p99, p999);
+	}
+	pthread_mutex_unlock(&stats.lock);
 	php_info_print_table_end();
+
+	if (atomic_load(&lock_profiling))
+	{
+		php_info_print_table_start();
+		php_info_print_table_header(6, "Lock", "Contended", "Wait p99 (us)", "Worst wait (us)", "Worst hold (us)", "Worst hold by");
+		for (size_t i = 0; i < sizeof(lock_profiles) / sizeof(*lock_profiles); ++i)
+		{
+			struct LockProfile *profile = &lock_profiles[i];
+			const char *worst_hold_by = atomic_load(&profile->worst_hold_by);
+			char contended[24], p99[24], worst_wait[24], worst_hold[24];
+			summarize_histogram(&profile->wait, &summary->calls, false);
+			snprintf(contended, sizeof(contended), "%llu", (unsigned long long)atomic_load(&profile->contended));
+			snprintf(p99, sizeof(p99), "%llu", (unsigned long long)summary->calls.p99);
+			snprintf(worst_wait, sizeof(worst_wait), "%llu", (unsigned long long)atomic_load(&profile->wait.max));
+			snprintf(worst_hold, sizeof(worst_hold), "%llu", (unsigned long long)atomic_load(&profile->hold.max));
+			php_info_print_table_row(6, profile->name, contended, p99, worst_wait, worst_hold, worst_hold_by != NULL ? worst_hold_by : "");
+		}
+		php_info_print_table_end();
+
+		php_info_print_table_start();
+		php_info_print_table_header(4, "Callback", "Calls", "Worst duration (us)", "Worst lock wait (us)");
+		for (struct CallbackProfile *profile = atomic_load(&callback_profiles); profile != NULL; profile = profile->next)
+		{
+			char calls[24], worst[24], worst_wait[24];
+			snprintf(calls, sizeof(calls), "%llu", (unsigned long long)atomic_load(&profile->duration.count));
+			snprintf(worst, sizeof(worst), "%llu", (unsigned long long)atomic_load(&profile->duration.max));
+			snprintf(worst_wait, sizeof(worst_wait), "%llu", (unsigned long long)atomic_load(&profile->lock_wait.max));
+			php_info_print_table_row(4, profile->name, calls, worst, worst_wait);
+		}
+		php_info_print_table_end();
+	}
+	free(summary);
+
+	DISPLAY_INI_ENTRIES();
 }
 
 PHP_RINIT_FUNCTION(ts3client)
 {
+#if defined(COMPILE_DL_TS3CLIENT) && defined(ZTS)
+	ZEND_TSRMLS_CACHE_UPDATE();
+#endif
 	return initialize() ? SUCCESS : FAILURE;
 }
 
@@ -1897,17 +9183,22 @@ zend_module_entry ts3client_module_entry = {
 	"ts3client",
 	ts3client_functions,
 	PHP_MINIT(ts3client),
-	NULL,
+	PHP_MSHUTDOWN(ts3client),
 	PHP_RINIT(ts3client),
 	NULL,
 	PHP_MINFO(ts3client),
 	PHP_TS3CLIENT_VERSION,
-	NO_MODULE_GLOBALS,
+	PHP_MODULE_GLOBALS(ts3client),
+	PHP_GINIT(ts3client),
+	PHP_GSHUTDOWN(ts3client),
 	NULL,
 	STANDARD_MODULE_PROPERTIES_EX
 };
 
 #ifdef COMPILE_DL_TS3CLIENT
+#ifdef ZTS
+ZEND_TSRMLS_CACHE_DEFINE()
+#endif
 ZEND_GET_MODULE(ts3client)
 #endif
 
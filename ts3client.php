@@ -195,6 +195,75 @@ function ts3client_requestClientKickFromChannel($serverConnectionHandlerID, $cli
  */
 function ts3client_requestClientKickFromServer($serverConnectionHandlerID, $clientID, $kickReason) {}
 
+/**
+ * Move many clients to a channel. All requests are sent without waiting in between.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $clientIDs <p>
+ * The IDs of the clients to be moved. Each client is handled once, even if it is listed more than once.
+ * </p>
+ * @param int $newChannelID <p>
+ * The ID of the channel the clients are moved to.
+ * </p>
+ * @param string $password <p>
+ * Optional password, required for password-protected channels. Pass an empty string if no password is given.
+ * </p>
+ * @param array $result <p>
+ * The error code for each client, keyed by client ID.
+ * </p>
+ * @param bool $stopOnError [optional] <p>
+ * Stop sending further requests as soon as one of them failed. Clients that were not handled are missing from $result.
+ * </p>
+ * @return int ERROR_ok if all clients were moved, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_requestClientMoveMany($serverConnectionHandlerID, $clientIDs, $newChannelID, $password, &$result, $stopOnError = false) {}
+
+/**
+ * Kick many clients from their channels. All requests are sent without waiting in between.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $clientIDs <p>
+ * The IDs of the clients to be kicked. Each client is handled once, even if it is listed more than once.
+ * </p>
+ * @param string $kickReason <p>
+ * A short message explaining why the clients are kicked from the channel.
+ * </p>
+ * @param array $result <p>
+ * The error code for each client, keyed by client ID.
+ * </p>
+ * @param bool $stopOnError [optional] <p>
+ * Stop sending further requests as soon as one of them failed. Clients that were not handled are missing from $result.
+ * </p>
+ * @return int ERROR_ok if all clients were kicked, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_requestClientKickFromChannelMany($serverConnectionHandlerID, $clientIDs, $kickReason, &$result, $stopOnError = false) {}
+
+/**
+ * Kick many clients from the server. All requests are sent without waiting in between.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $clientIDs <p>
+ * The IDs of the clients to be kicked. Each client is handled once, even if it is listed more than once.
+ * </p>
+ * @param string $kickReason <p>
+ * A short message explaining why the clients are kicked from the server.
+ * </p>
+ * @param array $result <p>
+ * The error code for each client, keyed by client ID.
+ * </p>
+ * @param bool $stopOnError [optional] <p>
+ * Stop sending further requests as soon as one of them failed. Clients that were not handled are missing from $result.
+ * </p>
+ * @return int ERROR_ok if all clients were kicked, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_requestClientKickFromServerMany($serverConnectionHandlerID, $clientIDs, $kickReason, &$result, $stopOnError = false) {}
+
 /**
  * Remove a channel.
  * @param int $serverConnectionHandlerID <p>
@@ -243,10 +312,13 @@ function ts3client_requestChannelMove($serverConnectionHandlerID, $channelID, $n
  * @param int $targetClientID <p>
  * Id of the target client.
  * </p>
+ * @param bool $confirmed [optional] <p>
+ * Wait until the server confirmed the message. Without it the function only reports whether the message could be queued for sending.
+ * </p>
  * @return int ERROR_ok on success, otherwise an error code.
  * @ts3client
  */
-function ts3client_requestSendPrivateTextMsg($serverConnectionHandlerID, $message, $targetClientID) {}
+function ts3client_requestSendPrivateTextMsg($serverConnectionHandlerID, $message, $targetClientID, $confirmed = false) {}
 
 /**
  * Send a text message to a channel.
@@ -259,10 +331,13 @@ function ts3client_requestSendPrivateTextMsg($serverConnectionHandlerID, $messag
  * @param int $targetChannelID <p>
  * Id of the target channel.
  * </p>
+ * @param bool $confirmed [optional] <p>
+ * Wait until the server confirmed the message. Without it the function only reports whether the message could be queued for sending.
+ * </p>
  * @return int ERROR_ok on success, otherwise an error code.
  * @ts3client
  */
-function ts3client_requestSendChannelTextMsg($serverConnectionHandlerID, $message, $targetChannelID) {}
+function ts3client_requestSendChannelTextMsg($serverConnectionHandlerID, $message, $targetChannelID, $confirmed = false) {}
 
 /**
  * Send a text message to the virtual server.
@@ -272,10 +347,75 @@ function ts3client_requestSendChannelTextMsg($serverConnectionHandlerID, $messag
  * @param string $message <p>
  * String containing the text message
  * </p>
+ * @param bool $confirmed [optional] <p>
+ * Wait until the server confirmed the message. Without it the function only reports whether the message could be queued for sending.
+ * </p>
  * @return int ERROR_ok on success, otherwise an error code.
  * @ts3client
  */
-function ts3client_requestSendServerTextMsg($serverConnectionHandlerID, $message) {}
+function ts3client_requestSendServerTextMsg($serverConnectionHandlerID, $message, $confirmed = false) {}
+
+/**
+ * Send many text messages at once. All messages are sent without waiting for each other and are confirmed by the server.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $messages <p>
+ * List of messages. Each message is an array with the keys targetMode (one of the TextMessageTarget_* constants),
+ * targetID (client or channel ID, ignored for TextMessageTarget_SERVER) and message.
+ * </p>
+ * @param array $result <p>
+ * The error code of each message, using the same keys as $messages.
+ * </p>
+ * @return int ERROR_ok if all messages were delivered, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_requestSendTextMsgs($serverConnectionHandlerID, $messages, &$result) {}
+
+/**
+ * Send the same private text message to many clients.
+ * The message is sent to all clients without waiting in between and respects the flood control of the connection.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param string $message <p>
+ * String containing the text message.
+ * </p>
+ * @param array $clientIDs <p>
+ * Ids of the target clients. A client listed more than once gets the message once.
+ * </p>
+ * @param array $result <p>
+ * The error code for each recipient, keyed by client ID.
+ * </p>
+ * @return int ERROR_ok if all messages were delivered, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_sendPrivateTextMsgMany($serverConnectionHandlerID, $message, $clientIDs, &$result) {}
+
+/**
+ * Send a text message of any length by splitting it into chunks the server accepts.
+ * Chunks never split a UTF-8 character or a BBCode tag and preferably end at a line break or space.
+ * Formatting tags like [b] or [color] that are still open at the end of a chunk are closed there and reopened in the next chunk.
+ * The chunks are sent in order without waiting in between.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param int $targetMode <p>
+ * One of the TextMessageTarget_* constants.
+ * </p>
+ * @param int $targetID <p>
+ * Id of the target client or channel. Ignored for TextMessageTarget_SERVER.
+ * </p>
+ * @param string $message <p>
+ * String containing the text message.
+ * </p>
+ * @param int $maxLength [optional] <p>
+ * Maximum length of a chunk in bytes. Defaults to the maximum message length of the server.
+ * </p>
+ * @return int ERROR_ok if all chunks were delivered, ERROR_parameter_invalid if the message contains a NUL byte, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_requestSendTextMsgChunked($serverConnectionHandlerID, $targetMode, $targetID, $message, $maxLength = 1024) {}
 
 /**
  * Request more up to date connection information.
@@ -747,6 +887,48 @@ function ts3client_flushChannelUpdates($serverConnectionHandlerID, $channelID) {
  */
 function ts3client_flushChannelCreation($serverConnectionHandlerID, $channelParentID) {}
 
+/**
+ * Change several properties of many channels at once.
+ * The properties of every channel are set and flushed, and all channels are flushed without waiting in between.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $channels <p>
+ * Array keyed by channel ID. Each value is an array mapping CHANNEL_* constants to their new values.
+ * A channel with an unknown property or a value that is not a string, bool or int fails with ERROR_parameter_invalid
+ * before any of its properties are set.
+ * </p>
+ * @param array $result <p>
+ * The error code for each channel, keyed by channel ID.
+ * </p>
+ * @return int ERROR_ok if all channels were changed, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_editChannels($serverConnectionHandlerID, $channels, &$result) {}
+
+/**
+ * Create a whole tree of channels.
+ * All channels of one tree level are created without waiting in between, so the tree is created with one round trip per level.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $tree <p>
+ * List of channels to create. Each channel is an array mapping CHANNEL_* constants to their values.
+ * The key "children" may hold a list of subchannels in the same format. A channel with an unknown property or a value
+ * that is not a string, bool or int fails with ERROR_parameter_invalid before any of its properties are set.
+ * </p>
+ * @param array $result <p>
+ * Same structure as $tree. Each channel is an array with the keys channelID, error and, if subchannels were created, children.
+ * Subchannels of channels that could not be created are missing.
+ * </p>
+ * @param int $channelParentID [optional] <p>
+ * The ID of the channel the tree is created in. Pass 0 to create top-level channels.
+ * </p>
+ * @return int ERROR_ok if all channels were created, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_provisionChannels($serverConnectionHandlerID, $tree, &$result, $channelParentID = 0) {}
+
 /**
  * Get a list of all channels on the virtual server.
  * @param int $serverConnectionHandlerID <p>
@@ -867,6 +1049,606 @@ function ts3client_getServerVariableAsString($serverConnectionHandlerID, $flag,
  */
 function ts3client_requestServerVariables($serverConnectionHandlerID) {}
 
+/**
+ * Configure the client side flood protection of a server connection.
+ * Every request and text message sent through this connection takes a token from a bucket that refills at the given rate.
+ * When the bucket is empty the call waits until a token becomes available instead of failing.
+ * When the server reports ERROR_client_is_flooding the rate is halved and recovers gradually with every successful command.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param float $commandsPerSecond <p>
+ * Sustained number of commands per second. Pass 0 to disable throttling. Defaults to ts3client.flood_rate, which is 0.
+ * </p>
+ * @param float $burst <p>
+ * Number of commands that may be sent back to back before throttling starts. Defaults to ts3client.flood_burst, which is 20.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_setFloodControl($serverConnectionHandlerID, $commandsPerSecond, $burst) {}
+
+/**
+ * Get the flood protection settings of a server connection.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param array $result <p>
+ * Array with the keys commandsPerSecond, burst and currentCommandsPerSecond. The latter is the rate after adapting to flood errors reported by the server.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getFloodControl($serverConnectionHandlerID, &$result) {}
+
+/**
+ * Hand a request to the extension's I/O worker thread and return immediately.
+ * The worker sends the request and the result is posted as a completion once the server answered.
+ * Requests held back by the flood control of their connection wait on the worker without delaying other connections.
+ * Completions are collected with ts3client_reapCompletions; the stream from ts3client_getCompletionFd becomes readable while completions are waiting.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param int $operation <p>
+ * One of the TS3CLIENT_OP_* constants.
+ * </p>
+ * @param array $arguments <p>
+ * The arguments of the operation, in the order of the matching synchronous function without serverConnectionHandlerID:
+ * TS3CLIENT_OP_START_CONNECTION: identity, ip, port, nickname, defaultChannelID, defaultChannelPassword, serverPassword.
+ * TS3CLIENT_OP_STOP_CONNECTION: quitMessage.
+ * TS3CLIENT_OP_CLIENT_MOVE: clientID, newChannelID, password.
+ * TS3CLIENT_OP_CHANNEL_DELETE: channelID, force.
+ * TS3CLIENT_OP_FLUSH_CLIENT_SELF_UPDATES: none.
+ * TS3CLIENT_OP_FLUSH_CHANNEL_UPDATES: channelID.
+ * TS3CLIENT_OP_FLUSH_CHANNEL_CREATION: channelParentID.
+ * TS3CLIENT_OP_SEND_TEXT_MESSAGE: targetMode, targetID, message.
+ * </p>
+ * @param int $ticket <p>
+ * Identifies the completion of this request.
+ * </p>
+ * @return int ERROR_ok if the request was queued, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_submit($serverConnectionHandlerID, $operation, $arguments, &$ticket) {}
+
+/**
+ * Get a stream that becomes readable while completions of the calling thread are waiting to be reaped.
+ * It is meant for stream_select or an event loop; do not read from it.
+ * @param resource $result <p>
+ * The stream.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getCompletionFd(&$result) {}
+
+/**
+ * Collect the completions of requests the calling thread submitted with ts3client_submit.
+ * @param array $result <p>
+ * List of completions, each an array with the keys ticket, serverConnectionHandlerID, operation and error.
+ * Completions of TS3CLIENT_OP_FLUSH_CHANNEL_CREATION also contain the channelID of the created channel.
+ * Requests the server did not answer within ts3client.timeout seconds complete with ERROR_connection_lost.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_reapCompletions(&$result) {}
+
+/**
+ * Resume the fibers whose requests were answered or timed out, or whose wait for flood control ended.
+ * With ts3client.fiber_wait enabled, functions called inside a Fiber suspend only that fiber while waiting for the server.
+ * Call this whenever the stream from ts3client_getCompletionFd becomes readable, and at least once per second so that timeouts are noticed.
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_dispatchCompletions() {}
+
+/**
+ * Register a custom sound device that is fed from PHP instead of a sound card.
+ * Open it for a connection with ts3client_openCaptureDevice($serverConnectionHandlerID, "custom", $deviceID).
+ * @param string $deviceID <p>
+ * Unique ID of the device.
+ * </p>
+ * @param string $deviceDisplayName <p>
+ * Name of the device.
+ * </p>
+ * @param int $capFrequency <p>
+ * Sample rate of the captured audio in Hz, at most 48000 and a multiple of 50.
+ * </p>
+ * @param int $capChannels <p>
+ * Number of captured channels, 1 or 2.
+ * </p>
+ * @param int $playFrequency <p>
+ * Sample rate of the played audio in Hz, at most 48000 and a multiple of 50.
+ * </p>
+ * @param int $playChannels <p>
+ * Number of played channels, 1 or 2.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_registerCustomDevice($deviceID, $deviceDisplayName, $capFrequency, $capChannels, $playFrequency, $playChannels) {}
+
+/**
+ * Unregister a custom sound device.
+ * @param string $deviceID <p>
+ * ID of the device.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_unregisterCustomDevice($deviceID) {}
+
+/**
+ * Open a capture device for a connection.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @param string $modeID <p>
+ * The sound backend, "custom" for devices registered with ts3client_registerCustomDevice.
+ * </p>
+ * @param string $captureDevice <p>
+ * ID of the device.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_openCaptureDevice($serverConnectionHandlerID, $modeID, $captureDevice) {}
+
+/**
+ * Close the capture device of a connection.
+ * @param int $serverConnectionHandlerID <p>
+ * The unique ID for this server connection handler.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_closeCaptureDevice($serverConnectionHandlerID) {}
+
+/**
+ * Queue audio for a custom capture device.
+ * The audio is buffered natively (up to 2 seconds) and handed to the client lib in 20 ms frames by a native thread, so PHP only has to keep the buffer filled.
+ * @param string $deviceID <p>
+ * ID of a device registered with ts3client_registerCustomDevice.
+ * </p>
+ * @param string|resource $data <p>
+ * Signed 16 bit PCM in native byte order with interleaved channels, at the capture rate of the device.
+ * Either a string or a stream to read from; a stream is read straight into the buffer until it is full or no more data is available.
+ * </p>
+ * @param int $result <p>
+ * Number of bytes taken. Bytes of a string that did not fit into the buffer have to be fed again later.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_feedCustomCapture($deviceID, $data, &$result) {}
+
+/**
+ * Get the state of the capture buffer of a custom device.
+ * @param string $deviceID <p>
+ * ID of the device.
+ * </p>
+ * @param array $result <p>
+ * Array with the keys buffered and capacity in bytes, bufferedMilliseconds, underruns, the number of frames that could not be sent because the buffer ran empty,
+ * gain, and peak and rms, the level of the last frame sent in sample units.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getCustomCaptureStatus($deviceID, &$result) {}
+
+/**
+ * Open a playback device on a server connection handler.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection to play on.
+ * </p>
+ * @param string $modeID <p>
+ * Playback mode to use, "custom" for a device registered with ts3client_registerCustomDevice.
+ * </p>
+ * @param string $playbackDevice <p>
+ * ID of the device.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_openPlaybackDevice($serverConnectionHandlerID, $modeID, $playbackDevice) {}
+
+/**
+ * Close the playback device of a server connection handler.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_closePlaybackDevice($serverConnectionHandlerID) {}
+
+/**
+ * Start recording the mixed playback of a custom device.
+ * A native thread takes the audio from the client lib in 20 ms frames, silence included, and buffers 10 seconds of it.
+ * While the consumer falls behind the buffer grows, up to 5 minutes, instead of dropping frames.
+ * @param string $deviceID <p>
+ * ID of a device registered with ts3client_registerCustomDevice.
+ * </p>
+ * @param string|null $path [optional] <p>
+ * WAV file to record to. The file is written by a native thread and stays playable while recording.
+ * Without a path the audio has to be read with ts3client_readCustomPlayback.
+ * </p>
+ * @return int ERROR_ok on success, ERROR_currently_not_possible if the device is already recording, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_startCustomPlayback($deviceID, $path = null) {}
+
+/**
+ * Stop recording the playback of a custom device. A WAV file is completed and closed.
+ * @param string $deviceID <p>
+ * ID of the device.
+ * </p>
+ * @return int ERROR_ok on success, ERROR_file_io_error if writing the WAV file failed, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_stopCustomPlayback($deviceID) {}
+
+/**
+ * Write the buffered playback of a custom device to a stream.
+ * @param string $deviceID <p>
+ * ID of a device recording without a path.
+ * </p>
+ * @param resource $stream <p>
+ * Stream to write signed 16 bit PCM in native byte order with interleaved channels to.
+ * </p>
+ * @param int $result <p>
+ * Number of bytes written.
+ * </p>
+ * @return int ERROR_ok on success, ERROR_currently_not_possible if the device records to a file, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_readCustomPlayback($deviceID, $stream, &$result) {}
+
+/**
+ * Get the state of the playback buffer of a custom device.
+ * @param string $deviceID <p>
+ * ID of the device.
+ * </p>
+ * @param array $result <p>
+ * Array with the keys capturing, buffered and capacity in bytes, bufferedMilliseconds, overruns, the number of frames dropped because the buffer could not grow any further, recorded, the bytes written to the WAV file,
+ * error, ERROR_file_io_error once writing the WAV file failed, gain, and peak and rms, the level of the last frame recorded in sample units.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getCustomPlaybackStatus($deviceID, &$result) {}
+
+/**
+ * Start recording every speaker into a WAV file of its own.
+ * The voice of each client is copied on the audio thread of its connection, which requires an open playback device, and written by a native thread.
+ * A file is named serverConnectionHandlerID-clientID-startTimeInMilliseconds.wav and starts with the first frame of the client; pauses are recorded as silence and stereo voices are downmixed to mono.
+ * Up to 64 clients are recorded at the same time; a file is completed once its client did not speak for 30 seconds, and continued in a new one.
+ * @param string $directory <p>
+ * Existing directory to write the files to.
+ * </p>
+ * @return int ERROR_ok on success, ERROR_currently_not_possible if speakers are already recorded, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_startSpeakerRecording($directory) {}
+
+/**
+ * Stop recording speakers and complete all their files.
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_stopSpeakerRecording() {}
+
+/**
+ * Get the state of speaker recording.
+ * @param array $result <p>
+ * Array with the keys recording, dropped, the number of frames lost because all tracks were in use, and tracks, a list of arrays with the keys
+ * serverConnectionHandlerID, clientID, started (unix time), path, recorded (bytes written), overruns (frames lost because the file could not be written in time),
+ * and peak and rms, the level of the last frame of the client in sample units.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getSpeakerRecordingStatus(&$result) {}
+
+/**
+ * Set the gain applied to the audio of a custom device.
+ * @param string $deviceID <p>
+ * ID of the device.
+ * </p>
+ * @param float $captureGain <p>
+ * Factor for the audio fed to the device, between 0 and 16. Samples saturate at the 16 bit limits.
+ * </p>
+ * @param float $playbackGain <p>
+ * Factor for the playback recorded from the device, between 0 and 16.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_setCustomDeviceGain($deviceID, $captureGain, $playbackGain) {}
+
+/**
+ * Get the talk time of the clients of a connection, aggregated natively from the talk status events.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param bool $reset <p>
+ * Whether to reset the counters after reading them. Bursts in progress are kept and counted when they end.
+ * </p>
+ * @param array $result <p>
+ * List of arrays, one per client and channel, with the keys clientID, channelID (the channel the client was in when a burst started),
+ * talking, bursts, whisperBursts, milliseconds (total talk time of completed bursts), longest (longest burst in milliseconds)
+ * and histogram, a list of 16 counters where counter i counts bursts of 2^i to 2^(i+1) - 1 milliseconds and the last one all longer bursts.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getTalkStats($serverConnectionHandlerID, $reset, &$result) {}
+
+/**
+ * Set the whisper list of a client. Once the server confirmed it, the list is cached natively for ts3client_getWhisperList.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param int $clientID <p>
+ * Client whose whisper list to set, 0 for the own client.
+ * </p>
+ * @param array $targetChannelIDs <p>
+ * IDs of the channels to whisper to.
+ * </p>
+ * @param array $targetClientIDs <p>
+ * IDs of the clients to whisper to. With both lists empty the client talks to its channel again.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_requestClientSetWhisperList($serverConnectionHandlerID, $clientID, array $targetChannelIDs, array $targetClientIDs) {}
+
+/**
+ * Set the whisper lists of many clients. All requests are sent before waiting for the first answer.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param array $whisperLists <p>
+ * Whisper lists keyed by client ID, 0 for the own client. Each is an array with the optional keys channels and clients, both lists of IDs.
+ * </p>
+ * @param array $result <p>
+ * Error code of every whisper list, with the keys of $whisperLists.
+ * </p>
+ * @return int ERROR_ok if every whisper list was set, otherwise the first error code.
+ * @ts3client
+ */
+function ts3client_requestClientSetWhisperListMany($serverConnectionHandlerID, array $whisperLists, &$result) {}
+
+/**
+ * Get the whisper list of a client from the native cache, without asking the server.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param int $clientID <p>
+ * Client whose whisper list to get, 0 for the own client.
+ * </p>
+ * @param array $result <p>
+ * Array with the keys channels and clients, the targets last set through this process. Both are empty if no whisper list is set.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_getWhisperList($serverConnectionHandlerID, $clientID, &$result) {}
+
+/**
+ * Queue an upload for the transfer manager, which starts it once the connection has a free transfer slot.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param int $channelID <p>
+ * Channel to upload the file to.
+ * </p>
+ * @param string $channelPassword <p>
+ * Password of the channel, an empty string if it has none.
+ * </p>
+ * @param string $file <p>
+ * Path of the file in the channel.
+ * </p>
+ * @param string $sourceDirectory <p>
+ * Local directory containing the file.
+ * </p>
+ * @param bool $overwrite <p>
+ * Whether to overwrite an existing file.
+ * </p>
+ * @param bool $resume <p>
+ * Whether to resume an earlier upload of the file.
+ * </p>
+ * @param int $result <p>
+ * ID of the queued transfer. It is not the transfer ID of the client lib.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_queueUpload($serverConnectionHandlerID, $channelID, $channelPassword, $file, $sourceDirectory, $overwrite, $resume, &$result) {}
+
+/**
+ * Queue a download for the transfer manager, which starts it once the connection has a free transfer slot.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param int $channelID <p>
+ * Channel to download the file from.
+ * </p>
+ * @param string $channelPassword <p>
+ * Password of the channel, an empty string if it has none.
+ * </p>
+ * @param string $file <p>
+ * Path of the file in the channel.
+ * </p>
+ * @param string $destinationDirectory <p>
+ * Local directory to store the file in.
+ * </p>
+ * @param bool $overwrite <p>
+ * Whether to overwrite an existing local file.
+ * </p>
+ * @param bool $resume <p>
+ * Whether to resume an earlier download of the file.
+ * </p>
+ * @param int $result <p>
+ * ID of the queued transfer. It is not the transfer ID of the client lib.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_queueDownload($serverConnectionHandlerID, $channelID, $channelPassword, $file, $destinationDirectory, $overwrite, $resume, &$result) {}
+
+/**
+ * Cancel a queued or running transfer of the transfer manager.
+ * @param int $transferID <p>
+ * ID returned by ts3client_queueUpload or ts3client_queueDownload.
+ * </p>
+ * @param bool $deleteUnfinishedFile <p>
+ * Whether to delete the partial file of a running transfer.
+ * </p>
+ * @return int ERROR_ok on success, ERROR_currently_not_possible if the transfer already ended, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_cancelTransfer($transferID, $deleteUnfinishedFile) {}
+
+/**
+ * Set how many transfers of a connection run at once and cap their bandwidth.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler of the connection.
+ * </p>
+ * @param int $parallelism <p>
+ * Number of transfers running at once, 4 by default.
+ * </p>
+ * @param int $uploadLimit <p>
+ * Upload limit in bytes per second, 0 for none.
+ * </p>
+ * @param int $downloadLimit <p>
+ * Download limit in bytes per second, 0 for none.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_setTransferLimits($serverConnectionHandlerID, $parallelism, $uploadLimit, $downloadLimit) {}
+
+/**
+ * Get the transfers of the transfer manager with their progress, which is refreshed four times per second.
+ * @param int $serverConnectionHandlerID <p>
+ * Connection handler whose transfers to get, 0 for all.
+ * </p>
+ * @param array $result <p>
+ * Transfers keyed by their ID, each an array with the keys serverConnectionHandlerID, channelID, file, upload, state (a TS3CLIENT_TRANSFER_* constant), error, size, done and speed in bytes per second.
+ * </p>
+ * @param bool $removeEnded <p>
+ * Whether to forget the returned transfers that are done, failed or canceled.
+ * </p>
+ * @return int ERROR_ok
+ * @ts3client
+ */
+function ts3client_getTransfers($serverConnectionHandlerID, &$result, $removeEnded = false) {}
+
+/**
+ * Get latency statistics of the functions this process called and of their waits for the server.
+ * @param array $result <p>
+ * Statistics keyed by function name. Each is an array with count, mean, p50, p99, p999 and max of the call latency in microseconds,
+ * the same keys prefixed with wait_ for the time spent waiting for the server, timeouts (waits that ended with ERROR_connection_lost),
+ * errors (counts keyed by the returned error code) and other_errors (errors that did not fit into errors).
+ * Percentiles are accurate to 1/16 of their value.
+ * </p>
+ * @param bool $reset <p>
+ * Whether to start counting from zero again.
+ * </p>
+ * @return int ERROR_ok
+ * @ts3client
+ */
+function ts3client_getStats(&$result, $reset = false) {}
+
+/**
+ * Get lock contention and callback statistics of this process. They are only recorded with ts3client.lock_profiling enabled.
+ * @param array $result <p>
+ * Array with the keys enabled, locks and callbacks.
+ * locks is keyed by lock name; each has contended (acquisitions that had to wait), count, mean, p50, p99, p999 and max
+ * in microseconds prefixed with wait_ and hold_, and worst_wait_at, worst_wait_by, worst_hold_at and worst_hold_by:
+ * when the longest wait and hold happened in milliseconds since the epoch and the PHP function or callback responsible.
+ * callbacks is keyed by callback name; each has count, mean, p50, p99, p999 and max of its duration, the same prefixed
+ * with lock_wait_ for the time it waited for locks, and worst_at, when the longest call happened.
+ * </p>
+ * @param bool $reset <p>
+ * Whether to start counting from zero again. Worst case timestamps are kept.
+ * </p>
+ * @return int ERROR_ok
+ * @ts3client
+ */
+function ts3client_getLockStats(&$result, $reset = false) {}
+
+/**
+ * Get the state of the client lib log routing configured with ts3client.log_file, ts3client.log_level and ts3client.log_channels.
+ * @param array $result <p>
+ * Array with the keys enabled, file, written (messages appended to the file), dropped (messages lost because the ring was full) and queued.
+ * </p>
+ * @return int ERROR_ok
+ * @ts3client
+ */
+function ts3client_getLogStatus(&$result) {}
+
+/**
+ * Render the metrics of this process in the OpenMetrics text format, e.g. for a Prometheus scrape endpoint.
+ * Only native counters and the client lib's cached connection values are read; the server is not asked.
+ * @param string $result <p>
+ * Pending requests, submission queue depth and rejections, dropped log messages, status, reconnects,
+ * bytes and packets of every server connection handler and a histogram of request wait times, terminated by # EOF.
+ * </p>
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_metrics(&$result) {}
+
+/**
+ * Write the requests recorded with ts3client.tracing as Chrome trace event JSON, which chrome://tracing and Perfetto open.
+ * Every request is a slice named after the function that sent it, split into send, server and wake phases.
+ * @param string $path file to write, replaced if it exists
+ * @return int ERROR_ok on success, ERROR_currently_not_possible if tracing is disabled, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_dumpTrace($path) {}
+
+/**
+ * Sample the connection quality of a server connection handler in the background. A native thread requests the
+ * connection info from the server every interval and keeps the most recent samples in memory. Calling it again
+ * changes the interval; changing the capacity drops the samples taken so far.
+ * @param int $serverConnectionHandlerID
+ * @param int $interval milliseconds between samples, at least 1000
+ * @param int $capacity number of samples kept, at most 86400
+ * @return int ERROR_ok on success, otherwise an error code.
+ * @ts3client
+ */
+function ts3client_startQualitySampler($serverConnectionHandlerID, $interval = 1000, $capacity = 3600) {}
+
+/**
+ * Stop sampling the connection quality of a server connection handler and drop its samples.
+ * Sampling also stops when the server connection handler is destroyed.
+ * @param int $serverConnectionHandlerID
+ * @return int ERROR_ok on success, ERROR_parameter_invalid if the handler is not sampled.
+ * @ts3client
+ */
+function ts3client_stopQualitySampler($serverConnectionHandlerID) {}
+
+/**
+ * Get the connection quality samples of a server connection handler, oldest first.
+ * @param int $serverConnectionHandlerID
+ * @param array $result <p>
+ * Array with the keys interval, capacity, failed (samples the server did not answer), last_error and points.
+ * Every point has the keys time (Unix time in milliseconds), ping and ping_deviation in milliseconds, packetloss and
+ * packetloss_speech between 0 and 1, bandwidth_sent and bandwidth_received in bytes during the last second and the
+ * packets_sent and packets_received counters. With a bucket every point instead aggregates the samples of one bucket:
+ * time is the start of the bucket, samples their number and every value an array with the keys min, avg and max.
+ * </p>
+ * @param int $since only return samples taken at or after this Unix time in milliseconds
+ * @param int $bucket aggregate the samples into buckets of this many milliseconds, 0 returns every sample
+ * @return int ERROR_ok on success, ERROR_parameter_invalid if the handler is not sampled.
+ * @ts3client
+ */
+function ts3client_getQualitySamples($serverConnectionHandlerID, &$result, $since = 0, $bucket = 0) {}
+
 
 /** @var int ERROR_ok */
 const ERROR_ok = 0;
@@ -1324,6 +2106,40 @@ const TEST_MODE_OFF = 0;
 const TEST_MODE_VOICE_LOCAL_ONLY = 0;
 /** @var int TEST_MODE_VOICE_LOCAL_AND_REMOTE */
 const TEST_MODE_VOICE_LOCAL_AND_REMOTE = 0;
+/** @var int TextMessageTarget_CLIENT */
+const TextMessageTarget_CLIENT = 0;
+/** @var int TextMessageTarget_CHANNEL */
+const TextMessageTarget_CHANNEL = 0;
+/** @var int TextMessageTarget_SERVER */
+const TextMessageTarget_SERVER = 0;
+/** @var int TS3CLIENT_OP_START_CONNECTION */
+const TS3CLIENT_OP_START_CONNECTION = 0;
+/** @var int TS3CLIENT_OP_STOP_CONNECTION */
+const TS3CLIENT_OP_STOP_CONNECTION = 0;
+/** @var int TS3CLIENT_OP_CLIENT_MOVE */
+const TS3CLIENT_OP_CLIENT_MOVE = 0;
+/** @var int TS3CLIENT_OP_CHANNEL_DELETE */
+const TS3CLIENT_OP_CHANNEL_DELETE = 0;
+/** @var int TS3CLIENT_OP_FLUSH_CLIENT_SELF_UPDATES */
+const TS3CLIENT_OP_FLUSH_CLIENT_SELF_UPDATES = 0;
+/** @var int TS3CLIENT_OP_FLUSH_CHANNEL_UPDATES */
+const TS3CLIENT_OP_FLUSH_CHANNEL_UPDATES = 0;
+/** @var int TS3CLIENT_OP_FLUSH_CHANNEL_CREATION */
+const TS3CLIENT_OP_FLUSH_CHANNEL_CREATION = 0;
+/** @var int TS3CLIENT_OP_SEND_TEXT_MESSAGE */
+const TS3CLIENT_OP_SEND_TEXT_MESSAGE = 0;
+/** @var int TS3CLIENT_TRANSFER_QUEUED */
+const TS3CLIENT_TRANSFER_QUEUED = 0;
+/** @var int TS3CLIENT_TRANSFER_STARTING */
+const TS3CLIENT_TRANSFER_STARTING = 0;
+/** @var int TS3CLIENT_TRANSFER_RUNNING */
+const TS3CLIENT_TRANSFER_RUNNING = 0;
+/** @var int TS3CLIENT_TRANSFER_DONE */
+const TS3CLIENT_TRANSFER_DONE = 0;
+/** @var int TS3CLIENT_TRANSFER_FAILED */
+const TS3CLIENT_TRANSFER_FAILED = 0;
+/** @var int TS3CLIENT_TRANSFER_CANCELED */
+const TS3CLIENT_TRANSFER_CANCELED = 0;
 /** @var int CONNECTION_PING */
 const CONNECTION_PING = 0;
 /** @var int CONNECTION_PING_DEVIATION */
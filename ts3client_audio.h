@@ -0,0 +1,246 @@
+/* $Id$ */
+#pragma once
+
+/*
+ * Per sample work on signed 16 bit PCM. Every kernel has a scalar version and,
+ * on x86, SSE2 and AVX2 versions that are compiled with target attributes, so
+ * the extension runs on any CPU and picks the best variant at runtime. The
+ * vector versions handle whole blocks and leave the tail to the scalar code,
+ * and all variants produce identical results.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define TS3CLIENT_AUDIO_X86 1
+# include <immintrin.h>
+#else
+# define TS3CLIENT_AUDIO_X86 0
+#endif
+
+/* Peak and sum of squares of a block of samples; the peak of -32768 counts as 32767. */
+struct AudioLevel
+{
+	int peak;
+	uint64_t sum_squares;
+};
+
+struct AudioKernels
+{
+	const char *name;
+	/* Scales samples in place, saturating to 16 bit. */
+	void (*gain)(int16_t *samples, size_t count, float gain);
+	/* Averages interleaved stereo frames into mono. */
+	void (*downmix)(const int16_t *stereo, int16_t *mono, size_t frames);
+	/* Adds a block of samples to a level. */
+	void (*level)(const int16_t *samples, size_t count, struct AudioLevel *level);
+};
+
+static inline int16_t audio_saturate(long value)
+{
+	return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+}
+
+static inline int audio_level_rms(const struct AudioLevel *level, size_t count)
+{
+	return count ? (int)sqrt((double)level->sum_squares / count) : 0;
+}
+
+static void audio_gain_scalar(int16_t *samples, size_t count, float gain)
+{
+	for (size_t i = 0; i < count; ++i)
+		samples[i] = audio_saturate(lrintf(samples[i] * gain));
+}
+
+static void audio_downmix_scalar(const int16_t *stereo, int16_t *mono, size_t frames)
+{
+	for (size_t i = 0; i < frames; ++i)
+		mono[i] = (int16_t)(((int)stereo[2 * i] + stereo[2 * i + 1]) >> 1);
+}
+
+static void audio_level_scalar(const int16_t *samples, size_t count, struct AudioLevel *level)
+{
+	int peak = level->peak;
+	uint64_t sum_squares = level->sum_squares;
+	for (size_t i = 0; i < count; ++i)
+	{
+		int magnitude = samples[i] < 0 ? -samples[i] : samples[i];
+		if (magnitude > INT16_MAX)
+			magnitude = INT16_MAX;
+		if (magnitude > peak)
+			peak = magnitude;
+		sum_squares += (uint32_t)(samples[i] * samples[i]);
+	}
+	level->peak = peak;
+	level->sum_squares = sum_squares;
+}
+
+static const struct AudioKernels audio_kernels_scalar = {
+	"scalar", audio_gain_scalar, audio_downmix_scalar, audio_level_scalar
+};
+
+#if TS3CLIENT_AUDIO_X86
+
+__attribute__((target("sse2")))
+static void audio_gain_sse2(int16_t *samples, size_t count, float gain)
+{
+	const __m128 factor = _mm_set1_ps(gain);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(block, block), 16);
+		__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(block, block), 16);
+		low = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), factor));
+		high = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), factor));
+		_mm_storeu_si128((__m128i *)(samples + i), _mm_packs_epi32(low, high));
+	}
+	audio_gain_scalar(samples + i, count - i, gain);
+}
+
+/* madd with ones sums each left and right pair into 32 bit. */
+__attribute__((target("sse2")))
+static void audio_downmix_sse2(const int16_t *stereo, int16_t *mono, size_t frames)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t i = 0;
+	for (; i + 8 <= frames; i += 8)
+	{
+		__m128i first = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(stereo + 2 * i)), ones);
+		__m128i second = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(stereo + 2 * i + 8)), ones);
+		_mm_storeu_si128((__m128i *)(mono + i), _mm_packs_epi32(_mm_srai_epi32(first, 1), _mm_srai_epi32(second, 1)));
+	}
+	audio_downmix_scalar(stereo + 2 * i, mono + i, frames - i);
+}
+
+/* Squares are summed as unsigned 32 bit pairs, since two squares of -32768 exceed INT32_MAX, and widened to 64 bit right away. */
+__attribute__((target("sse2")))
+static void audio_level_sse2(const int16_t *samples, size_t count, struct AudioLevel *level)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i peak = zero;
+	__m128i sum = zero;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)(samples + i));
+		peak = _mm_max_epi16(peak, _mm_max_epi16(block, _mm_subs_epi16(zero, block)));
+		__m128i squares = _mm_madd_epi16(block, block);
+		sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(squares, zero));
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(squares, zero));
+	}
+
+	int16_t peaks[8];
+	uint64_t sums[2];
+	_mm_storeu_si128((__m128i *)peaks, peak);
+	_mm_storeu_si128((__m128i *)sums, sum);
+	for (int lane = 0; lane < 8; ++lane)
+	{
+		if (peaks[lane] > level->peak)
+			level->peak = peaks[lane];
+	}
+	level->sum_squares += sums[0] + sums[1];
+	audio_level_scalar(samples + i, count - i, level);
+}
+
+static const struct AudioKernels audio_kernels_sse2 = {
+	"sse2", audio_gain_sse2, audio_downmix_sse2, audio_level_sse2
+};
+
+/*
+ * 256 bit packs and unpacks work within 128 bit lanes, so their results are
+ * put back into sample order with a permutation.
+ */
+__attribute__((target("avx2")))
+static void audio_gain_avx2(int16_t *samples, size_t count, float gain)
+{
+	const __m256 factor = _mm256_set1_ps(gain);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)(samples + i));
+		__m256i low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(block));
+		__m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(block, 1));
+		low = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(low), factor));
+		high = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(high), factor));
+		_mm256_storeu_si256((__m256i *)(samples + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8));
+	}
+	audio_gain_sse2(samples + i, count - i, gain);
+}
+
+__attribute__((target("avx2")))
+static void audio_downmix_avx2(const int16_t *stereo, int16_t *mono, size_t frames)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	size_t i = 0;
+	for (; i + 16 <= frames; i += 16)
+	{
+		__m256i first = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(stereo + 2 * i)), ones);
+		__m256i second = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(stereo + 2 * i + 16)), ones);
+		__m256i packed = _mm256_packs_epi32(_mm256_srai_epi32(first, 1), _mm256_srai_epi32(second, 1));
+		_mm256_storeu_si256((__m256i *)(mono + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+	audio_downmix_sse2(stereo + 2 * i, mono + i, frames - i);
+}
+
+__attribute__((target("avx2")))
+static void audio_level_avx2(const int16_t *samples, size_t count, struct AudioLevel *level)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i peak = zero;
+	__m256i sum = zero;
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)(samples + i));
+		peak = _mm256_max_epi16(peak, _mm256_max_epi16(block, _mm256_subs_epi16(zero, block)));
+		__m256i squares = _mm256_madd_epi16(block, block);
+		sum = _mm256_add_epi64(sum, _mm256_unpacklo_epi32(squares, zero));
+		sum = _mm256_add_epi64(sum, _mm256_unpackhi_epi32(squares, zero));
+	}
+
+	int16_t peaks[16];
+	uint64_t sums[4];
+	_mm256_storeu_si256((__m256i *)peaks, peak);
+	_mm256_storeu_si256((__m256i *)sums, sum);
+	for (int lane = 0; lane < 16; ++lane)
+	{
+		if (peaks[lane] > level->peak)
+			level->peak = peaks[lane];
+	}
+	level->sum_squares += sums[0] + sums[1] + sums[2] + sums[3];
+	audio_level_sse2(samples + i, count - i, level);
+}
+
+static const struct AudioKernels audio_kernels_avx2 = {
+	"avx2", audio_gain_avx2, audio_downmix_avx2, audio_level_avx2
+};
+
+#endif
+
+static inline bool audio_kernels_supported(const struct AudioKernels *kernels)
+{
+#if TS3CLIENT_AUDIO_X86
+	__builtin_cpu_init();
+	if (kernels == &audio_kernels_avx2)
+		return __builtin_cpu_supports("avx2");
+	if (kernels == &audio_kernels_sse2)
+		return __builtin_cpu_supports("sse2");
+#endif
+	return kernels == &audio_kernels_scalar;
+}
+
+/* The fastest variant the CPU supports. */
+static inline const struct AudioKernels *audio_kernels_select(void)
+{
+#if TS3CLIENT_AUDIO_X86
+	if (audio_kernels_supported(&audio_kernels_avx2))
+		return &audio_kernels_avx2;
+	if (audio_kernels_supported(&audio_kernels_sse2))
+		return &audio_kernels_sse2;
+#endif
+	return &audio_kernels_scalar;
+}